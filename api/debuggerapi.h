@@ -321,6 +321,56 @@ namespace BinaryNinjaDebuggerAPI
 		uint64_t offset;
 		uint64_t address;
 		bool enabled;
+		std::string condition;
+	};
+
+
+	typedef BNDebugWatchpointType DebugWatchpointType;
+
+	struct DebugWatchpoint
+	{
+		uint64_t address;
+		uint64_t size;
+		DebugWatchpointType type;
+	};
+
+
+	// Collects registers and memory at an address each time it is hit, without stopping the target
+	struct DebugTracepoint
+	{
+		uint32_t id = 0;
+		uint64_t address = 0;
+		bool collectAllRegisters = false;
+		std::vector<std::string> registers;
+		// Address and size
+		std::vector<std::pair<uint64_t, uint64_t>> memory;
+		// The memory these expressions read is collected, e.g., "u64[rsp + 8]"
+		std::vector<std::string> expressions;
+		std::string condition;
+		// Stop the trace after this many hits, 0 for no limit
+		uint64_t passCount = 0;
+	};
+
+
+	struct DebugTraceFrame
+	{
+		uint32_t index;
+		uint32_t tracepoint;
+		std::map<std::string, uint64_t> registers;
+		std::vector<std::pair<uint64_t, DataBuffer>> memory;
+	};
+
+
+	typedef BNDebugTraceStopReason DebugTraceStopReason;
+
+	struct DebugTraceStatus
+	{
+		bool supported;
+		bool running;
+		DebugTraceStopReason stopReason;
+		uint64_t frames;
+		uint64_t bufferSize;
+		uint64_t bufferFree;
 	};
 
 
@@ -363,6 +413,7 @@ namespace BinaryNinjaDebuggerAPI
 		DebugStopReason reason;
 		std::uint32_t lastActiveThread;
 		size_t exitCode;
+		std::uint64_t dataAddress;
 		void* data;
 	};
 
@@ -436,6 +487,9 @@ namespace BinaryNinjaDebuggerAPI
 		std::vector<DebugThread> GetThreads();
 		DebugThread GetActiveThread();
 		void SetActiveThread(const DebugThread& thread);
+		// Only supported by the adapters that run the target in the non-stop mode
+		bool ResumeThread(uint32_t tid);
+		bool StopThread(uint32_t tid);
 		std::vector<DebugFrame> GetFramesOfThread(uint32_t tid);
 
 		std::vector<DebugModule> GetModules();
@@ -498,8 +552,29 @@ namespace BinaryNinjaDebuggerAPI
 		void DeleteBreakpoint(const ModuleNameAndOffset& breakpoint);
 		void AddBreakpoint(uint64_t address);
 		void AddBreakpoint(const ModuleNameAndOffset& breakpoint);
+		void AddBreakpoints(const std::vector<uint64_t>& addresses);
+		void DeleteBreakpoints(const std::vector<uint64_t>& addresses);
 		bool ContainsBreakpoint(uint64_t address);
 		bool ContainsBreakpoint(const ModuleNameAndOffset& breakpoint);
+		// See DebugAdapter::SetBreakpointCondition for the syntax. An empty condition makes the breakpoint unconditional.
+		bool SetBreakpointCondition(uint64_t address, const std::string& condition);
+		bool SetBreakpointCondition(const ModuleNameAndOffset& breakpoint, const std::string& condition);
+
+		// Hardware watchpoints, which only exist while the target is running. The target stops with the Watchpoint
+		// reason when the data is accessed, and GetStopDataAddress() tells the address.
+		bool AddWatchpoint(uint64_t address, uint64_t size, DebugWatchpointType type);
+		bool RemoveWatchpoint(uint64_t address);
+		std::vector<DebugWatchpoint> GetWatchpoints();
+		uint64_t GetStopDataAddress();
+
+		// Returns the id of the tracepoint. The tracepoints are sent to the target when the trace starts.
+		uint32_t AddTracepoint(const DebugTracepoint& tracepoint);
+		bool RemoveTracepoint(uint32_t id);
+		std::vector<DebugTracepoint> GetTracepoints();
+		bool StartTrace();
+		bool StopTrace();
+		DebugTraceStatus GetTraceStatus();
+		std::vector<DebugTraceFrame> GetTraceFrames();
 
 		uint64_t IP();
 		uint64_t GetLastIP();
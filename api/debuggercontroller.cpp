@@ -150,6 +150,18 @@ void DebuggerController::SetActiveThread(const DebugThread& thread)
 }
 
 
+bool DebuggerController::ResumeThread(uint32_t tid)
+{
+	return BNDebuggerResumeThread(m_object, tid);
+}
+
+
+bool DebuggerController::StopThread(uint32_t tid)
+{
+	return BNDebuggerStopThread(m_object, tid);
+}
+
+
 std::vector<DebugFrame> DebuggerController::GetFramesOfThread(uint32_t tid)
 {
 	size_t count;
@@ -527,6 +539,7 @@ std::vector<DebugBreakpoint> DebuggerController::GetBreakpoints()
 		bp.offset = breakpoints[i].offset;
 		bp.address = breakpoints[i].address;
 		bp.enabled = breakpoints[i].enabled;
+		bp.condition = breakpoints[i].condition;
 		result[i] = bp;
 	}
 
@@ -553,6 +566,18 @@ void DebuggerController::AddBreakpoint(uint64_t address)
 }
 
 
+void DebuggerController::AddBreakpoints(const std::vector<uint64_t>& addresses)
+{
+	BNDebuggerAddAbsoluteBreakpoints(m_object, addresses.data(), addresses.size());
+}
+
+
+void DebuggerController::DeleteBreakpoints(const std::vector<uint64_t>& addresses)
+{
+	BNDebuggerDeleteAbsoluteBreakpoints(m_object, addresses.data(), addresses.size());
+}
+
+
 void DebuggerController::AddBreakpoint(const ModuleNameAndOffset& breakpoint)
 {
 	BNDebuggerAddRelativeBreakpoint(m_object, breakpoint.module.c_str(), breakpoint.offset);
@@ -571,6 +596,165 @@ bool DebuggerController::ContainsBreakpoint(const ModuleNameAndOffset &breakpoin
 }
 
 
+bool DebuggerController::SetBreakpointCondition(uint64_t address, const std::string& condition)
+{
+	return BNDebuggerSetAbsoluteBreakpointCondition(m_object, address, condition.c_str());
+}
+
+
+bool DebuggerController::SetBreakpointCondition(const ModuleNameAndOffset& breakpoint, const std::string& condition)
+{
+	return BNDebuggerSetRelativeBreakpointCondition(m_object, breakpoint.module.c_str(), breakpoint.offset,
+		condition.c_str());
+}
+
+
+bool DebuggerController::AddWatchpoint(uint64_t address, uint64_t size, DebugWatchpointType type)
+{
+	return BNDebuggerAddWatchpoint(m_object, address, size, type);
+}
+
+
+bool DebuggerController::RemoveWatchpoint(uint64_t address)
+{
+	return BNDebuggerRemoveWatchpoint(m_object, address);
+}
+
+
+std::vector<DebugWatchpoint> DebuggerController::GetWatchpoints()
+{
+	size_t count;
+	BNDebugWatchpoint* watchpoints = BNDebuggerGetWatchpoints(m_object, &count);
+
+	std::vector<DebugWatchpoint> result;
+	result.reserve(count);
+	for (size_t i = 0; i < count; i++)
+		result.push_back({watchpoints[i].address, watchpoints[i].size, watchpoints[i].type});
+
+	BNDebuggerFreeWatchpoints(watchpoints);
+	return result;
+}
+
+
+uint64_t DebuggerController::GetStopDataAddress()
+{
+	return BNDebuggerGetStopDataAddress(m_object);
+}
+
+
+uint32_t DebuggerController::AddTracepoint(const DebugTracepoint& tracepoint)
+{
+	std::vector<const char*> registers;
+	for (const auto& name: tracepoint.registers)
+		registers.push_back(name.c_str());
+	std::vector<uint64_t> memoryAddresses, memorySizes;
+	for (const auto& [address, size]: tracepoint.memory)
+	{
+		memoryAddresses.push_back(address);
+		memorySizes.push_back(size);
+	}
+	std::vector<const char*> expressions;
+	for (const auto& expression: tracepoint.expressions)
+		expressions.push_back(expression.c_str());
+
+	BNDebugTracepoint tp;
+	tp.id = 0;
+	tp.address = tracepoint.address;
+	tp.collectAllRegisters = tracepoint.collectAllRegisters;
+	tp.registers = const_cast<char**>(registers.data());
+	tp.registerCount = registers.size();
+	tp.memoryAddresses = memoryAddresses.data();
+	tp.memorySizes = memorySizes.data();
+	tp.memoryCount = memoryAddresses.size();
+	tp.expressions = const_cast<char**>(expressions.data());
+	tp.expressionCount = expressions.size();
+	tp.condition = const_cast<char*>(tracepoint.condition.c_str());
+	tp.passCount = tracepoint.passCount;
+	return BNDebuggerAddTracepoint(m_object, &tp);
+}
+
+
+bool DebuggerController::RemoveTracepoint(uint32_t id)
+{
+	return BNDebuggerRemoveTracepoint(m_object, id);
+}
+
+
+std::vector<DebugTracepoint> DebuggerController::GetTracepoints()
+{
+	size_t count;
+	BNDebugTracepoint* tracepoints = BNDebuggerGetTracepoints(m_object, &count);
+
+	std::vector<DebugTracepoint> result;
+	result.reserve(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		DebugTracepoint tp;
+		tp.id = tracepoints[i].id;
+		tp.address = tracepoints[i].address;
+		tp.collectAllRegisters = tracepoints[i].collectAllRegisters;
+		for (size_t j = 0; j < tracepoints[i].registerCount; j++)
+			tp.registers.emplace_back(tracepoints[i].registers[j]);
+		for (size_t j = 0; j < tracepoints[i].memoryCount; j++)
+			tp.memory.emplace_back(tracepoints[i].memoryAddresses[j], tracepoints[i].memorySizes[j]);
+		for (size_t j = 0; j < tracepoints[i].expressionCount; j++)
+			tp.expressions.emplace_back(tracepoints[i].expressions[j]);
+		tp.condition = tracepoints[i].condition;
+		tp.passCount = tracepoints[i].passCount;
+		result.push_back(tp);
+	}
+
+	BNDebuggerFreeTracepoints(tracepoints, count);
+	return result;
+}
+
+
+bool DebuggerController::StartTrace()
+{
+	return BNDebuggerStartTrace(m_object);
+}
+
+
+bool DebuggerController::StopTrace()
+{
+	return BNDebuggerStopTrace(m_object);
+}
+
+
+DebugTraceStatus DebuggerController::GetTraceStatus()
+{
+	DebugTraceStatus status;
+	status.supported = BNDebuggerGetTraceStatus(m_object, &status.running, &status.stopReason, &status.frames,
+		&status.bufferSize, &status.bufferFree);
+	return status;
+}
+
+
+std::vector<DebugTraceFrame> DebuggerController::GetTraceFrames()
+{
+	size_t count;
+	BNDebugTraceFrame* frames = BNDebuggerGetTraceFrames(m_object, &count);
+
+	std::vector<DebugTraceFrame> result;
+	result.reserve(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		DebugTraceFrame frame;
+		frame.index = frames[i].index;
+		frame.tracepoint = frames[i].tracepoint;
+		for (size_t j = 0; j < frames[i].registerCount; j++)
+			frame.registers[frames[i].registers[j].name] = frames[i].registers[j].value;
+		for (size_t j = 0; j < frames[i].memoryCount; j++)
+			frame.memory.emplace_back(frames[i].memory[j].address,
+				DataBuffer(frames[i].memory[j].data, frames[i].memory[j].size));
+		result.push_back(frame);
+	}
+
+	BNDebuggerFreeTraceFrames(frames, count);
+	return result;
+}
+
+
 uint64_t DebuggerController::RelativeAddressToAbsolute(const ModuleNameAndOffset& address)
 {
 	return BNDebuggerRelativeAddressToAbsolute(m_object, address.module.c_str(), address.offset);
@@ -623,6 +807,7 @@ void DebuggerController::DebuggerEventCallback(void* ctxt, BNDebuggerEvent* even
 	evt.data.targetStoppedData.reason = event->data.targetStoppedData.reason;
 	evt.data.targetStoppedData.exitCode = event->data.targetStoppedData.exitCode;
 	evt.data.targetStoppedData.lastActiveThread = event->data.targetStoppedData.lastActiveThread;
+	evt.data.targetStoppedData.dataAddress = event->data.targetStoppedData.dataAddress;
 	evt.data.targetStoppedData.data = event->data.targetStoppedData.data;
 
 	evt.data.errorData.error = string(event->data.errorData.error);
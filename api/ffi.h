@@ -99,6 +99,8 @@ extern "C"
 		uint64_t offset;
 		uint64_t address;
 		bool enabled;
+		// Empty for an unconditional breakpoint
+		char* condition;
 	};
 
 
@@ -109,6 +111,49 @@ extern "C"
 	};
 
 
+	struct BNDebugTracepoint
+	{
+		uint32_t id;
+		uint64_t address;
+		bool collectAllRegisters;
+		char** registers;
+		size_t registerCount;
+		uint64_t* memoryAddresses;
+		uint64_t* memorySizes;
+		size_t memoryCount;
+		char** expressions;
+		size_t expressionCount;
+		char* condition;
+		uint64_t passCount;
+	};
+
+
+	struct BNDebugTraceRegister
+	{
+		char* name;
+		uint64_t value;
+	};
+
+
+	struct BNDebugTraceMemory
+	{
+		uint64_t address;
+		uint8_t* data;
+		size_t size;
+	};
+
+
+	struct BNDebugTraceFrame
+	{
+		uint32_t index;
+		uint32_t tracepoint;
+		BNDebugTraceRegister* registers;
+		size_t registerCount;
+		BNDebugTraceMemory* memory;
+		size_t memoryCount;
+	};
+
+
 	enum BNDebugStopReason
 	{
 		UnknownReason = 0,
@@ -164,7 +209,26 @@ extern "C"
 
 		UserRequestedBreak,
 
-		OperationNotSupported
+		OperationNotSupported,
+
+		// A hardware watchpoint is hit, and the data address is in the stop event
+		Watchpoint
+	};
+
+
+	enum BNDebugWatchpointType
+	{
+		WatchpointWrite,
+		WatchpointRead,
+		WatchpointAccess,
+	};
+
+
+	struct BNDebugWatchpoint
+	{
+		uint64_t address;
+		uint64_t size;
+		BNDebugWatchpointType type;
 	};
 
 
@@ -176,6 +240,20 @@ extern "C"
 	};
 
 
+	// Why the trace stopped collecting, from the qTStatus reply
+	enum BNDebugTraceStopReason
+	{
+		TraceNotStopped = 0,
+		TraceNotRun,
+		TraceStoppedByUser,
+		TraceBufferFull,
+		TraceDisconnected,
+		TracePassCountReached,
+		TraceError,
+		TraceUnknownStopReason,
+	};
+
+
 	enum BNDebugAdapterTargetStatus
 	{
 		// Target is not created yet, or not connected to yet
@@ -232,6 +310,8 @@ extern "C"
 		BNDebugStopReason reason;
 		uint32_t lastActiveThread;
 		size_t exitCode;
+		// The accessed address, when the reason is Watchpoint
+		uint64_t dataAddress;
 		void* data;
 	};
 
@@ -302,6 +382,8 @@ extern "C"
 
 	DEBUGGER_FFI_API BNDebugThread BNDebuggerGetActiveThread(BNDebuggerController* controller);
 	DEBUGGER_FFI_API void BNDebuggerSetActiveThread(BNDebuggerController* controller, BNDebugThread thread);
+	DEBUGGER_FFI_API bool BNDebuggerResumeThread(BNDebuggerController* controller, uint32_t tid);
+	DEBUGGER_FFI_API bool BNDebuggerStopThread(BNDebuggerController* controller, uint32_t tid);
 
 	DEBUGGER_FFI_API BNDebugFrame* BNDebuggerGetFramesOfThread(BNDebuggerController* controller, uint32_t tid,
 															   size_t* count);
@@ -370,8 +452,31 @@ extern "C"
 	DEBUGGER_FFI_API void BNDebuggerDeleteRelativeBreakpoint(BNDebuggerController* controller, const char* module, uint64_t offset);
 	DEBUGGER_FFI_API void BNDebuggerAddAbsoluteBreakpoint(BNDebuggerController* controller, uint64_t address);
 	DEBUGGER_FFI_API void BNDebuggerAddRelativeBreakpoint(BNDebuggerController* controller, const char* module, uint64_t offset);
+	DEBUGGER_FFI_API void BNDebuggerAddAbsoluteBreakpoints(
+		BNDebuggerController* controller, const uint64_t* addresses, size_t count);
+	DEBUGGER_FFI_API void BNDebuggerDeleteAbsoluteBreakpoints(
+		BNDebuggerController* controller, const uint64_t* addresses, size_t count);
 	DEBUGGER_FFI_API bool BNDebuggerContainsAbsoluteBreakpoint(BNDebuggerController* controller, uint64_t address);
 	DEBUGGER_FFI_API bool BNDebuggerContainsRelativeBreakpoint(BNDebuggerController* controller, const char* module, uint64_t offset);
+	DEBUGGER_FFI_API bool BNDebuggerSetAbsoluteBreakpointCondition(BNDebuggerController* controller, uint64_t address, const char* condition);
+	DEBUGGER_FFI_API bool BNDebuggerSetRelativeBreakpointCondition(BNDebuggerController* controller, const char* module, uint64_t offset, const char* condition);
+
+	DEBUGGER_FFI_API bool BNDebuggerAddWatchpoint(BNDebuggerController* controller, uint64_t address, uint64_t size, BNDebugWatchpointType type);
+	DEBUGGER_FFI_API bool BNDebuggerRemoveWatchpoint(BNDebuggerController* controller, uint64_t address);
+	DEBUGGER_FFI_API BNDebugWatchpoint* BNDebuggerGetWatchpoints(BNDebuggerController* controller, size_t* count);
+	DEBUGGER_FFI_API void BNDebuggerFreeWatchpoints(BNDebugWatchpoint* watchpoints);
+	DEBUGGER_FFI_API uint64_t BNDebuggerGetStopDataAddress(BNDebuggerController* controller);
+
+	DEBUGGER_FFI_API uint32_t BNDebuggerAddTracepoint(BNDebuggerController* controller, BNDebugTracepoint* tracepoint);
+	DEBUGGER_FFI_API bool BNDebuggerRemoveTracepoint(BNDebuggerController* controller, uint32_t id);
+	DEBUGGER_FFI_API BNDebugTracepoint* BNDebuggerGetTracepoints(BNDebuggerController* controller, size_t* count);
+	DEBUGGER_FFI_API void BNDebuggerFreeTracepoints(BNDebugTracepoint* tracepoints, size_t count);
+	DEBUGGER_FFI_API bool BNDebuggerStartTrace(BNDebuggerController* controller);
+	DEBUGGER_FFI_API bool BNDebuggerStopTrace(BNDebuggerController* controller);
+	DEBUGGER_FFI_API bool BNDebuggerGetTraceStatus(BNDebuggerController* controller, bool* running,
+		BNDebugTraceStopReason* stopReason, uint64_t* frames, uint64_t* bufferSize, uint64_t* bufferFree);
+	DEBUGGER_FFI_API BNDebugTraceFrame* BNDebuggerGetTraceFrames(BNDebuggerController* controller, size_t* count);
+	DEBUGGER_FFI_API void BNDebuggerFreeTraceFrames(BNDebugTraceFrame* frames, size_t count);
 
 	DEBUGGER_FFI_API uint64_t BNDebuggerGetIP(BNDebuggerController* controller);
 	DEBUGGER_FFI_API uint64_t BNDebuggerGetLastIP(BNDebuggerController* controller);
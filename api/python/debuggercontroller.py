@@ -159,19 +159,21 @@ class DebugBreakpoint:
     * ``offset``: the offset of the breakpoint to the start of the module
     * ``address``: the absolute address of the breakpoint
     * ``enabled``: not used
+    * ``condition``: the condition of the breakpoint, or an empty string for an unconditional breakpoint
 
     """
-    def __init__(self, module, offset, address, enabled):
+    def __init__(self, module, offset, address, enabled, condition=''):
         self.module = module
         self.offset = offset
         self.address = address
         self.enabled = enabled
+        self.condition = condition
 
     def __eq__(self, other):
         if not isinstance(other, self.__class__):
             return NotImplemented
         return self.module == other.module and self.offset == other.offset and self.address == other.address \
-               and self.enabled == other.enabled
+               and self.enabled == other.enabled and self.condition == other.condition
 
     def __ne__(self, other):
         if not isinstance(other, self.__class__):
@@ -188,7 +190,8 @@ class DebugBreakpoint:
             raise AttributeError(f"attribute '{name}' is read only")
 
     def __repr__(self):
-        return f"<DebugBreakpoint: {self.module}:{self.offset:#x}, {self.address:#x}>"
+        condition_str = f", if {self.condition}" if self.condition != '' else ''
+        return f"<DebugBreakpoint: {self.module}:{self.offset:#x}, {self.address:#x}{condition_str}>"
 
 
 class ModuleNameAndOffset:
@@ -237,6 +240,98 @@ class ModuleNameAndOffset:
             raise AttributeError(f"attribute '{name}' is read only")
 
 
+class DebugWatchpoint:
+    """
+    DebugWatchpoint is a hardware watchpoint, which stops the target when the data is accessed. It has the following
+    fields:
+
+    * ``address``: the address of the watched data
+    * ``size``: the size of the watched data
+    * ``type``: a DebugWatchpointType, whether it watches writes, reads, or both
+
+    """
+    def __init__(self, address, size, type):
+        self.address = address
+        self.size = size
+        self.type = type
+
+    def __repr__(self):
+        return f"<DebugWatchpoint: {self.address:#x}, {self.size}, {self.type.name}>"
+
+
+class DebugTracepoint:
+    """
+    DebugTracepoint collects data at an address each time it is hit, without stopping the target. It has the following
+    fields:
+
+    * ``id``: the ID of the tracepoint, which the trace frames refer to
+    * ``address``: the absolute address of the tracepoint
+    * ``all_registers``: whether to collect all registers
+    * ``registers``: the names of the registers to collect
+    * ``memory``: the memory to collect, as a list of (address, size)
+    * ``expressions``: the memory these expressions read is collected, e.g., ``u64[rsp + 8]``
+    * ``condition``: only collect when the condition is true. It uses the syntax of the breakpoint conditions.
+    * ``pass_count``: stop the trace after this many hits, 0 for no limit
+
+    """
+    def __init__(self, id, address, all_registers, registers, memory, expressions, condition, pass_count):
+        self.id = id
+        self.address = address
+        self.all_registers = all_registers
+        self.registers = registers
+        self.memory = memory
+        self.expressions = expressions
+        self.condition = condition
+        self.pass_count = pass_count
+
+    def __repr__(self):
+        return f"<DebugTracepoint: {self.id}, {self.address:#x}>"
+
+
+class DebugTraceFrame:
+    """
+    DebugTraceFrame is the data collected by one hit of a tracepoint. It has the following fields:
+
+    * ``index``: the index of the frame in the trace
+    * ``tracepoint``: the ID of the tracepoint that collected it
+    * ``registers``: a dict of the collected register values, by name
+    * ``memory``: the collected memory, as a list of (address, bytes)
+
+    """
+    def __init__(self, index, tracepoint, registers, memory):
+        self.index = index
+        self.tracepoint = tracepoint
+        self.registers = registers
+        self.memory = memory
+
+    def __repr__(self):
+        return f"<DebugTraceFrame: {self.index}, tracepoint {self.tracepoint}>"
+
+
+class DebugTraceStatus:
+    """
+    DebugTraceStatus is the status of the trace in the target. It has the following fields:
+
+    * ``supported``: whether the target supports tracepoints
+    * ``running``: whether the trace is collecting data
+    * ``stop_reason``: why the trace stopped, a DebugTraceStopReason
+    * ``frames``: the number of collected frames
+    * ``buffer_size``: the size of the trace buffer
+    * ``buffer_free``: the free space in the trace buffer
+
+    """
+    def __init__(self, supported, running, stop_reason, frames, buffer_size, buffer_free):
+        self.supported = supported
+        self.running = running
+        self.stop_reason = stop_reason
+        self.frames = frames
+        self.buffer_size = buffer_size
+        self.buffer_free = buffer_free
+
+    def __repr__(self):
+        return f"<DebugTraceStatus: running {self.running}, {self.frames} frames>"
+
+
 class DebugFrame:
     """
     DebugFrame represents a frame in the stack trace. It has the following fields:
@@ -293,13 +388,15 @@ class TargetStoppedEventData:
     * ``last_active_thread``: not used
     * ``exit_code``: not used
     * ``data``: extra data. Not used.
+    * ``data_address``: the accessed address, when the reason is ``DebugStopReason.Watchpoint``
 
     """
-    def __init__(self, reason: DebugStopReason, last_active_thread: int, exit_code: int, data):
+    def __init__(self, reason: DebugStopReason, last_active_thread: int, exit_code: int, data, data_address: int = 0):
         self.reason = reason
         self.last_active_thread = last_active_thread
         self.exit_code = exit_code
         self.data = data
+        self.data_address = data_address
 
 
 class ErrorEventData:
@@ -408,7 +505,8 @@ class DebuggerEventWrapper:
             target_stopped_data = TargetStoppedEventData(data.targetStoppedData.reason,
                                                          data.targetStoppedData.lastActiveThread,
                                                          data.targetStoppedData.exitCode,
-                                                         data.targetStoppedData.data)
+                                                         data.targetStoppedData.data,
+                                                         data.targetStoppedData.dataAddress)
             error_data = ErrorEventData(data.errorData.error, data.errorData.data)
             absolute_addr = data.absoluteAddress
             relative_addr = ModuleNameAndOffset(data.relativeAddress.module, data.relativeAddress.offset)
@@ -585,6 +683,26 @@ class DebuggerController:
     def active_thread(self, thread: DebugThread) -> None:
         dbgcore.BNDebuggerSetActiveThread(self.handle, dbgcore.BNDebugThread(thread.tid, thread.rip))
 
+    def resume_thread(self, tid: int) -> bool:
+        """
+        Resume a single thread, while the other threads keep their state. This is only supported by the adapters that
+        run the target in the non-stop mode. The active thread is resumed with ``go`` instead.
+
+        :param tid: the id of the thread
+        :return: whether the thread is resumed
+        """
+        return dbgcore.BNDebuggerResumeThread(self.handle, tid)
+
+    def stop_thread(self, tid: int) -> bool:
+        """
+        Stop a single thread, while the other threads keep their state. This is only supported by the adapters that
+        run the target in the non-stop mode. The stop is not waited for.
+
+        :param tid: the id of the thread
+        :return: whether the stop request is sent
+        """
+        return dbgcore.BNDebuggerStopThread(self.handle, tid)
+
     @property
     def modules(self) -> List[DebugModule]:
         """
@@ -1073,7 +1191,8 @@ class DebuggerController:
         breakpoints = dbgcore.BNDebuggerGetBreakpoints(self.handle, count)
         result = []
         for i in range(0, count.value):
-            bp = DebugBreakpoint(breakpoints[i].module, breakpoints[i].offset, breakpoints[i].address, breakpoints[i].enabled)
+            bp = DebugBreakpoint(breakpoints[i].module, breakpoints[i].offset, breakpoints[i].address, breakpoints[i].enabled,
+                                 breakpoints[i].condition)
             result.append(bp)
 
         dbgcore.BNDebuggerFreeBreakpoints(breakpoints, count.value)
@@ -1113,6 +1232,29 @@ class DebuggerController:
         else:
             raise NotImplementedError
 
+    def add_breakpoints(self, addresses: List[int]) -> None:
+        """
+        Add breakpoints at a list of absolute addresses
+
+        This is faster than calling ``add_breakpoint`` in a loop, since the adapter can send the whole batch to the
+        backend at once. Addresses that already have a breakpoint are skipped.
+
+        :param addresses: the absolute addresses of the breakpoints to add
+        :return:
+        """
+        addr_list = (ctypes.c_uint64 * len(addresses))(*addresses)
+        dbgcore.BNDebuggerAddAbsoluteBreakpoints(self.handle, addr_list, len(addresses))
+
+    def delete_breakpoints(self, addresses: List[int]) -> None:
+        """
+        Delete the breakpoints at a list of absolute addresses
+
+        :param addresses: the absolute addresses of the breakpoints to delete
+        :return:
+        """
+        addr_list = (ctypes.c_uint64 * len(addresses))(*addresses)
+        dbgcore.BNDebuggerDeleteAbsoluteBreakpoints(self.handle, addr_list, len(addresses))
+
     def has_breakpoint(self, address) -> bool:
         """
         Checks whether a breakpoint exists at the specified address
@@ -1130,6 +1272,209 @@ class DebuggerController:
         else:
             raise NotImplementedError
 
+    def set_breakpoint_condition(self, address, condition: str) -> bool:
+        """
+        Only stop at a breakpoint when the condition is true. An empty condition makes the breakpoint unconditional.
+
+        The condition works on unsigned 64-bit values, and supports numbers, register names, memory reads like
+        ``u32[rsp + 8]``, ``$hits`` for the number of times the breakpoint is hit, and the C operators, e.g.,
+        ``rdi == 0x10 && $hits > 3``. When the backend supports it, e.g., gdbserver, the condition is evaluated in the
+        backend without stopping the target.
+
+        The input can be either an absolute address, or a ModuleNameAndOffset, which specifies a relative address to the
+        start of a module. The latter is useful for ASLR.
+
+        :param address: the address of the breakpoint
+        :param condition: the condition
+        :return: whether the condition is set. It fails if there is no breakpoint at the address, or the condition is
+            not valid for the target.
+        """
+        if isinstance(address, int):
+            return dbgcore.BNDebuggerSetAbsoluteBreakpointCondition(self.handle, address, condition)
+        elif isinstance(address, ModuleNameAndOffset):
+            return dbgcore.BNDebuggerSetRelativeBreakpointCondition(self.handle, address.module, address.offset,
+                                                                    condition)
+        else:
+            raise NotImplementedError
+
+    def add_watchpoint(self, address: int, size: int,
+                       type: DebugWatchpointType = DebugWatchpointType.WatchpointWrite) -> bool:
+        """
+        Add a hardware watchpoint, which stops the target with ``DebugStopReason.Watchpoint`` when the data is accessed.
+        ``stop_data_address`` tells the address of the data after the stop. This finds the code that corrupts the
+        memory without single stepping.
+
+        The watchpoints only exist while the target is running, and they are not saved. The hardware limits the number
+        of the watchpoints, and the size is usually 1, 2, 4 or 8, aligned to the size.
+
+        :param address: the address of the data
+        :param size: the size of the data
+        :param type: whether to watch writes, reads, or both
+        :return: whether the watchpoint is added
+        """
+        return dbgcore.BNDebuggerAddWatchpoint(self.handle, address, size, type)
+
+    def remove_watchpoint(self, address: int) -> bool:
+        """
+        Remove the hardware watchpoint at the address
+
+        :param address: the address of the data
+        :return: whether the watchpoint is removed
+        """
+        return dbgcore.BNDebuggerRemoveWatchpoint(self.handle, address)
+
+    @property
+    def watchpoints(self) -> List[DebugWatchpoint]:
+        """
+        The list of the hardware watchpoints
+
+        :return:
+        """
+        count = ctypes.c_ulonglong()
+        watchpoints = dbgcore.BNDebuggerGetWatchpoints(self.handle, count)
+        result = []
+        for i in range(0, count.value):
+            result.append(DebugWatchpoint(watchpoints[i].address, watchpoints[i].size,
+                                          DebugWatchpointType(watchpoints[i].type)))
+
+        dbgcore.BNDebuggerFreeWatchpoints(watchpoints)
+        return result
+
+    @property
+    def stop_data_address(self) -> int:
+        """
+        The address of the data accessed when the target stops with ``DebugStopReason.Watchpoint``
+
+        :return:
+        """
+        return dbgcore.BNDebuggerGetStopDataAddress(self.handle)
+
+    def add_tracepoint(self, address: int, registers: List[str] = None, memory: List[tuple] = None,
+                       expressions: List[str] = None, condition: str = '', pass_count: int = 0,
+                       all_registers: bool = False) -> int:
+        """
+        Add a tracepoint, which collects data at the address each time it is hit, without stopping the target. This is
+        useful on code that is hit too often to stop at, e.g., a request handler under load.
+
+        The tracepoints are sent to the target by ``start_trace``, and the collected frames are read with
+        ``trace_frames`` after the trace stops. This needs a backend that supports tracepoints, e.g., gdbserver.
+
+        :param address: the address of the tracepoint
+        :param registers: the names of the registers to collect
+        :param memory: the memory to collect, as a list of (address, size)
+        :param expressions: the memory these expressions read is collected, e.g., ``u64[rsp + 8]``
+        :param condition: only collect when the condition is true, e.g., ``rdi == 0x10``
+        :param pass_count: stop the trace after this many hits, 0 for no limit
+        :param all_registers: collect all registers
+        :return: the ID of the tracepoint
+        """
+        registers = registers or []
+        memory = memory or []
+        expressions = expressions or []
+        tracepoint = dbgcore.BNDebugTracepoint()
+        tracepoint.id = 0
+        tracepoint.address = address
+        tracepoint.collectAllRegisters = all_registers
+        tracepoint.registers = (ctypes.c_char_p * len(registers))(*[name.encode('utf-8') for name in registers])
+        tracepoint.registerCount = len(registers)
+        tracepoint.memoryAddresses = (ctypes.c_uint64 * len(memory))(*[start for start, _ in memory])
+        tracepoint.memorySizes = (ctypes.c_uint64 * len(memory))(*[size for _, size in memory])
+        tracepoint.memoryCount = len(memory)
+        tracepoint.expressions = (ctypes.c_char_p * len(expressions))(*[text.encode('utf-8') for text in expressions])
+        tracepoint.expressionCount = len(expressions)
+        tracepoint.condition = condition
+        tracepoint.passCount = pass_count
+        return dbgcore.BNDebuggerAddTracepoint(self.handle, tracepoint)
+
+    def remove_tracepoint(self, id: int) -> bool:
+        """
+        Remove a tracepoint. It is removed from the target when the next trace starts.
+
+        :param id: the ID of the tracepoint
+        :return: whether the tracepoint exists
+        """
+        return dbgcore.BNDebuggerRemoveTracepoint(self.handle, id)
+
+    @property
+    def tracepoints(self) -> List[DebugTracepoint]:
+        """
+        The list of tracepoints
+
+        :return:
+        """
+        count = ctypes.c_ulonglong()
+        tracepoints = dbgcore.BNDebuggerGetTracepoints(self.handle, count)
+        result = []
+        for i in range(0, count.value):
+            tp = tracepoints[i]
+            registers = [tp.registers[j].decode('utf-8') for j in range(tp.registerCount)]
+            memory = [(tp.memoryAddresses[j], tp.memorySizes[j]) for j in range(tp.memoryCount)]
+            expressions = [tp.expressions[j].decode('utf-8') for j in range(tp.expressionCount)]
+            result.append(DebugTracepoint(tp.id, tp.address, tp.collectAllRegisters, registers, memory, expressions,
+                                          tp.condition, tp.passCount))
+
+        dbgcore.BNDebuggerFreeTracepoints(tracepoints, count.value)
+        return result
+
+    def start_trace(self) -> bool:
+        """
+        Send the tracepoints to the target and start collecting. The frames of the previous trace are discarded. The
+        target must be stopped, and it collects the data while it runs, e.g., after ``go``.
+
+        :return: whether the trace started
+        """
+        return dbgcore.BNDebuggerStartTrace(self.handle)
+
+    def stop_trace(self) -> bool:
+        """
+        Stop collecting. The target must be stopped.
+
+        :return: whether the trace stopped
+        """
+        return dbgcore.BNDebuggerStopTrace(self.handle)
+
+    @property
+    def trace_status(self) -> DebugTraceStatus:
+        """
+        The status of the trace in the target
+
+        :return:
+        """
+        running = ctypes.c_bool()
+        stop_reason = ctypes.c_int()
+        frames = ctypes.c_uint64()
+        buffer_size = ctypes.c_uint64()
+        buffer_free = ctypes.c_uint64()
+        supported = dbgcore.BNDebuggerGetTraceStatus(self.handle, running, stop_reason, frames, buffer_size,
+                                                     buffer_free)
+        return DebugTraceStatus(supported, running.value, DebugTraceStopReason(stop_reason.value), frames.value,
+                                buffer_size.value, buffer_free.value)
+
+    @property
+    def trace_frames(self) -> List[DebugTraceFrame]:
+        """
+        All frames collected by the trace. All of them are read from the target at once, and the requests are
+        pipelined, so this is much faster than reading the frames one by one.
+
+        :return:
+        """
+        count = ctypes.c_ulonglong()
+        frames = dbgcore.BNDebuggerGetTraceFrames(self.handle, count)
+        result = []
+        for i in range(0, count.value):
+            frame = frames[i]
+            registers = {}
+            for j in range(frame.registerCount):
+                registers[frame.registers[j].name] = frame.registers[j].value
+            memory = []
+            for j in range(frame.memoryCount):
+                block = frame.memory[j]
+                memory.append((block.address, ctypes.string_at(block.data, block.size)))
+            result.append(DebugTraceFrame(frame.index, frame.tracepoint, registers, memory))
+
+        dbgcore.BNDebuggerFreeTraceFrames(frames, count.value)
+        return result
+
     @property
     def ip(self) -> int:
         """
@@ -1257,6 +1602,23 @@ class DebuggerController:
         md_handle_BN = ctypes.cast(md_handle, ctypes.POINTER(binaryninja.core.BNMetadata))
         return binaryninja.metadata.Metadata(handle=md_handle_BN).value
 
+    @property
+    def stats(self) -> dict:
+        """
+        Statistics of the calls to the debug adapter, as a nested dict. The entries are:
+
+        - ``operations``: for each adapter method, the call count, failures, and the total, min, max, p50, p90 and \
+        p99 latencies in microseconds
+        - ``queue``: the depth of the request queue, and how long requests waited in it, in microseconds
+        - ``rsp``: the packets and bytes sent to and received from the backend, for the GDB RSP based adapters
+        - ``cache``: the hits and misses of the memory and register caches
+
+        ``queue`` is only available for the adapters that queue their requests.
+
+        :return: the statistics
+        """
+        return self.get_adapter_property("stats")
+
     def set_adapter_property(self, name: str, value: binaryninja.metadata.MetadataValueType) -> bool:
         _value = value
         if not isinstance(_value, binaryninja.metadata.Metadata):
@@ -0,0 +1,105 @@
+/*
+Copyright 2020-2022 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+// Measures the hex encoding and decoding throughput of every kernel that the host CPU supports, in GB/s of binary
+// data. The sizes cover a register packet, a typical memory read and a large memory transfer.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "hexcodec.h"
+
+using namespace BinaryNinjaDebugger;
+
+
+namespace
+{
+	// Repeat the operation until it has run for at least this long, so the short sizes are measured accurately
+	constexpr std::chrono::milliseconds MIN_DURATION{200};
+
+	template <typename Operation>
+	double MeasureGigabytesPerSecond(std::size_t size, Operation operation)
+	{
+		using clock = std::chrono::steady_clock;
+		std::size_t iterations = 0;
+		const auto start = clock::now();
+		auto elapsed = clock::duration{};
+		do
+		{
+			for (int i = 0; i < 64; i++)
+				operation();
+			iterations += 64;
+			elapsed = clock::now() - start;
+		} while (elapsed < MIN_DURATION);
+
+		const double seconds = std::chrono::duration<double>(elapsed).count();
+		return (double)size * iterations / seconds / 1e9;
+	}
+}
+
+
+int main()
+{
+	const HexCodec::Kernel kernels[] = {
+		HexCodec::ScalarKernel, HexCodec::SSE2Kernel, HexCodec::AVX2Kernel, HexCodec::NEONKernel};
+	const std::size_t sizes[] = {64, 4096, 1 << 20};
+
+	std::printf("selected kernel: %s\n", HexCodec::GetKernelName(HexCodec::GetKernel()));
+	std::printf("%-8s %10s %14s %14s\n", "kernel", "size", "encode GB/s", "decode GB/s");
+
+	std::mt19937 random(0);
+	int failures = 0;
+	for (const auto size : sizes)
+	{
+		std::vector<std::uint8_t> binary(size);
+		for (auto& byte : binary)
+			byte = static_cast<std::uint8_t>(random());
+		const std::string reference = HexCodec::Encode(binary.data(), binary.size());
+
+		for (const auto kernel : kernels)
+		{
+			if (!HexCodec::IsKernelSupported(kernel))
+				continue;
+
+			// Check the kernel against the selected one before timing it
+			std::string hex(2 * size, '\0');
+			std::vector<std::uint8_t> decoded(size);
+			HexCodec::Encode(kernel, binary.data(), size, hex.data());
+			if ((hex != reference) || !HexCodec::Decode(kernel, hex.data(), size, decoded.data())
+				|| (decoded != binary))
+			{
+				std::printf("%-8s %10zu  mismatch\n", HexCodec::GetKernelName(kernel), size);
+				failures++;
+				continue;
+			}
+
+			const double encode = MeasureGigabytesPerSecond(size, [&]() {
+				HexCodec::Encode(kernel, binary.data(), size, hex.data());
+			});
+			const double decode = MeasureGigabytesPerSecond(size, [&]() {
+				HexCodec::Decode(kernel, hex.data(), size, decoded.data());
+			});
+			std::printf("%-8s %10zu %14.2f %14.2f\n", HexCodec::GetKernelName(kernel), size, encode, decode);
+		}
+	}
+
+	return failures ? 1 : 0;
+}
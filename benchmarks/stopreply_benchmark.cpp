@@ -0,0 +1,163 @@
+/*
+Copyright 2020-2022 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+// Compares the stop reply parsing before and after the tokenizer: the regex based PacketToUnorderedMap that the
+// adapters used to call, and RspStopReply::Parse. The samples are stop replies recorded from gdbserver.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <fmt/format.h>
+#include "rspconnector.h"
+
+using namespace BinaryNinjaDebugger;
+
+
+namespace
+{
+    constexpr std::chrono::milliseconds MIN_DURATION{200};
+
+    const char* const SAMPLES[] = {
+        "T0506:0000000000000000;07:c0e4ffffff7f0000;10:30c5fdf7ff7f0000;thread:p1f2a.1f2a;core:3;",
+        "T0506:d0e4ffffff7f0000;07:b0e4ffffff7f0000;10:4d11555555550000;thread:p1f2a.1f2a;core:1;swbreak:;",
+        "T0506:d0e4ffffff7f0000;07:a0e4ffffff7f0000;10:5e11555555550000;thread:p1f2a.1f2b;core:0;watch:1c40555555550000;",
+        "T1106:0000000000000000;07:e0d3ffffff7f0000;10:a7e2e4f7ff7f0000;thread:p1f2a.1f2a;core:2;",
+    };
+
+    std::vector<std::string> RegexSplit(const std::string& string, const std::string& regex)
+    {
+        const auto regex_l = std::regex(regex);
+        return { std::sregex_token_iterator(string.begin(), string.end(), regex_l, -1), std::sregex_token_iterator() };
+    }
+
+    // The parser that the tokenizer replaced, as it was. The only change is escaping the '.' of the thread id
+    // separator, which used to match any character and made every "p<pid>.<tid>" thread id throw.
+    std::unordered_map<std::string, std::uint64_t> PacketToUnorderedMap(const RspData& data)
+    {
+        std::unordered_map<std::string, std::uint64_t> packet_map{};
+        packet_map["signal"] = std::stoull(data.AsString().substr(1, 2), nullptr, 16);
+
+        const auto data_string = data.AsString();
+        const auto after_signal = data_string.substr(3);
+
+        for ( const auto& entries : RegexSplit(after_signal, ";")) {
+            const auto key_value = RegexSplit(entries, ":");
+            if (key_value.empty())
+                continue;
+
+            const auto key = key_value[0];
+            std::string value;
+            if (key_value.size() == 2)
+            {
+                value = RspConnector::DecodeRLE(RspData(key_value[1])).AsString();
+
+                if (key == "thread") {
+                    if (value[0] == 'p' && value.find('.') != std::string::npos) {
+                        auto core_id_and_thread_id = RegexSplit(value.substr(1), "\\.");
+                        packet_map["thread"] = std::stoull(core_id_and_thread_id[1], nullptr, 16);
+                    } else {
+                        packet_map["thread"] = std::stoull(value, nullptr, 16);
+                    }
+                } else if (std::regex_search(key, std::regex("^[0-9a-fA-F]+$"))) {
+                    packet_map[fmt::format("r{}", std::stoi(key, nullptr, 16))] =
+                        static_cast<std::int64_t>( RspConnector::SwapEndianness(std::stoull(value, nullptr, 16)));
+                } else {
+                    packet_map[key] = std::stoull(value, nullptr, 16);
+                }
+            }
+            else
+            {
+                packet_map[key] = 0;
+            }
+        }
+
+        return packet_map;
+    }
+
+    // Returns the nanoseconds per stop reply
+    template <typename Operation>
+    double MeasureNanoseconds(std::size_t packets, Operation operation)
+    {
+        using clock = std::chrono::steady_clock;
+        std::size_t iterations = 0;
+        const auto start = clock::now();
+        auto elapsed = clock::duration{};
+        do
+        {
+            for (int i = 0; i < 16; i++)
+                operation();
+            iterations += 16;
+            elapsed = clock::now() - start;
+        } while (elapsed < MIN_DURATION);
+
+        return std::chrono::duration<double, std::nano>(elapsed).count() / (double)(iterations * packets);
+    }
+}
+
+
+int main()
+{
+    std::vector<RspData> packets;
+    for (const auto* sample : SAMPLES)
+        packets.emplace_back(std::string(sample));
+
+    // Both parsers must agree on the samples for the comparison to mean anything
+    int failures = 0;
+    for (const auto& packet : packets)
+    {
+        const auto map = PacketToUnorderedMap(packet);
+        const auto string = packet.AsString();
+        RspStopReply reply;
+        if (!reply.Parse(string) || (reply.m_signal != map.at("signal")) || (reply.m_threadId != map.at("thread"))
+            || (reply.m_swbreak != (map.count("swbreak") != 0)) || (reply.m_registerCount != 3))
+        {
+            std::printf("mismatch: %s\n", string.c_str());
+            failures++;
+        }
+    }
+    if (failures)
+        return 1;
+
+    std::vector<std::string> strings;
+    for (const auto& packet : packets)
+        strings.push_back(packet.AsString());
+
+    std::uint64_t sink = 0;
+    const double regex = MeasureNanoseconds(packets.size(), [&]() {
+        for (const auto& packet : packets)
+            sink += PacketToUnorderedMap(packet).size();
+    });
+    const double tokenizer = MeasureNanoseconds(strings.size(), [&]() {
+        RspStopReply reply;
+        for (const auto& string : strings)
+        {
+            reply.Parse(string);
+            sink += reply.m_registerCount;
+        }
+    });
+
+    std::printf("%-10s %14s\n", "parser", "ns/packet");
+    std::printf("%-10s %14.1f\n", "regex", regex);
+    std::printf("%-10s %14.1f\n", "tokenizer", tokenizer);
+    std::printf("speedup: %.1fx\n", regex / tokenizer);
+    return sink ? 0 : 1;
+}
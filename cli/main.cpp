@@ -324,6 +324,23 @@ void PrintStopReason(DbgRef<DebuggerController> controller, DebugStopReason reas
 }
 
 
+// Prints the nested key-value stores of the "stats" adapter property, one value per line
+void PrintStats(const Ref<Metadata>& metadata, size_t depth = 0)
+{
+	const std::string indent(depth * 4, ' ');
+	for (const auto& [key, value] : metadata->GetKeyValueStore())
+	{
+		if (value->IsKeyValueStore())
+		{
+			Log::print("{}{}:\n", indent, key);
+			PrintStats(value, depth + 1);
+		}
+		else if (value->IsUnsignedInteger())
+			Log::print<Log::Info>("{}{}: {}\n", indent, key, value->GetUnsignedInteger());
+	}
+}
+
+
 int main(int argc, const char* argv[])
 {
     Log::SetupAnsi();
@@ -465,6 +482,7 @@ int main(int argc, const char* argv[])
 			print_arg("disasm", "disassemble & lift instructions", "instruction count");
 			print_arg("sr", "display stop reason");
 			print_arg("es", "display execution status");
+			print_arg("stats", "display the adapter call latencies (us), traffic and cache statistics");
 			print_arg("bp", "add a breakpoint", "address (hex)");
 			print_arg("bpr", "remove a breakpoint", "address (hex)");
 			print_arg("c", "go");
@@ -556,6 +574,14 @@ int main(int argc, const char* argv[])
 			auto reason = debugger->StopReason();
 			Log::print<Log::Warning>("stop reason : {}\n", DebuggerController::GetDebugStopReasonString(reason));
 		}
+		else if ( input == "stats" )
+		{
+			auto stats = debugger->GetAdapterProperty("stats");
+			if (stats && stats->IsKeyValueStore())
+				PrintStats(stats);
+			else
+				Log::print<Log::Error>("statistics are not available\n");
+		}
 		else if ( input == "es" )
 		{
 			Log::print<Log::Info>("execution status : {}\n", debugger->GetTargetStatus());
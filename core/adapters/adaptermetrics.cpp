@@ -0,0 +1,124 @@
+/*
+Copyright 2020-2022 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "adaptermetrics.h"
+#include <algorithm>
+
+using namespace BinaryNinja;
+using namespace BinaryNinjaDebugger;
+
+
+std::size_t LatencyHistogram::BucketIndex(std::uint64_t value)
+{
+    // The small values get a bucket each
+    if (value < SUB_BUCKET_COUNT)
+        return value;
+
+    std::size_t msb = 0;
+    while ((msb < 63) && (value >> (msb + 1)))
+        msb++;
+    if (msb >= MAX_VALUE_BITS)
+        return BUCKET_COUNT - 1;
+
+    // The bits right below the most significant one select the bucket within the power of two
+    const std::size_t subBucket = (value >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+    return SUB_BUCKET_COUNT * (msb - SUB_BUCKET_BITS + 1) + subBucket;
+}
+
+
+std::uint64_t LatencyHistogram::BucketUpperBound(std::size_t index)
+{
+    if (index < SUB_BUCKET_COUNT)
+        return index;
+
+    const std::size_t msb = index / SUB_BUCKET_COUNT + SUB_BUCKET_BITS - 1;
+    const std::uint64_t subBucket = index % SUB_BUCKET_COUNT;
+    const std::size_t shift = msb - SUB_BUCKET_BITS;
+    return ((SUB_BUCKET_COUNT + subBucket + 1) << shift) - 1;
+}
+
+
+void LatencyHistogram::Record(std::uint64_t value)
+{
+    m_buckets[BucketIndex(value)]++;
+    m_min = (m_count == 0) ? value : std::min(m_min, value);
+    m_max = std::max(m_max, value);
+    m_count++;
+    m_total += value;
+}
+
+
+void LatencyHistogram::Reset()
+{
+    *this = LatencyHistogram();
+}
+
+
+std::uint64_t LatencyHistogram::Percentile(double fraction) const
+{
+    if (m_count == 0)
+        return 0;
+
+    const auto target = std::max<std::uint64_t>(1, (std::uint64_t)(fraction * m_count + 0.5));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKET_COUNT; i++)
+    {
+        seen += m_buckets[i];
+        if (seen >= target)
+            return std::min(BucketUpperBound(i), m_max);
+    }
+    return m_max;
+}
+
+
+void OperationMetrics::Record(const std::string& operation, std::chrono::steady_clock::duration duration, bool failed)
+{
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto& entry = m_operations[operation];
+    entry.m_latency.Record((std::uint64_t)std::max<std::int64_t>(us, 0));
+    if (failed)
+        entry.m_failures++;
+}
+
+
+void OperationMetrics::Reset()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_operations.clear();
+}
+
+
+Ref<Metadata> OperationMetrics::ToMetadata() const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::map<std::string, Ref<Metadata>> operations;
+    for (const auto& [name, entry]: m_operations)
+    {
+        const auto& latency = entry.m_latency;
+        std::map<std::string, Ref<Metadata>> values;
+        values["count"] = new Metadata(latency.Count());
+        values["failures"] = new Metadata(entry.m_failures);
+        values["total"] = new Metadata(latency.Total());
+        values["min"] = new Metadata(latency.Min());
+        values["max"] = new Metadata(latency.Max());
+        values["p50"] = new Metadata(latency.Percentile(0.5));
+        values["p90"] = new Metadata(latency.Percentile(0.9));
+        values["p99"] = new Metadata(latency.Percentile(0.99));
+        operations[name] = new Metadata(values);
+    }
+    return new Metadata(operations);
+}
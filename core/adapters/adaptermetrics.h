@@ -0,0 +1,106 @@
+/*
+Copyright 2020-2022 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <string>
+#include "binaryninjaapi.h"
+
+namespace BinaryNinjaDebugger
+{
+	// A latency histogram in the style of HdrHistogram. Every power of two is split into 16 buckets, so a recorded
+	// value is off by at most 1/16 (about 6%) no matter how large it is, with a fixed amount of memory.
+	class LatencyHistogram
+	{
+		static constexpr std::size_t SUB_BUCKET_BITS = 4;
+		static constexpr std::size_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+		// Values up to 2^40 microseconds (about 12 days) are tracked, larger ones go into the last bucket
+		static constexpr std::size_t MAX_VALUE_BITS = 40;
+		static constexpr std::size_t BUCKET_COUNT = SUB_BUCKET_COUNT * (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1);
+
+		std::array<std::uint64_t, BUCKET_COUNT> m_buckets{};
+		std::uint64_t m_count{};
+		std::uint64_t m_total{};
+		std::uint64_t m_min{};
+		std::uint64_t m_max{};
+
+		static std::size_t BucketIndex(std::uint64_t value);
+		static std::uint64_t BucketUpperBound(std::size_t index);
+
+	public:
+		void Record(std::uint64_t value);
+		void Reset();
+
+		std::uint64_t Count() const { return m_count; }
+		std::uint64_t Total() const { return m_total; }
+		std::uint64_t Min() const { return m_min; }
+		std::uint64_t Max() const { return m_max; }
+		// The value that the given fraction, e.g., 0.99, of the recorded values are at or below
+		std::uint64_t Percentile(double fraction) const;
+	};
+
+
+	// The number of calls to each adapter operation, and how long they took, in microseconds
+	class OperationMetrics
+	{
+		struct Operation
+		{
+			LatencyHistogram m_latency;
+			std::uint64_t m_failures{};
+		};
+
+		mutable std::mutex m_mutex;
+		std::map<std::string, Operation> m_operations;
+
+	public:
+		void Record(const std::string& operation, std::chrono::steady_clock::duration duration, bool failed = false);
+		void Reset();
+
+		// {"ReadMemory": {"count": 12, "failures": 0, "total": 1520, "min": 80, "max": 310, "p50": 111, ...}, ...}
+		BinaryNinja::Ref<BinaryNinja::Metadata> ToMetadata() const;
+	};
+
+
+	// Times a call to the adapter until the end of the scope, e.g., "OperationTimer timer(metrics, "ReadMemory");"
+	// right before the call. The call fails if it throws.
+	class OperationTimer
+	{
+		OperationMetrics& m_metrics;
+		const char* m_operation;
+		std::chrono::steady_clock::time_point m_start;
+		int m_uncaughtExceptions;
+
+	public:
+		OperationTimer(OperationMetrics& metrics, const char* operation) :
+			m_metrics(metrics), m_operation(operation), m_start(std::chrono::steady_clock::now()),
+			m_uncaughtExceptions(std::uncaught_exceptions())
+		{}
+
+		~OperationTimer()
+		{
+			m_metrics.Record(m_operation, std::chrono::steady_clock::now() - m_start,
+				std::uncaught_exceptions() > m_uncaughtExceptions);
+		}
+
+		OperationTimer(const OperationTimer&) = delete;
+		OperationTimer& operator=(const OperationTimer&) = delete;
+	};
+};
@@ -0,0 +1,720 @@
+/*
+Copyright 2020-2022 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "agentexpression.h"
+#include <cctype>
+#include <stdexcept>
+#include "fmt/format.h"
+
+using namespace BinaryNinjaDebugger;
+
+namespace
+{
+    // gdbserver limits the stack of an agent expression to 100 entries
+    constexpr std::size_t AGENT_EXPRESSION_MAX_STACK = 100;
+    // The goto offsets are 16 bits
+    constexpr std::size_t AGENT_EXPRESSION_MAX_SIZE = 0xffff;
+
+    enum class TokenType
+    {
+        Number,
+        Identifier,
+        HitCount,
+        Operator,
+        End
+    };
+
+    struct Token
+    {
+        TokenType m_type;
+        std::string m_text;
+        std::uint64_t m_value;
+        std::size_t m_column;
+    };
+
+    [[noreturn]] void SyntaxError(const std::string& message, std::size_t column)
+    {
+        throw std::runtime_error(fmt::format("{} at column {}", message, column + 1));
+    }
+
+    std::vector<Token> Tokenize(const std::string& source)
+    {
+        static const char* operators[] = {
+            "||", "&&", "==", "!=", "<=", ">=", "<<", ">>",
+            "|", "^", "&", "<", ">", "+", "-", "*", "/", "%", "!", "~", "(", ")", "[", "]"
+        };
+
+        std::vector<Token> tokens;
+        std::size_t i = 0;
+        while (i < source.size())
+        {
+            const char c = source[i];
+            if (std::isspace(static_cast<unsigned char>(c)))
+            {
+                i++;
+                continue;
+            }
+
+            const std::size_t start = i;
+            if (std::isdigit(static_cast<unsigned char>(c)))
+            {
+                int base = 10;
+                if (c == '0' && i + 1 < source.size() && (source[i + 1] == 'x' || source[i + 1] == 'X'))
+                {
+                    base = 16;
+                    i += 2;
+                }
+
+                std::uint64_t value = 0;
+                std::size_t digits = 0;
+                for (; i < source.size() && std::isxdigit(static_cast<unsigned char>(source[i])); i++, digits++)
+                {
+                    const char d = source[i];
+                    const std::uint64_t digit = std::isdigit(static_cast<unsigned char>(d)) ? d - '0' : (std::tolower(d) - 'a' + 10);
+                    if (digit >= static_cast<std::uint64_t>(base))
+                        SyntaxError("Invalid digit", i);
+                    if (value > (UINT64_MAX - digit) / base)
+                        SyntaxError("Number too large", start);
+                    value = value * base + digit;
+                }
+                if (digits == 0)
+                    SyntaxError("Missing hex digits", start);
+                if (i < source.size() && (std::isalpha(static_cast<unsigned char>(source[i])) || source[i] == '_'))
+                    SyntaxError("Invalid number", start);
+
+                tokens.push_back({TokenType::Number, source.substr(start, i - start), value, start});
+                continue;
+            }
+
+            if (std::isalpha(static_cast<unsigned char>(c)) || c == '_' || c == '$')
+            {
+                i++;
+                while (i < source.size() && (std::isalnum(static_cast<unsigned char>(source[i])) || source[i] == '_' || source[i] == '.'))
+                    i++;
+
+                std::string text = source.substr(start, i - start);
+                if (text == "$hits")
+                {
+                    tokens.push_back({TokenType::HitCount, text, 0, start});
+                    continue;
+                }
+
+                // $rax and rax are the same register
+                if (text[0] == '$')
+                    text.erase(0, 1);
+                if (text.empty())
+                    SyntaxError("Expected a register name", start);
+
+                tokens.push_back({TokenType::Identifier, text, 0, start});
+                continue;
+            }
+
+            bool matched = false;
+            for (const char* op: operators)
+            {
+                const std::size_t length = std::char_traits<char>::length(op);
+                if (source.compare(i, length, op) == 0)
+                {
+                    tokens.push_back({TokenType::Operator, op, 0, start});
+                    i += length;
+                    matched = true;
+                    break;
+                }
+            }
+
+            if (!matched)
+                SyntaxError(fmt::format("Unexpected character '{}'", c), start);
+        }
+
+        tokens.push_back({TokenType::End, "", 0, source.size()});
+        return tokens;
+    }
+
+    // A recursive descent parser that emits the bytecode as it goes
+    class Compiler
+    {
+        const std::vector<Token>& m_tokens;
+        std::size_t m_position{};
+        const AgentExpression::RegisterResolver& m_resolveRegister;
+        std::uint16_t m_hitCountVariable;
+        bool m_traceMemory;
+        std::vector<std::uint8_t>& m_code;
+
+        const Token& Peek() const { return m_tokens[m_position]; }
+
+        bool Accept(const char* op)
+        {
+            const auto& token = Peek();
+            if (token.m_type != TokenType::Operator || token.m_text != op)
+                return false;
+            m_position++;
+            return true;
+        }
+
+        void Expect(const char* op)
+        {
+            if (!Accept(op))
+                SyntaxError(fmt::format("Expected '{}'", op), Peek().m_column);
+        }
+
+        void Emit(std::uint8_t op) { m_code.push_back(op); }
+
+        void Emit16(std::uint16_t value)
+        {
+            m_code.push_back(static_cast<std::uint8_t>(value >> 8));
+            m_code.push_back(static_cast<std::uint8_t>(value));
+        }
+
+        void EmitConstant(std::uint64_t value)
+        {
+            if (value <= UINT8_MAX)
+            {
+                Emit(AgentExpression::OpConst8);
+                Emit(static_cast<std::uint8_t>(value));
+                return;
+            }
+
+            std::size_t size = 8;
+            std::uint8_t op = AgentExpression::OpConst64;
+            if (value <= UINT16_MAX)
+            {
+                size = 2;
+                op = AgentExpression::OpConst16;
+            }
+            else if (value <= UINT32_MAX)
+            {
+                size = 4;
+                op = AgentExpression::OpConst32;
+            }
+
+            Emit(op);
+            for (std::size_t i = size; i > 0; i--)
+                Emit(static_cast<std::uint8_t>(value >> ((i - 1) * 8)));
+        }
+
+        // Emits a jump with a placeholder target, and returns the offset of the target to patch
+        std::size_t EmitJump(std::uint8_t op)
+        {
+            Emit(op);
+            const std::size_t offset = m_code.size();
+            Emit16(0);
+            return offset;
+        }
+
+        void PatchJump(std::size_t offset)
+        {
+            const std::size_t target = m_code.size();
+            if (target > AGENT_EXPRESSION_MAX_SIZE)
+                throw std::runtime_error("Condition too long");
+            m_code[offset] = static_cast<std::uint8_t>(target >> 8);
+            m_code[offset + 1] = static_cast<std::uint8_t>(target);
+        }
+
+        // a || b: if a is true, skip b and leave 1
+        void LogicalOr()
+        {
+            LogicalAnd();
+            while (Accept("||"))
+            {
+                const std::size_t taken = EmitJump(AgentExpression::OpIfGoto);
+                LogicalAnd();
+                Emit(AgentExpression::OpLogNot);
+                Emit(AgentExpression::OpLogNot);
+                const std::size_t done = EmitJump(AgentExpression::OpGoto);
+                PatchJump(taken);
+                EmitConstant(1);
+                PatchJump(done);
+            }
+        }
+
+        // a && b: if a is false, skip b and leave 0
+        void LogicalAnd()
+        {
+            BitwiseOr();
+            while (Accept("&&"))
+            {
+                Emit(AgentExpression::OpLogNot);
+                const std::size_t taken = EmitJump(AgentExpression::OpIfGoto);
+                BitwiseOr();
+                Emit(AgentExpression::OpLogNot);
+                Emit(AgentExpression::OpLogNot);
+                const std::size_t done = EmitJump(AgentExpression::OpGoto);
+                PatchJump(taken);
+                EmitConstant(0);
+                PatchJump(done);
+            }
+        }
+
+        void BitwiseOr()
+        {
+            BitwiseXor();
+            while (Accept("|"))
+            {
+                BitwiseXor();
+                Emit(AgentExpression::OpBitOr);
+            }
+        }
+
+        void BitwiseXor()
+        {
+            BitwiseAnd();
+            while (Accept("^"))
+            {
+                BitwiseAnd();
+                Emit(AgentExpression::OpBitXor);
+            }
+        }
+
+        void BitwiseAnd()
+        {
+            Equality();
+            while (Accept("&"))
+            {
+                Equality();
+                Emit(AgentExpression::OpBitAnd);
+            }
+        }
+
+        void Equality()
+        {
+            Relational();
+            while (true)
+            {
+                if (Accept("=="))
+                {
+                    Relational();
+                    Emit(AgentExpression::OpEqual);
+                }
+                else if (Accept("!="))
+                {
+                    Relational();
+                    Emit(AgentExpression::OpEqual);
+                    Emit(AgentExpression::OpLogNot);
+                }
+                else
+                {
+                    return;
+                }
+            }
+        }
+
+        // There is only less_unsigned, so the others swap the operands and/or negate the result
+        void Relational()
+        {
+            Shift();
+            while (true)
+            {
+                if (Accept("<="))
+                {
+                    Shift();
+                    Emit(AgentExpression::OpSwap);
+                    Emit(AgentExpression::OpLessUnsigned);
+                    Emit(AgentExpression::OpLogNot);
+                }
+                else if (Accept(">="))
+                {
+                    Shift();
+                    Emit(AgentExpression::OpLessUnsigned);
+                    Emit(AgentExpression::OpLogNot);
+                }
+                else if (Accept("<"))
+                {
+                    Shift();
+                    Emit(AgentExpression::OpLessUnsigned);
+                }
+                else if (Accept(">"))
+                {
+                    Shift();
+                    Emit(AgentExpression::OpSwap);
+                    Emit(AgentExpression::OpLessUnsigned);
+                }
+                else
+                {
+                    return;
+                }
+            }
+        }
+
+        void Shift()
+        {
+            Additive();
+            while (true)
+            {
+                if (Accept("<<"))
+                {
+                    Additive();
+                    Emit(AgentExpression::OpLsh);
+                }
+                else if (Accept(">>"))
+                {
+                    Additive();
+                    Emit(AgentExpression::OpRshUnsigned);
+                }
+                else
+                {
+                    return;
+                }
+            }
+        }
+
+        void Additive()
+        {
+            Multiplicative();
+            while (true)
+            {
+                if (Accept("+"))
+                {
+                    Multiplicative();
+                    Emit(AgentExpression::OpAdd);
+                }
+                else if (Accept("-"))
+                {
+                    Multiplicative();
+                    Emit(AgentExpression::OpSub);
+                }
+                else
+                {
+                    return;
+                }
+            }
+        }
+
+        void Multiplicative()
+        {
+            Unary();
+            while (true)
+            {
+                if (Accept("*"))
+                {
+                    Unary();
+                    Emit(AgentExpression::OpMul);
+                }
+                else if (Accept("/"))
+                {
+                    Unary();
+                    Emit(AgentExpression::OpDivUnsigned);
+                }
+                else if (Accept("%"))
+                {
+                    Unary();
+                    Emit(AgentExpression::OpRemUnsigned);
+                }
+                else
+                {
+                    return;
+                }
+            }
+        }
+
+        void Unary()
+        {
+            if (Accept("!"))
+            {
+                Unary();
+                Emit(AgentExpression::OpLogNot);
+            }
+            else if (Accept("~"))
+            {
+                Unary();
+                Emit(AgentExpression::OpBitNot);
+            }
+            else if (Accept("-"))
+            {
+                EmitConstant(0);
+                Unary();
+                Emit(AgentExpression::OpSub);
+            }
+            else
+            {
+                Primary();
+            }
+        }
+
+        void Dereference(std::uint8_t op)
+        {
+            Expect("[");
+            LogicalOr();
+            Expect("]");
+            if (m_traceMemory)
+            {
+                Emit(AgentExpression::OpTraceQuick);
+                Emit(static_cast<std::uint8_t>(std::size_t(1) << (op - AgentExpression::OpRef8)));
+            }
+            Emit(op);
+        }
+
+        void Primary()
+        {
+            const Token& token = Peek();
+            switch (token.m_type)
+            {
+            case TokenType::Number:
+                m_position++;
+                EmitConstant(token.m_value);
+                return;
+            case TokenType::HitCount:
+                m_position++;
+                Emit(AgentExpression::OpGetv);
+                Emit16(m_hitCountVariable);
+                return;
+            case TokenType::Identifier:
+            {
+                m_position++;
+                if (token.m_text == "u8")
+                    return Dereference(AgentExpression::OpRef8);
+                if (token.m_text == "u16")
+                    return Dereference(AgentExpression::OpRef16);
+                if (token.m_text == "u32")
+                    return Dereference(AgentExpression::OpRef32);
+                if (token.m_text == "u64")
+                    return Dereference(AgentExpression::OpRef64);
+
+                std::uint32_t regNum{};
+                if (!m_resolveRegister || !m_resolveRegister(token.m_text, regNum) || regNum > UINT16_MAX)
+                    SyntaxError(fmt::format("Unknown register '{}'", token.m_text), token.m_column);
+                Emit(AgentExpression::OpReg);
+                Emit16(static_cast<std::uint16_t>(regNum));
+                return;
+            }
+            case TokenType::Operator:
+                if (token.m_text == "[")
+                    return Dereference(AgentExpression::OpRef64);
+                if (Accept("("))
+                {
+                    LogicalOr();
+                    Expect(")");
+                    return;
+                }
+                break;
+            case TokenType::End:
+                SyntaxError("Unexpected end of condition", token.m_column);
+            }
+
+            SyntaxError(fmt::format("Unexpected '{}'", token.m_text), token.m_column);
+        }
+
+    public:
+        Compiler(const std::vector<Token>& tokens, const AgentExpression::RegisterResolver& resolveRegister,
+                 std::uint16_t hitCountVariable, bool traceMemory, std::vector<std::uint8_t>& code):
+            m_tokens(tokens), m_resolveRegister(resolveRegister), m_hitCountVariable(hitCountVariable),
+            m_traceMemory(traceMemory), m_code(code)
+        {}
+
+        void Compile()
+        {
+            LogicalOr();
+            if (Peek().m_type != TokenType::End)
+                SyntaxError(fmt::format("Unexpected '{}'", Peek().m_text), Peek().m_column);
+            Emit(AgentExpression::OpEnd);
+            if (m_code.size() > AGENT_EXPRESSION_MAX_SIZE)
+                throw std::runtime_error("Condition too long");
+        }
+    };
+}
+
+
+AgentExpression AgentExpression::Compile(const std::string& condition, const RegisterResolver& resolveRegister,
+                                         std::uint16_t hitCountVariable, bool traceMemory)
+{
+    const auto tokens = Tokenize(condition);
+
+    AgentExpression expression;
+    for (const auto& token: tokens)
+    {
+        if (token.m_type == TokenType::HitCount)
+        {
+            expression.m_usesHitCount = true;
+            break;
+        }
+    }
+
+    // Count this hit before evaluating the condition, so $hits is never 0 when it is read
+    if (expression.m_usesHitCount)
+    {
+        auto& code = expression.m_bytecode;
+        code.insert(code.end(), {OpGetv, static_cast<std::uint8_t>(hitCountVariable >> 8),
+                                 static_cast<std::uint8_t>(hitCountVariable), OpConst8, 1, OpAdd,
+                                 OpSetv, static_cast<std::uint8_t>(hitCountVariable >> 8),
+                                 static_cast<std::uint8_t>(hitCountVariable), OpPop});
+    }
+
+    Compiler(tokens, resolveRegister, hitCountVariable, traceMemory, expression.m_bytecode).Compile();
+    return expression;
+}
+
+
+bool AgentExpression::Evaluate(const Context& context, std::uint64_t& result) const
+{
+    std::vector<std::uint64_t> stack;
+    stack.reserve(16);
+    const auto& code = m_bytecode;
+    std::size_t pc = 0;
+
+    auto operand16 = [&](std::uint16_t& value) -> bool {
+        if (pc + 2 > code.size())
+            return false;
+        value = (static_cast<std::uint16_t>(code[pc]) << 8) | code[pc + 1];
+        pc += 2;
+        return true;
+    };
+
+    // Guards against a malformed program looping forever
+    std::size_t steps = 0;
+    while (pc < code.size() && steps++ < code.size() * 64)
+    {
+        const std::uint8_t op = code[pc++];
+
+        std::size_t needed = 0;
+        switch (op)
+        {
+        case OpAdd: case OpSub: case OpMul: case OpDivUnsigned: case OpRemUnsigned: case OpLsh: case OpRshUnsigned:
+        case OpBitAnd: case OpBitOr: case OpBitXor: case OpEqual: case OpLessUnsigned: case OpSwap:
+            needed = 2;
+            break;
+        case OpLogNot: case OpBitNot: case OpRef8: case OpRef16: case OpRef32: case OpRef64: case OpIfGoto:
+        case OpDup: case OpPop: case OpSetv: case OpEnd: case OpTraceQuick:
+            needed = 1;
+            break;
+        default:
+            break;
+        }
+        if (stack.size() < needed)
+            return false;
+
+        switch (op)
+        {
+        case OpAdd: case OpSub: case OpMul: case OpDivUnsigned: case OpRemUnsigned: case OpLsh: case OpRshUnsigned:
+        case OpBitAnd: case OpBitOr: case OpBitXor: case OpEqual: case OpLessUnsigned:
+        {
+            const std::uint64_t b = stack.back();
+            stack.pop_back();
+            std::uint64_t& a = stack.back();
+            switch (op)
+            {
+            case OpAdd: a += b; break;
+            case OpSub: a -= b; break;
+            case OpMul: a *= b; break;
+            case OpDivUnsigned:
+                if (b == 0)
+                    return false;
+                a /= b;
+                break;
+            case OpRemUnsigned:
+                if (b == 0)
+                    return false;
+                a %= b;
+                break;
+            case OpLsh: a = b >= 64 ? 0 : a << b; break;
+            case OpRshUnsigned: a = b >= 64 ? 0 : a >> b; break;
+            case OpBitAnd: a &= b; break;
+            case OpBitOr: a |= b; break;
+            case OpBitXor: a ^= b; break;
+            case OpEqual: a = a == b; break;
+            case OpLessUnsigned: a = a < b; break;
+            default: break;
+            }
+            break;
+        }
+        case OpLogNot:
+            stack.back() = !stack.back();
+            break;
+        case OpTraceQuick:
+            // There is no trace frame to record the memory in when the adapter evaluates the expression
+            if (pc >= code.size())
+                return false;
+            pc++;
+            break;
+        case OpBitNot:
+            stack.back() = ~stack.back();
+            break;
+        case OpRef8: case OpRef16: case OpRef32: case OpRef64:
+        {
+            const std::size_t size = std::size_t(1) << (op - OpRef8);
+            std::uint64_t value{};
+            if (!context.readMemory || !context.readMemory(stack.back(), size, value))
+                return false;
+            stack.back() = value;
+            break;
+        }
+        case OpIfGoto: case OpGoto:
+        {
+            std::uint16_t target{};
+            if (!operand16(target))
+                return false;
+            bool taken = true;
+            if (op == OpIfGoto)
+            {
+                taken = stack.back() != 0;
+                stack.pop_back();
+            }
+            if (taken)
+                pc = target;
+            break;
+        }
+        case OpConst8: case OpConst16: case OpConst32: case OpConst64:
+        {
+            const std::size_t size = std::size_t(1) << (op - OpConst8);
+            if (pc + size > code.size())
+                return false;
+            std::uint64_t value = 0;
+            for (std::size_t i = 0; i < size; i++)
+                value = (value << 8) | code[pc + i];
+            pc += size;
+            stack.push_back(value);
+            break;
+        }
+        case OpReg:
+        {
+            std::uint16_t regNum{};
+            std::uint64_t value{};
+            if (!operand16(regNum) || !context.readRegister || !context.readRegister(regNum, value))
+                return false;
+            stack.push_back(value);
+            break;
+        }
+        case OpEnd:
+            result = stack.back();
+            return true;
+        case OpDup:
+            stack.push_back(stack.back());
+            break;
+        case OpPop:
+            stack.pop_back();
+            break;
+        case OpSwap:
+            std::swap(stack[stack.size() - 1], stack[stack.size() - 2]);
+            break;
+        case OpGetv: case OpSetv:
+        {
+            std::uint16_t variable{};
+            if (!operand16(variable) || !context.variables)
+                return false;
+            if (op == OpGetv)
+                stack.push_back((*context.variables)[variable]);
+            else
+                (*context.variables)[variable] = stack.back();
+            break;
+        }
+        default:
+            return false;
+        }
+
+        if (stack.size() > AGENT_EXPRESSION_MAX_STACK)
+            return false;
+    }
+
+    return false;
+}
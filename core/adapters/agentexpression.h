@@ -0,0 +1,103 @@
+/*
+Copyright 2020-2022 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace BinaryNinjaDebugger
+{
+	// A breakpoint condition compiled to GDB agent expression bytecode. The same bytecode is sent to the backend with
+	// the Z0 packet, or evaluated by the adapter when the backend cannot evaluate conditions.
+	//
+	// The language works on unsigned 64-bit values:
+	//   numbers       16, 0x10
+	//   registers     rax, $rax
+	//   memory        u8[addr], u16[addr], u32[addr], u64[addr], and [addr] for u64
+	//   hit count     $hits, the number of times the breakpoint is hit, including this one
+	//   operators     || && | ^ & == != < <= > >= << >> + - * / % ! ~ and unary -, with the C precedence
+	class AgentExpression
+	{
+	public:
+		enum Opcode : std::uint8_t
+		{
+			OpAdd = 0x02,
+			OpSub = 0x03,
+			OpMul = 0x04,
+			OpDivUnsigned = 0x06,
+			OpRemUnsigned = 0x08,
+			OpLsh = 0x09,
+			OpRshUnsigned = 0x0b,
+			OpTraceQuick = 0x0d,
+			OpLogNot = 0x0e,
+			OpBitAnd = 0x0f,
+			OpBitOr = 0x10,
+			OpBitXor = 0x11,
+			OpBitNot = 0x12,
+			OpEqual = 0x13,
+			OpLessUnsigned = 0x15,
+			OpRef8 = 0x17,
+			OpRef16 = 0x18,
+			OpRef32 = 0x19,
+			OpRef64 = 0x1a,
+			OpIfGoto = 0x20,
+			OpGoto = 0x21,
+			OpConst8 = 0x22,
+			OpConst16 = 0x23,
+			OpConst32 = 0x24,
+			OpConst64 = 0x25,
+			OpReg = 0x26,
+			OpEnd = 0x27,
+			OpDup = 0x28,
+			OpPop = 0x29,
+			OpSwap = 0x2b,
+			OpGetv = 0x2c,
+			OpSetv = 0x2d,
+		};
+
+		// Maps a register name to its number in the target description
+		using RegisterResolver = std::function<bool(const std::string& name, std::uint32_t& regNum)>;
+
+		struct Context
+		{
+			std::function<bool(std::uint32_t regNum, std::uint64_t& value)> readRegister;
+			std::function<bool(std::uint64_t address, std::size_t size, std::uint64_t& value)> readMemory;
+			// The trace state variables, which hold the hit counts
+			std::unordered_map<std::uint16_t, std::uint64_t>* variables{};
+		};
+
+	private:
+		std::vector<std::uint8_t> m_bytecode{};
+		bool m_usesHitCount{};
+
+	public:
+		// Throws std::runtime_error with the column of the problem if the condition is not valid. The hit count is
+		// kept in the trace state variable hitCountVariable. With traceMemory, the memory that the expression reads is
+		// recorded in the trace frame, for the collect actions of the tracepoints.
+		static AgentExpression Compile(const std::string& condition, const RegisterResolver& resolveRegister,
+									   std::uint16_t hitCountVariable, bool traceMemory = false);
+
+		const std::vector<std::uint8_t>& GetBytecode() const { return m_bytecode; }
+		bool UsesHitCount() const { return m_usesHitCount; }
+
+		// Returns false if the expression reads a register or memory that is not available, like the backend does
+		bool Evaluate(const Context& context, std::uint64_t& result) const;
+	};
+};
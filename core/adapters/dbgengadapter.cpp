@@ -28,6 +28,7 @@ limitations under the License.
 #include "dbgengadapter.h"
 #include "../../cli/log.h"
 #include "queuedadapter.h"
+#include "meteredadapter.h"
 #include "../debuggerevent.h"
 #include "shlobj_core.h"
 #pragma warning(push)
@@ -1263,7 +1264,7 @@ LocalDbgEngAdapterType::LocalDbgEngAdapterType(): DebugAdapterType("DBGENG")
 DebugAdapter* LocalDbgEngAdapterType::Create(BinaryNinja::BinaryView *data)
 {
     // TODO: someone should free this.
-    return new DbgEngAdapter(data);
+    return new MeteredAdapter(new DbgEngAdapter(data));
 }
 
 
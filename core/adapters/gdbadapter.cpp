@@ -15,6 +15,7 @@ limitations under the License.
 */
 
 #include "gdbadapter.h"
+#include "hexcodec.h"
 #include <memory>
 #include <cstring>
 #ifdef WIN32
@@ -27,6 +28,8 @@ limitations under the License.
 #include <spawn.h>
 #endif
 #include <csignal>
+
+extern char** environ;
 #endif
 #include <algorithm>
 #include <string>
@@ -35,8 +38,12 @@ limitations under the License.
 #include <cstdio>
 #include <iostream>
 #include <string_view>
-#include <regex>
+#include <charconv>
 #include <stdexcept>
+#include <future>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
 #include <pugixml/pugixml.hpp>
 #include <binaryninjacore.h>
 #include <binaryninjaapi.h>
@@ -120,45 +127,58 @@ bool GdbAdapter::ExecuteWithArgs(const std::string &path, const std::string &arg
 	if ( gdb_server_path.empty() )
 		return false;
 
-    this->m_socket = new Socket(AF_INET, SOCK_STREAM, 0);
+	if (!configs.requestTerminalEmulator && Settings::Instance()->Get<bool>("debugger.gdbServerStdio"))
+	{
+		// gdbserver talks over its stdin and stdout, so there is no port to pick. The target gets /dev/null as its
+		// stdin, and its output goes to the stderr of gdbserver.
+		std::vector<std::string> serverArgs = {"--once", "--no-startup-with-shell", "-", path};
+		if (!args.empty())
+			serverArgs.push_back(args);
+
+		auto transport = std::make_unique<StdioTransport>();
+		if (!transport->Launch(gdb_server_path, serverArgs))
+		{
+			LogWarn("failed to launch gdbserver");
+			return false;
+		}
+		return this->InitializeConnection(std::move(transport));
+	}
+
+	// Otherwise the connection goes over a loopback port, which leaves the standard streams of gdbserver to the
+	// target, so it can read from and write to the terminal
+	const auto port = TcpTransport::FindFreePort();
+	if (port == 0)
+		return false;
 
-    const auto host_with_port = fmt::format("127.0.0.1:{}", this->m_socket->GetPort());
-	char* arg[] = {(char*)gdb_server_path.c_str(),
-				   "--once", "--no-startup-with-shell",
-				   (char*)host_with_port.c_str(),
-				   (char*) path.c_str(),
-				   (char*)args.c_str(),
-				   NULL};
+	const auto host_with_port = fmt::format("127.0.0.1:{}", port);
+	std::vector<std::string> serverArgs = {gdb_server_path, "--once", "--no-startup-with-shell", host_with_port, path};
+	if (!args.empty())
+		serverArgs.push_back(args);
 
-	pid_t serverPid;
 	if (!configs.requestTerminalEmulator)
 	{
-		// Calling posix_spawn is fine here. The only problem is gdbserver will occupy the terminal, and we cannot use
-		// the cli debugger. However, posix_spawn actually supports file actions, soe can properly redirect
-		// stdin/out/err, so that the cli debugger also works.
-		int s = posix_spawn(&serverPid, gdb_server_path.c_str(), nullptr, nullptr, arg, nullptr);
-		if (s != 0)
+		std::vector<char*> argv;
+		for (const auto& arg: serverArgs)
+			argv.push_back((char*)arg.c_str());
+		argv.push_back(nullptr);
+
+		pid_t serverPid;
+		if (posix_spawn(&serverPid, gdb_server_path.c_str(), nullptr, nullptr, argv.data(), environ) != 0)
 		{
-			LogWarn("posix_spawn failed");
+			LogWarn("failed to launch gdbserver");
 			return false;
 		}
 	}
 	else
 	{
-		std::string cmd{};
-		for (const auto& s : arg)
-		{
-			if (s != NULL)
-			{
-				cmd.append(s);
-				cmd.append(" ");
-			}
-		}
+		std::string cmd;
+		for (const auto& arg: serverArgs)
+			cmd += arg + " ";
 		std::string fullCmd = fmt::format("x-terminal-emulator -e {}", cmd);
 		system(fullCmd.c_str());
 	}
 
-    bool ret =  this->Connect("127.0.0.1", this->m_socket->GetPort());
+    bool ret =  this->Connect("127.0.0.1", port);
     return ret;
 #endif
 }
@@ -173,38 +193,217 @@ bool GdbAdapter::Attach(std::uint32_t pid)
     if ( gdb_server_path.empty() )
         return false;
 
-    this->m_socket = new Socket(AF_INET, SOCK_STREAM, 0);
+    auto transport = std::make_unique<StdioTransport>();
+    if ( !transport->Launch(gdb_server_path, {"--attach", "-", fmt::format("{}", pid)}) )
+    {
+        LogWarn("failed to launch gdbserver");
+        return false;
+    }
+
+    return this->InitializeConnection(std::move(transport));
+#endif
+}
 
-    const auto host_with_port = fmt::format("127.0.0.1:{}", this->m_socket->GetPort());
-	char* arg[] = {(char*)gdb_server_path.c_str(),
-				   "--attach",
-				   (char*)host_with_port.c_str(),
-				   (char*)fmt::format("{}", pid).c_str(),
-				   NULL};
+void GdbAdapter::ParseRegisterFeature(const pugi::xml_node& feature, std::vector<RegisterInfo>& registers)
+{
+    using namespace std::literals::string_literals;
 
-	pid_t serverPid;
+    for (auto reg_child = feature.child("reg"); reg_child; reg_child = reg_child.next_sibling("reg"))
+    {
+        RegisterInfo register_info{};
+        // A register without a regnum follows the previous register
+        register_info.m_regNum = registers.empty() ? 0 : registers.back().m_regNum + 1;
 
-	// Calling posix_spawn is fine here. The only problem is gdbserver will occupy the terminal, and we cannot use
-	// the cli debugger. However, posix_spawn actually supports file actions, soe can properly redirect
-	// stdin/out/err, so that the cli debugger also works.
-	int s = posix_spawn(&serverPid, gdb_server_path.c_str(), nullptr, nullptr, arg, nullptr);
-	if (s != 0)
-	{
-		LogWarn("posix_spawn failed");
-		return false;
-	}
+        for (auto reg_attribute = reg_child.first_attribute(); reg_attribute; reg_attribute = reg_attribute.next_attribute())
+        {
+            if (reg_attribute.name() == "name"s )
+                register_info.m_name = reg_attribute.value();
+            else if (reg_attribute.name() == "bitsize"s )
+                register_info.m_bitSize = reg_attribute.as_uint();
+            else if (reg_attribute.name() == "regnum"s)
+                register_info.m_regNum = reg_attribute.as_uint();
+        }
 
-    bool ret =  this->Connect("127.0.0.1", this->m_socket->GetPort());
-    return ret;
-#endif
+        if ( !register_info.m_name.empty() )
+            registers.push_back(std::move(register_info));
+    }
+}
+
+
+void GdbAdapter::BuildRegisterLayout(std::vector<RegisterInfo> registers)
+{
+    // The g packet has the registers in the order of their numbers
+    std::stable_sort(registers.begin(), registers.end(), [](const RegisterInfo& lhs, const RegisterInfo& rhs) {
+        return lhs.m_regNum < rhs.m_regNum;
+    });
+
+    this->m_registerLayout = std::move(registers);
+    this->m_registerIndexByName.clear();
+    this->m_registerIndexByNumber.clear();
+
+    std::uint32_t offset{};
+    for ( std::size_t index{}; index < this->m_registerLayout.size(); index++ ) {
+        auto& register_info = this->m_registerLayout[index];
+        register_info.m_offset = offset;
+        offset += register_info.m_bitSize / 8;
+
+        this->m_registerIndexByName[register_info.m_name] = index;
+        if ( register_info.m_regNum >= this->m_registerIndexByNumber.size() )
+            this->m_registerIndexByNumber.resize(register_info.m_regNum + 1, SIZE_MAX);
+        this->m_registerIndexByNumber[register_info.m_regNum] = index;
+    }
+
+    this->m_registerBlock.assign(offset, 0);
+    this->m_registerValid.assign(this->m_registerLayout.size(), false);
+    this->m_registerSnapshotComplete = false;
+}
+
+
+const GdbAdapter::RegisterInfo* GdbAdapter::FindRegister(const std::string& name) const
+{
+    const auto iter = this->m_registerIndexByName.find(name);
+    if ( iter == this->m_registerIndexByName.end() )
+        return nullptr;
+    return &this->m_registerLayout[iter->second];
+}
+
+
+const GdbAdapter::RegisterInfo* GdbAdapter::FindRegister(std::uint32_t regNum) const
+{
+    if ( (regNum >= this->m_registerIndexByNumber.size()) || (this->m_registerIndexByNumber[regNum] == SIZE_MAX) )
+        return nullptr;
+    return &this->m_registerLayout[this->m_registerIndexByNumber[regNum]];
+}
+
+
+// FNV-1a, which is stable across builds and platforms, unlike std::hash
+static std::uint64_t HashString(const std::string& data, std::uint64_t hash = 0xcbf29ce484222325)
+{
+    for ( const auto c : data )
+    {
+        hash ^= static_cast<std::uint8_t>(c);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+
+// The cache is only an optimization, so failing to write it is not an error. The file is written under a name of its
+// own and renamed into place, so neither an interrupted write nor another session writing the same file at the same
+// time leaves a truncated file behind.
+static void WriteCacheFile(const std::string& path, const char* data, std::size_t size)
+{
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+    const auto unique = std::hash<std::thread::id>{}(std::this_thread::get_id())
+        ^ static_cast<std::size_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    const auto temp_path = fmt::format("{}.{:x}.part", path, unique);
+    bool written;
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        written = static_cast<bool>(file.write(data, size));
+    }
+
+    if ( written )
+        std::filesystem::rename(temp_path, path, error);
+    if ( !written || error )
+        std::filesystem::remove(temp_path, error);
+}
+
+
+void GdbAdapter::ResolveXmlIncludes(pugi::xml_node node, std::size_t depth)
+{
+    using namespace std::literals::string_literals;
+
+    if ( depth > 8 )
+        throw std::runtime_error("target description includes are nested too deeply");
+
+    for ( auto child = node.first_child(); child; ) {
+        const auto next = child.next_sibling();
+        if ( child.name() == "xi:include"s ) {
+            // Replace the include with the root element of the included document, usually a <feature>
+            const std::string href = child.attribute("href").value();
+            const auto xml = this->m_rspConnector.GetXml(href);
+            pugi::xml_document included{};
+            if ( !included.load_string(xml.c_str()) )
+                throw std::runtime_error(fmt::format("failed to parse {}", href));
+
+            ResolveXmlIncludes(included.document_element(), depth + 1);
+            node.insert_copy_before(included.document_element(), child);
+            node.remove_child(child);
+        }
+        else {
+            ResolveXmlIncludes(child, depth + 1);
+        }
+        child = next;
+    }
 }
 
+
+std::string GdbAdapter::GetTargetDescriptionCachePath(const std::string& targetXml)
+{
+    // The servers are told apart by their qSupported features, so a cached description is not used for a different
+    // server build. The hash of target.xml covers the rest.
+    auto hash = HashString(targetXml);
+    for ( const auto& capability : this->m_rspConnector.GetServerCapabilities() )
+        hash = HashString(capability + ";", hash);
+
+    const auto directory = std::filesystem::path(GetUserDirectory()) / "debugger" / "target-descriptions";
+    return (directory / fmt::format("{:016x}.xml", hash)).string();
+}
+
+
+const std::string& GdbAdapter::GetTargetDescription()
+{
+    if ( !this->m_targetDescription.empty() )
+        return this->m_targetDescription;
+
+    const auto xml = this->m_rspConnector.GetXml("target.xml");
+    // Most of gdbserver's description is in the included files, so the cache saves those transfers on reconnects
+    if ( xml.find("xi:include") == std::string::npos ) {
+        this->m_targetDescription = xml;
+        return this->m_targetDescription;
+    }
+
+    const auto cache_path = this->GetTargetDescriptionCachePath(xml);
+    std::ifstream cached(cache_path, std::ios::binary);
+    if ( cached ) {
+        std::ostringstream contents;
+        contents << cached.rdbuf();
+        cached.close();
+
+        // A file that does not parse, e.g., one written by an older version that was cut short, is fetched again
+        pugi::xml_document cachedDoc{};
+        if ( cachedDoc.load_string(contents.str().c_str()) && cachedDoc.document_element() ) {
+            this->m_targetDescription = contents.str();
+            return this->m_targetDescription;
+        }
+        std::error_code error;
+        std::filesystem::remove(cache_path, error);
+    }
+
+    pugi::xml_document doc{};
+    if ( !doc.load_string(xml.c_str()) )
+        throw std::runtime_error("failed to parse target.xml");
+    ResolveXmlIncludes(doc, 0);
+
+    std::ostringstream assembled;
+    doc.save(assembled, "  ");
+    this->m_targetDescription = assembled.str();
+
+    WriteCacheFile(cache_path, this->m_targetDescription.data(), this->m_targetDescription.size());
+
+    return this->m_targetDescription;
+}
+
+
 bool GdbAdapter::LoadRegisterInfo()
 {
     if (m_isTargetRunning)
         return false;
 
-    const auto xml = this->m_rspConnector.GetXml("target.xml");
+    const auto& xml = this->GetTargetDescription();
 
     pugi::xml_document doc{};
     const auto parse_result = doc.load_string(xml.c_str());
@@ -213,6 +412,7 @@ bool GdbAdapter::LoadRegisterInfo()
 
     std::string architecture{};
     std::string os_abi{};
+    std::vector<RegisterInfo> registers{};
     for (auto node = doc.first_child().child("architecture"); node; node = node.next_sibling())
     {
         using namespace std::literals::string_literals;
@@ -223,77 +423,53 @@ bool GdbAdapter::LoadRegisterInfo()
             os_abi = node.child_value();
 
         if ( node.name() == "feature"s )
-        {
-            for (auto reg_child = node.child("reg"); reg_child; reg_child = reg_child.next_sibling())
-            {
-                std::string register_name{};
-                RegisterInfo register_info{};
-
-                for (auto reg_attribute = reg_child.attribute("name"); reg_attribute; reg_attribute = reg_attribute.next_attribute())
-                {
-                    if (reg_attribute.name() == "name"s )
-                        register_name = reg_attribute.value();
-                    else if (reg_attribute.name() == "bitsize"s )
-                        register_info.m_bitSize = reg_attribute.as_uint();
-                    else if (reg_attribute.name() == "regnum"s)
-                        register_info.m_regNum = reg_attribute.as_uint();
-                }
-
-                this->m_registerInfo[register_name] = register_info;
-            }
-        }
-    }
-
-    std::unordered_map<std::uint32_t, std::string> id_name{};
-    std::unordered_map<std::uint32_t, std::uint32_t> id_width{};
-
-    for ( auto [key, value] : this->m_registerInfo ) {
-        id_name[value.m_regNum] = key;
-        id_width[value.m_regNum] = value.m_bitSize;
-    }
-
-    std::size_t max_id{};
-    for ( auto [key, value] : this->m_registerInfo )
-        max_id += value.m_regNum;
-
-    std::size_t offset{};
-    for ( std::size_t index{}; index < max_id; index++ ) {
-        if ( !id_width[index] )
-            break;
-
-        const auto name = id_name[index];
-        this->m_registerInfo[name].m_offset = offset;
-        offset += id_width[index];
+            ParseRegisterFeature(node, registers);
     }
 
+    this->BuildRegisterLayout(std::move(registers));
     return true;
 }
 
 bool GdbAdapter::Connect(const std::string& server, std::uint32_t port)
 {
-    bool connected = false;
+    std::unique_ptr<Transport> transport;
     for ( std::uint8_t index{}; index < 4; index++ ) {
-        this->m_socket = new Socket(AF_INET, SOCK_STREAM, 0, port);
-
-        sockaddr_in address{};
-        address.sin_family = AF_INET;
-        address.sin_addr.s_addr = inet_addr(server.c_str());
-        address.sin_port = htons(port);
-
-        if (this->m_socket->Connect(address)) {
-            connected = true;
-            break;
+#ifndef WIN32
+        // "unix:/path/to/socket" connects to a server listening on a Unix domain socket, and the port is ignored
+        if ( server.rfind("unix:", 0) == 0 ) {
+            auto unixTransport = std::make_unique<UnixSocketTransport>();
+            if ( unixTransport->Connect(server.substr(5)) ) {
+                transport = std::move(unixTransport);
+                break;
+            }
+        }
+        else
+#endif
+        {
+            auto tcpTransport = std::make_unique<TcpTransport>();
+            if ( tcpTransport->Connect(server, port) ) {
+                transport = std::move(tcpTransport);
+                break;
+            }
         }
 
         std::this_thread::sleep_for(std::chrono::milliseconds(500));
     }
 
-    if ( !connected ) {
+    if ( !transport ) {
         printf("failed to connect to %s:%d!\n", server.c_str(), port);
         return false;
     }
 
-    this->m_rspConnector = RspConnector(this->m_socket);
+    return this->InitializeConnection(std::move(transport));
+}
+
+bool GdbAdapter::InitializeConnection(std::unique_ptr<Transport> transport)
+{
+    this->m_transport = std::move(transport);
+    this->m_rspConnector = RspConnector(this->m_transport.get(), &this->m_rspStatistics);
+    this->m_targetDescription.clear();
+    this->InvalidateModuleCache();
     this->m_rspConnector.TransmitAndReceive(RspData("Hg0"));
     this->m_rspConnector.NegotiateCapabilities(
             { "swbreak+", "hwbreak+", "qRelocInsn+", "fork-events+", "vfork-events+", "exec-events+",
@@ -301,10 +477,38 @@ bool GdbAdapter::Connect(const std::string& server, std::uint32_t port)
     if ( !this->LoadRegisterInfo() )
         return false;
 
+    this->NegotiateMemoryTransfer();
+
+    // The reply lists the supported actions, e.g., "vCont;c;C;s;S;t;r"
+    const auto actions = RspConnector::Split(this->m_rspConnector.TransmitAndReceive(RspData("vCont?")).AsString(), ";");
+    this->m_rangeStepping = std::find(actions.begin(), actions.end(), "r") != actions.end();
+
+    this->m_nonStop = false;
+    this->m_stoppedThreads.clear();
+    if ( this->m_nonStopRequested ) {
+        if ( this->m_rspConnector.HasCapability("QNonStop")
+             && (this->m_rspConnector.TransmitAndReceive(RspData("QNonStop:1")).AsString() == "OK") )
+            this->m_nonStop = true;
+        else
+            LogWarn("the backend does not support the non-stop mode, using the all-stop mode");
+    }
+
     const auto reply = this->m_rspConnector.TransmitAndReceive(RspData("?"));
-    auto map = RspConnector::PacketToUnorderedMap(reply);
+    if ( this->m_nonStop ) {
+        // "?" reports one stopped thread and vStopped the rest. OK means that no thread is stopped.
+        if ( reply.AsString() != "OK" ) {
+            this->RecordNonStopStop(reply, true);
+            this->DrainNonStopStops();
+        }
+        m_isTargetRunning = false;
+        return true;
+    }
+
+    RspStopReply stop_reply{};
+    stop_reply.Parse(std::string_view(static_cast<const char*>(reply.m_data.GetData()), reply.m_data.GetLength()));
 
-    this->m_lastActiveThreadId = map["thread"];
+    this->m_lastActiveThreadId = stop_reply.m_threadId;
+    this->LoadExpeditedRegisters(stop_reply);
 
     m_isTargetRunning = false;
     return true;
@@ -313,23 +517,78 @@ bool GdbAdapter::Connect(const std::string& server, std::uint32_t port)
 void GdbAdapter::Detach()
 {
     this->m_rspConnector.SendPayload(RspData("D"));
-    this->m_socket->Kill();
+    this->m_transport->Kill();
     m_isTargetRunning = false;
 }
 
 void GdbAdapter::Quit()
 {
     this->m_rspConnector.SendPayload(RspData("k"));
-    this->m_socket->Kill();
+    this->m_transport->Kill();
     m_isTargetRunning = false;
 }
 
-std::vector<DebugThread> GdbAdapter::GetThreadList()
+// Decode a register value sent as hex bytes in the target byte order, e.g., the reply to a p packet. Returns false if
+// the reply is an error, or the register is not available.
+bool GdbAdapter::DecodeRegisterValue(const std::string& reply, std::size_t bitSize, std::uintptr_t& value)
 {
-    if (m_isTargetRunning)
+    const auto size = std::min(bitSize / 8, sizeof(value));
+    std::uint8_t bytes[sizeof(value)];
+    if ( (size == 0) || (reply.size() < 2 * size) )
+        return false;
+    if ( !HexCodec::Decode(reply.data(), size, bytes) )
+        return false;
+
+    // The registers are in the target byte order, which is little endian
+    value = 0;
+    for ( std::size_t i = 0; i < size; i++ )
+        value |= static_cast<std::uintptr_t>(bytes[i]) << (8 * i);
+    return true;
+}
+
+
+bool GdbAdapter::ParseThreadId(const std::string& text, std::uint32_t& tid)
+{
+    // Either "tid", or "ppid.tid" when the multiprocess extensions are enabled
+    std::string_view id = text;
+    if ( !id.empty() && (id[0] == 'p') )
+    {
+        const auto dot = id.find('.');
+        if ( dot == std::string_view::npos )
+            return false;
+        id.remove_prefix(dot + 1);
+    }
+
+    std::uint64_t value{};
+    if ( !RspTokenizer::ParseHex(id, value) )
+        return false;
+    tid = static_cast<std::uint32_t>(value);
+    return true;
+}
+
+
+std::vector<DebugThread> GdbAdapter::ReadThreadListXfer()
+{
+    // <threads><thread id="p1c5f.1c5f" core="3" name="a.out"/>...</threads>
+    const auto xml = this->m_rspConnector.ReadXfer("threads", "");
+    pugi::xml_document doc{};
+    if ( !doc.load_string(xml.c_str()) )
         return {};
 
-    int internal_thread_index{};
+    std::vector<DebugThread> threads{};
+    for ( auto node = doc.child("threads").child("thread"); node; node = node.next_sibling("thread") ) {
+        std::uint32_t tid{};
+        if ( !ParseThreadId(node.attribute("id").value(), tid) )
+            return {};
+        threads.emplace_back(tid);
+    }
+
+    return threads;
+}
+
+
+std::vector<DebugThread> GdbAdapter::ReadThreadListPaged()
+{
     std::vector<DebugThread> threads{};
 
     auto reply = this->m_rspConnector.TransmitAndReceive(RspData("qfThreadInfo"));
@@ -340,19 +599,85 @@ std::vector<DebugThread> GdbAdapter::GetThreadList()
         const auto shortened_string =
                 reply.AsString().substr(1);
         const auto tids = RspConnector::Split(shortened_string, ",");
-        for ( const auto& tid : tids )
-            threads.emplace_back(std::stoi(tid, nullptr, 16), internal_thread_index++);
+        for ( const auto& tid_string : tids ) {
+            std::uint32_t tid{};
+            if ( !ParseThreadId(tid_string, tid) )
+                throw std::runtime_error("thread list failed?");
+            threads.emplace_back(tid);
+        }
 
         reply = this->m_rspConnector.TransmitAndReceive(RspData("qsThreadInfo"));
     }
 
-    const auto current_thread = this->GetActiveThread();
-    for (auto& thread : threads) {
-        this->SetActiveThread(thread);
-        thread.m_rip = GetInstructionOffset();
+    return threads;
+}
+
+
+void GdbAdapter::ReadThreadInstructionOffsets(std::vector<DebugThread>& threads)
+{
+    const auto ip_register = this->FindRegister(this->GetInstructionPointerRegisterName());
+    if ( !ip_register )
+        throw std::runtime_error("instruction pointer register does not exist in target");
+
+    // The registers of the running threads cannot be read in the non-stop mode
+    std::vector<std::size_t> stopped{};
+    for ( std::size_t i = 0; i < threads.size(); i++ ) {
+        if ( !this->m_nonStop || this->m_stoppedThreads.count(threads[i].m_tid) )
+            stopped.push_back(i);
+    }
+
+    // Select every thread and read its instruction pointer. The requests are pipelined, so this costs about one round
+    // trip rather than several per thread.
+    RspPipeline pipeline(this->m_rspConnector);
+    std::vector<std::future<RspData>> replies{};
+    for ( const auto i : stopped ) {
+        replies.push_back(pipeline.Queue(RspData(string("Hg{:x}"), threads[i].m_tid)));
+        replies.push_back(pipeline.Queue(RspData(string("p{:x}"), ip_register->m_regNum)));
+    }
+    // Restore the thread that the register packets operate on
+    replies.push_back(pipeline.Queue(RspData(string("Hg{:x}"), this->m_lastActiveThreadId)));
+
+    std::vector<std::size_t> unresolved{};
+    for ( std::size_t j = 0; j < stopped.size(); j++ ) {
+        const auto i = stopped[j];
+        if ( replies[2 * j].get().AsString() != "OK" )
+            throw std::runtime_error("failed to set thread");
+        if ( !DecodeRegisterValue(replies[2 * j + 1].get().AsString(), ip_register->m_bitSize, threads[i].m_rip) )
+            unresolved.push_back(i);
+    }
+    if ( replies.back().get().AsString() != "OK" )
+        throw std::runtime_error("failed to set thread");
+
+    // The backend does not support the p packet, or cannot read the register on its own
+    if ( !unresolved.empty() ) {
+        const auto current_thread = this->GetActiveThreadId();
+        for ( const auto i : unresolved ) {
+            this->SetActiveThread(threads[i]);
+            threads[i].m_rip = GetInstructionOffset();
+        }
+        this->SetActiveThreadId(current_thread);
     }
-    this->SetActiveThread(current_thread);
+}
+
+
+std::vector<DebugThread> GdbAdapter::GetThreadList()
+{
+    if (m_isTargetRunning)
+        return {};
+
+    const auto lock = this->m_rspConnector.Lock();
+    // The threads stopped with StopThread() are only known once their stops are recorded
+    if ( this->m_nonStop )
+        this->ProcessPendingStops();
+
+    // qXfer:threads lists all threads in one transfer, while qfThreadInfo/qsThreadInfo can take several pages
+    std::vector<DebugThread> threads{};
+    if ( this->m_rspConnector.HasCapability("qXfer:threads:read") )
+        threads = this->ReadThreadListXfer();
+    if ( threads.empty() )
+        threads = this->ReadThreadListPaged();
 
+    this->ReadThreadInstructionOffsets(threads);
     return threads;
 }
 
@@ -390,209 +715,1111 @@ bool GdbAdapter::SetActiveThreadId(std::uint32_t tid)
         throw std::runtime_error("failed to set thread");
 
     this->m_lastActiveThreadId = tid;
+    // The registers in the snapshot belong to the previous thread
+    this->InvalidateRegisterSnapshot();
 
     return true;
 }
 
+std::size_t GdbAdapter::GetSoftwareBreakpointKind() const
+{
+    /* TODO: replace %d with the actual breakpoint size as it differs per architecture */
+    if (m_remoteArch == "aarch64")
+        return 4;
+//  TODO: other archs have other values for kind, e.g., thumb2 needs a value of 2 or 3 here.
+//  https://sourceware.org/gdb/current/onlinedocs/gdb/ARM-Breakpoint-Kinds.html
+    return 1;
+}
+
+// The "len,bytes" form of an agent expression in the Z0 and QTDP packets
+static std::string EncodeAgentExpression(const AgentExpression& expression)
+{
+    const auto& bytecode = expression.GetBytecode();
+    return fmt::format("{:x},{}", bytecode.size(), HexCodec::Encode(bytecode.data(), bytecode.size()));
+}
+
+// The Z0 packet, with the bytecode of the condition when the backend evaluates it
+std::string GdbAdapter::BreakpointInsertRequest(std::uintptr_t address) const
+{
+    auto request = fmt::format("Z0,{:x},{}", address, GetSoftwareBreakpointKind());
+    const auto condition = this->m_breakpointConditions.find(address);
+    if ( (condition != this->m_breakpointConditions.end()) && condition->second.m_serverSide )
+        request += ";X" + EncodeAgentExpression(condition->second.m_expression);
+    return request;
+}
+
 DebugBreakpoint GdbAdapter::AddBreakpoint(const std::uintptr_t address, unsigned long breakpoint_type)
 {
     if (m_isTargetRunning)
         return {};
 
-    if ( std::find(this->m_debugBreakpoints.begin(), this->m_debugBreakpoints.end(),
-                   DebugBreakpoint(address)) != this->m_debugBreakpoints.end())
+    if (this->m_debugBreakpoints.count(address))
         return {};
 
-    /* TODO: replace %d with the actual breakpoint size as it differs per architecture */
-    size_t kind = 1;
-    if (m_remoteArch == "aarch64")
-        kind = 4;
-//  TODO: other archs have other values for kind, e.g., thumb2 needs a value of 2 or 3 here.
-//  https://sourceware.org/gdb/current/onlinedocs/gdb/ARM-Breakpoint-Kinds.html
-
-    if (this->m_rspConnector.TransmitAndReceive(RspData("Z0,{:x},{}", address, kind)).AsString() != "OK" )
+    if (this->m_rspConnector.TransmitAndReceive(RspData(BreakpointInsertRequest(address))).AsString() != "OK" )
         return DebugBreakpoint{};
 
     const auto new_breakpoint = DebugBreakpoint(address, this->m_internalBreakpointId++, true);
-    this->m_debugBreakpoints.push_back(new_breakpoint);
+    this->m_debugBreakpoints.emplace(address, new_breakpoint);
 
     return new_breakpoint;
 }
 
-bool GdbAdapter::RemoveBreakpoint(const DebugBreakpoint& breakpoint)
+std::vector<DebugBreakpoint> GdbAdapter::AddBreakpoints(const std::vector<std::uintptr_t>& addresses)
 {
     if (m_isTargetRunning)
-        return false;
+        return {};
 
-    if (auto location = std::find(this->m_debugBreakpoints.begin(), this->m_debugBreakpoints.end(), breakpoint);
-            location == this->m_debugBreakpoints.end()) {
-        return false;
+    // The Z0 packets are pipelined, so applying thousands of breakpoints costs about one round trip per batch of
+    // requests in flight rather than one per breakpoint
+    std::vector<std::uintptr_t> pending;
+    std::vector<RspData> requests;
+    pending.reserve(addresses.size());
+    requests.reserve(addresses.size());
+    std::unordered_set<std::uintptr_t> queued;
+    for (const auto address: addresses)
+    {
+        if (this->m_debugBreakpoints.count(address) || !queued.insert(address).second)
+            continue;
+        pending.push_back(address);
+        requests.emplace_back(BreakpointInsertRequest(address));
     }
 
-    /* TODO: replace %d with the actual breakpoint size as it differs per architecture */
-    size_t kind = 1;
-    if (m_remoteArch == "arch64")
-        kind = 4;
-
-    if (this->m_rspConnector.TransmitAndReceive(RspData("z0,{:x},{}", breakpoint.m_address, kind)).AsString() != "OK" )
-        throw std::runtime_error("rsp reply failure on remove breakpoint");
-
-    if (auto location = std::find(this->m_debugBreakpoints.begin(), this->m_debugBreakpoints.end(), breakpoint);
-            location != this->m_debugBreakpoints.end())
-        this->m_debugBreakpoints.erase(location);
-
-    return true;
-}
-
-std::vector<DebugBreakpoint> GdbAdapter::GetBreakpointList() const
-{
-    return this->m_debugBreakpoints;
-}
+    std::vector<DebugBreakpoint> result;
+    const auto replies = this->m_rspConnector.TransmitAndReceiveBatch(requests);
+    for (std::size_t i = 0; i < replies.size(); i++)
+    {
+        if (replies[i].AsString() != "OK")
+            continue;
 
+        const auto new_breakpoint = DebugBreakpoint(pending[i], this->m_internalBreakpointId++, true);
+        this->m_debugBreakpoints.emplace(pending[i], new_breakpoint);
+        result.push_back(new_breakpoint);
+    }
 
-bool GdbAdapter::BreakpointExists(uint64_t address) const
-{
-    return std::find(this->m_debugBreakpoints.begin(), this->m_debugBreakpoints.end(),
-                   DebugBreakpoint(address)) != this->m_debugBreakpoints.end();
+    return result;
 }
 
-
-std::unordered_map<std::string, DebugRegister> GdbAdapter::ReadAllRegisters()
+std::vector<DebugBreakpoint> GdbAdapter::AddBreakpoints(const std::vector<ModuleNameAndOffset>& addresses)
 {
-    if ( this->m_registerInfo.empty() )
-        throw std::runtime_error("register info empty");
-
-    std::vector<register_pair> register_info_vec{};
-    for ( const auto& [register_name, register_info] : this->m_registerInfo )
-        register_info_vec.emplace_back(register_name, register_info);
-
-    std::sort(register_info_vec.begin(), register_info_vec.end(),
-              [](const register_pair& lhs, const register_pair& rhs) {
-                  return lhs.second.m_regNum < rhs.second.m_regNum;
-              });
-
-    char request{'g'};
-    const auto register_info_reply = this->m_rspConnector.TransmitAndReceive(RspData(&request, sizeof(request)));
-    auto register_info_reply_string = register_info_reply.AsString();
-    if ( register_info_reply_string.empty() )
-        throw std::runtime_error("register request reply empty");
+    if (m_isTargetRunning)
+        return {};
 
-    std::unordered_map<std::string, DebugRegister> all_regs{};
-    for ( const auto& [register_name, register_info] : register_info_vec ) {
-        const auto number_of_chars = 2 * ( register_info.m_bitSize / 8 );
-        const auto value_string = register_info_reply_string.substr(0, number_of_chars);
-        if (number_of_chars <= 0x10 && !value_string.empty()) {
-			size_t size = value_string.length() / 2;
-            const auto value = RspConnector::SwapEndianness(std::stoull(value_string, nullptr, 16), size);
-            all_regs[register_name] = DebugRegister(register_name, value, register_info.m_bitSize, register_info.m_regNum);
-            // #warning "ignoring registers with a larger size than 0x10"
-            /* TODO: ^fix this^ */
+    // The breakpoints in the modules that are not loaded yet are skipped
+    const auto modules = this->GetModuleList();
+    std::vector<std::uintptr_t> absolute;
+    absolute.reserve(addresses.size());
+    for (const auto& address: addresses)
+    {
+        if (address.module.empty())
+        {
+            absolute.push_back(address.offset);
+            continue;
         }
-        register_info_reply_string.erase(0, number_of_chars);
+
+        const auto module = std::find_if(modules.begin(), modules.end(),
+                [&address](const DebugModule& module) { return module.IsSameBaseModule(address.module); });
+        if (module != modules.end())
+            absolute.push_back(module->m_address + address.offset);
     }
 
-    return all_regs;
+    return this->AddBreakpoints(absolute);
 }
 
-DebugRegister GdbAdapter::ReadRegister(const std::string& reg)
+DebugBreakpoint GdbAdapter::AddBreakpoint(const ModuleNameAndOffset& address, unsigned long breakpoint_type)
 {
-    if (m_isTargetRunning)
-        return DebugRegister{};
-
-    if ( this->m_registerInfo.find(reg) == this->m_registerInfo.end() )
-        throw std::runtime_error(fmt::format("register {} does not exist in target", reg));
-
-    return this->ReadAllRegisters()[reg];
+    const auto result = this->AddBreakpoints(std::vector<ModuleNameAndOffset>{address});
+    return result.empty() ? DebugBreakpoint{} : result.front();
 }
 
-bool GdbAdapter::WriteRegister(const std::string& reg, std::uintptr_t value)
+bool GdbAdapter::RemoveBreakpoint(const DebugBreakpoint& breakpoint)
 {
     if (m_isTargetRunning)
         return false;
 
-    const auto reply = this->m_rspConnector.TransmitAndReceive(RspData("P{}={:016X}",
-                                       this->m_registerInfo[reg].m_regNum, RspConnector::SwapEndianness(value)));
-    if (reply.m_data[0])
-        return true;
-
-    char query{'g'};
-    const auto generic_query = this->m_rspConnector.TransmitAndReceive(RspData(&query, sizeof(query)));
-    const auto register_offset = this->m_registerInfo[reg].m_offset;
+    if (!this->m_debugBreakpoints.count(breakpoint.m_address))
+        return false;
 
-    const auto first_half = generic_query.AsString().substr(0, 2 * (register_offset / 8));
-    const auto second_half = generic_query.AsString().substr(2 * ((register_offset + this->m_registerInfo[reg].m_bitSize) / 8) );
-    const auto payload = "G" + first_half + fmt::format("{:016X}", RspConnector::SwapEndianness(value)) + second_half;
+    if (this->m_rspConnector.TransmitAndReceive(
+            RspData("z0,{:x},{}", breakpoint.m_address, GetSoftwareBreakpointKind())).AsString() != "OK" )
+        throw std::runtime_error("rsp reply failure on remove breakpoint");
 
-    if ( this->m_rspConnector.TransmitAndReceive(RspData(payload)).AsString() != "OK" )
-        return false;
+    this->m_debugBreakpoints.erase(breakpoint.m_address);
+    this->m_breakpointConditions.erase(breakpoint.m_address);
 
     return true;
 }
 
-DataBuffer GdbAdapter::ReadMemory(std::uintptr_t address, std::size_t size)
+bool GdbAdapter::RemoveBreakpoints(const std::vector<DebugBreakpoint>& breakpoints)
 {
-    // This means whether the target is running. If it is, then we cannot read memory at the moment
     if (m_isTargetRunning)
-        return DataBuffer{};
+        return false;
 
-    auto reply = this->m_rspConnector.TransmitAndReceive(RspData("m{:x},{:x}", address, size));
-    if (reply.m_data[0] == 'E')
-        return DataBuffer{};
+    const auto kind = GetSoftwareBreakpointKind();
+    std::vector<std::uintptr_t> pending;
+    std::vector<RspData> requests;
+    std::unordered_set<std::uintptr_t> queued;
+    for (const auto& breakpoint: breakpoints)
+    {
+        if (!this->m_debugBreakpoints.count(breakpoint.m_address) || !queued.insert(breakpoint.m_address).second)
+            continue;
+        pending.push_back(breakpoint.m_address);
+        requests.emplace_back(fmt::format("z0,{:x},{}", breakpoint.m_address, kind));
+    }
 
-    // The actual bytes read might be fewer than the requested size
-    // We should pass this size by reference so the caller knows the number of bytes read
-    size = reply.AsString().size() / 2;
-    if (size == 0)
-        return DataBuffer{};
+    bool result = (pending.size() == breakpoints.size());
+    const auto replies = this->m_rspConnector.TransmitAndReceiveBatch(requests);
+    for (std::size_t i = 0; i < replies.size(); i++)
+    {
+        if (replies[i].AsString() != "OK")
+        {
+            result = false;
+            continue;
+        }
+        this->m_debugBreakpoints.erase(pending[i]);
+        this->m_breakpointConditions.erase(pending[i]);
+    }
 
-    const auto source = std::make_unique<std::uint8_t[]>(2 * size + 1);
-    const auto dest = std::make_unique<std::uint8_t[]>(size + 1);
-    std::memset(source.get(), '\0', 2 * size + 1);
-    std::memset(dest.get(), '\0', size + 1);
-    std::memcpy(source.get(), reply.m_data.GetData(), 2 * size);
-
-    [](const std::uint8_t* src, std::uint8_t* dst) {
-        const auto char_to_int = [](std::uint8_t input) -> int {
-            if(input >= '0' && input <= '9')
-                return input - '0';
-            if(input >= 'A' && input <= 'F')
-                return input - 'A' + 10;
-            if(input >= 'a' && input <= 'f')
-                return input - 'a' + 10;
-            throw std::invalid_argument("Invalid input string");
+    return result;
+}
+
+std::vector<DebugBreakpoint> GdbAdapter::GetBreakpointList() const
+{
+    std::vector<DebugBreakpoint> result;
+    result.reserve(this->m_debugBreakpoints.size());
+    for (const auto& [address, breakpoint]: this->m_debugBreakpoints)
+        result.push_back(breakpoint);
+
+    // In the order they were added
+    std::sort(result.begin(), result.end(),
+              [](const DebugBreakpoint& a, const DebugBreakpoint& b) { return a.m_id < b.m_id; });
+    return result;
+}
+
+
+// The number in the Z/z packet of a watchpoint type
+static int WatchpointPacketType(DebugWatchpointType type)
+{
+    switch (type)
+    {
+    case WatchpointWrite:
+        return 2;
+    case WatchpointRead:
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+bool GdbAdapter::AddWatchpoint(std::uintptr_t address, std::size_t size, DebugWatchpointType type)
+{
+    if (m_isTargetRunning || (size == 0))
+        return false;
+
+    if (this->m_watchpoints.count(address))
+        return false;
+
+    // The reply is empty when the backend does not support the type, and an error when it runs out of the debug
+    // registers
+    const auto reply = this->m_rspConnector.TransmitAndReceive(
+            RspData(fmt::format("Z{},{:x},{:x}", WatchpointPacketType(type), address, size))).AsString();
+    if ( reply != "OK" )
+    {
+        LogWarn("the backend cannot set a watchpoint at %s: \"%s\"", fmt::format("{:#x}", address).c_str(),
+                reply.c_str());
+        return false;
+    }
+
+    this->m_watchpoints.emplace(address, DebugWatchpoint(address, size, type, this->m_internalBreakpointId++));
+    return true;
+}
+
+bool GdbAdapter::RemoveWatchpoint(std::uintptr_t address)
+{
+    if (m_isTargetRunning)
+        return false;
+
+    const auto watchpoint = this->m_watchpoints.find(address);
+    if (watchpoint == this->m_watchpoints.end())
+        return false;
+
+    if (this->m_rspConnector.TransmitAndReceive(RspData(fmt::format("z{},{:x},{:x}",
+            WatchpointPacketType(watchpoint->second.m_type), address, watchpoint->second.m_size))).AsString() != "OK" )
+        return false;
+
+    this->m_watchpoints.erase(watchpoint);
+    return true;
+}
+
+std::vector<DebugWatchpoint> GdbAdapter::GetWatchpointList() const
+{
+    std::vector<DebugWatchpoint> result;
+    result.reserve(this->m_watchpoints.size());
+    for (const auto& [address, watchpoint]: this->m_watchpoints)
+        result.push_back(watchpoint);
+
+    std::sort(result.begin(), result.end(),
+              [](const DebugWatchpoint& a, const DebugWatchpoint& b) { return a.m_id < b.m_id; });
+    return result;
+}
+
+
+bool GdbAdapter::BreakpointExists(uint64_t address) const
+{
+    return this->m_debugBreakpoints.count(address) != 0;
+}
+
+
+// The hit count of a condition is a trace state variable, which the backend increments while evaluating the condition
+bool GdbAdapter::DefineConditionVariable(std::uint16_t variable)
+{
+    if ( !this->m_rspConnector.HasCapability("TraceStateVariables") )
+        return false;
+
+    const auto name = HexCodec::Encode(fmt::format("bn_hits_{}", variable));
+    return this->m_rspConnector.TransmitAndReceive(
+            RspData(fmt::format("QTDV:{:x}:0:0:{}", variable, name))).AsString() == "OK";
+}
+
+
+bool GdbAdapter::SetBreakpointCondition(std::uintptr_t address, const std::string& condition)
+{
+    if (IsActiveThreadRunning())
+        return false;
+
+    const bool exists = this->m_debugBreakpoints.count(address) != 0;
+    if ( condition.empty() )
+    {
+        const auto iter = this->m_breakpointConditions.find(address);
+        if ( iter == this->m_breakpointConditions.end() )
+            return true;
+        const bool serverSide = iter->second.m_serverSide;
+        this->m_breakpointConditions.erase(iter);
+        // Inserting the breakpoint again replaces the conditions the backend has for it
+        if ( exists && serverSide )
+            return this->m_rspConnector.TransmitAndReceive(RspData(BreakpointInsertRequest(address))).AsString() == "OK";
+        return true;
+    }
+
+    BreakpointCondition entry;
+    entry.m_source = condition;
+    entry.m_hitCountVariable = this->m_nextConditionVariable++;
+    try
+    {
+        entry.m_expression = AgentExpression::Compile(condition,
+                [this](const std::string& name, std::uint32_t& regNum) {
+                    const auto info = this->FindRegister(name);
+                    if ( !info )
+                        return false;
+                    regNum = info->m_regNum;
+                    return true;
+                }, entry.m_hitCountVariable);
+    }
+    catch ( const std::runtime_error& e )
+    {
+        LogError("invalid breakpoint condition \"%s\": %s", condition.c_str(), e.what());
+        return false;
+    }
+
+    // The backend evaluates the condition without stopping the process, which is much faster for a breakpoint that
+    // is hit often. Otherwise the adapter evaluates it at every hit, and resumes the process when it is false.
+    entry.m_serverSide = this->m_rspConnector.HasCapability("ConditionalBreakpoints")
+            && (!entry.m_expression.UsesHitCount() || DefineConditionVariable(entry.m_hitCountVariable));
+    this->m_conditionVariables.erase(entry.m_hitCountVariable);
+    const bool serverSide = entry.m_serverSide;
+    this->m_breakpointConditions[address] = std::move(entry);
+
+    if ( exists && serverSide
+            && this->m_rspConnector.TransmitAndReceive(RspData(BreakpointInsertRequest(address))).AsString() != "OK" )
+    {
+        LogWarn("the backend rejected the condition of the breakpoint at %s, evaluating it locally",
+                fmt::format("{:#x}", address).c_str());
+        this->m_breakpointConditions[address].m_serverSide = false;
+        if ( this->m_rspConnector.TransmitAndReceive(RspData(BreakpointInsertRequest(address))).AsString() != "OK" )
+            return false;
+    }
+
+    return true;
+}
+
+
+// Whether the process stopped at a breakpoint whose condition the adapter evaluates, and the condition is false. A
+// condition that cannot be evaluated stops the process, like it does in the backend.
+bool GdbAdapter::IsBreakpointConditionFalse()
+{
+    if ( this->m_breakpointConditions.empty() )
+        return false;
+
+    const auto address = this->GetInstructionOffset();
+    const auto condition = this->m_breakpointConditions.find(address);
+    if ( (condition == this->m_breakpointConditions.end()) || condition->second.m_serverSide
+            || !this->m_debugBreakpoints.count(address) )
+        return false;
+
+    AgentExpression::Context context;
+    context.readRegister = [this](std::uint32_t regNum, std::uint64_t& value) {
+        const auto info = this->FindRegister(regNum);
+        if ( !info || (info->m_bitSize > 64) )
+            return false;
+        value = this->ReadRegister(info->m_name).m_value;
+        return true;
+    };
+    context.readMemory = [this](std::uint64_t address, std::size_t size, std::uint64_t& value) {
+        const auto buffer = this->ReadMemory(address, size);
+        if ( buffer.GetLength() != size )
+            return false;
+        value = 0;
+        for ( std::size_t i = size; i > 0; i-- )
+            value = (value << 8) | buffer[i - 1];
+        return true;
+    };
+    context.variables = &this->m_conditionVariables;
+
+    std::uint64_t result{};
+    if ( !condition->second.m_expression.Evaluate(context, result) )
+    {
+        LogWarn("failed to evaluate the condition of the breakpoint at %s", fmt::format("{:#x}", address).c_str());
+        return false;
+    }
+    return result == 0;
+}
+
+
+// The QTDP packets of a tracepoint: the definition with the condition, then one packet per collect action
+std::vector<std::string> GdbAdapter::TracepointDefinitionRequests(const DebugTracepoint& tracepoint)
+{
+    const auto resolveRegister = [this](const std::string& name, std::uint32_t& regNum) {
+        const auto info = this->FindRegister(name);
+        if ( !info )
+            return false;
+        regNum = info->m_regNum;
+        return true;
+    };
+
+    std::vector<std::string> actions;
+
+    std::vector<std::uint32_t> registers;
+    if ( tracepoint.m_collectAllRegisters )
+    {
+        for ( const auto& info : this->m_registerLayout )
+            registers.push_back(info.m_regNum);
+    }
+    for ( const auto& name : tracepoint.m_registers )
+    {
+        std::uint32_t regNum{};
+        if ( !resolveRegister(name, regNum) )
+            throw std::runtime_error(fmt::format("register {} does not exist in target", name));
+        registers.push_back(regNum);
+    }
+    if ( !registers.empty() )
+    {
+        // Bit n of the mask is register n, and the mask is sent most significant byte first
+        std::vector<std::uint8_t> mask(*std::max_element(registers.begin(), registers.end()) / 8 + 1);
+        for ( const auto regNum : registers )
+            mask[regNum / 8] |= 1 << (regNum % 8);
+        std::string action = "R";
+        for ( auto iter = mask.rbegin(); iter != mask.rend(); iter++ )
+            action += fmt::format("{:02x}", *iter);
+        actions.push_back(action);
+    }
+
+    // -1 is no base register, i.e., the offset is the address
+    for ( const auto& [address, size] : tracepoint.m_memory )
+        actions.push_back(fmt::format("M-1,{:x},{:x}", address, size));
+
+    for ( const auto& source : tracepoint.m_expressions )
+    {
+        const auto expression = AgentExpression::Compile(source, resolveRegister, 0, true);
+        if ( expression.UsesHitCount() )
+            throw std::runtime_error("$hits is not available in a tracepoint");
+        actions.push_back("X" + EncodeAgentExpression(expression));
+    }
+
+    auto definition = fmt::format("QTDP:{:x}:{:x}:E:0:{:x}", tracepoint.m_id, tracepoint.m_address,
+                                  tracepoint.m_passCount);
+    if ( !tracepoint.m_condition.empty() )
+    {
+        const auto condition = AgentExpression::Compile(tracepoint.m_condition, resolveRegister, 0);
+        if ( condition.UsesHitCount() )
+            throw std::runtime_error("$hits is not available in a tracepoint");
+        definition += ":X" + EncodeAgentExpression(condition);
+    }
+
+    // A trailing '-' means more packets follow for the same tracepoint
+    std::vector<std::string> requests;
+    requests.push_back(definition + (actions.empty() ? "" : "-"));
+    for ( std::size_t i = 0; i < actions.size(); i++ )
+        requests.push_back(fmt::format("QTDP:-{:x}:{:x}:{}{}", tracepoint.m_id, tracepoint.m_address, actions[i],
+                                       (i + 1 < actions.size()) ? "-" : ""));
+    return requests;
+}
+
+
+bool GdbAdapter::StartTrace(const std::vector<DebugTracepoint>& tracepoints)
+{
+    if ( IsActiveThreadRunning() )
+        return false;
+
+    std::vector<RspData> requests;
+    try
+    {
+        for ( const auto& tracepoint : tracepoints )
+        {
+            for ( const auto& request : TracepointDefinitionRequests(tracepoint) )
+                requests.emplace_back(request);
+        }
+    }
+    catch ( const std::runtime_error& e )
+    {
+        LogError("invalid tracepoint: %s", e.what());
+        return false;
+    }
+
+    // QTinit discards the tracepoints and the frames of the previous trace
+    if ( this->m_rspConnector.TransmitAndReceive(RspData("QTinit")).AsString() != "OK" )
+    {
+        LogWarn("the backend does not support tracepoints");
+        return false;
+    }
+
+    const auto replies = this->m_rspConnector.TransmitAndReceiveBatch(requests);
+    for ( std::size_t i = 0; i < replies.size(); i++ )
+    {
+        if ( replies[i].AsString() != "OK" )
+        {
+            LogError("the backend rejected the tracepoint request %s: %s", requests[i].AsString().c_str(),
+                     replies[i].AsString().c_str());
+            return false;
+        }
+    }
+
+    if ( this->m_rspConnector.TransmitAndReceive(RspData("QTStart")).AsString() != "OK" )
+        return false;
+
+    this->m_tracepoints.clear();
+    for ( const auto& tracepoint : tracepoints )
+        this->m_tracepoints[tracepoint.m_id] = tracepoint;
+    return true;
+}
+
+
+bool GdbAdapter::StopTrace()
+{
+    if ( IsActiveThreadRunning() )
+        return false;
+
+    return this->m_rspConnector.TransmitAndReceive(RspData("QTStop")).AsString() == "OK";
+}
+
+
+DebugTraceStatus GdbAdapter::GetTraceStatus()
+{
+    DebugTraceStatus status{};
+    if ( IsActiveThreadRunning() )
+        return status;
+
+    // e.g., T0;tstop::0;tframes:1f4;tcreated:1f4;tfree:4fc18;tsize:500000;circular:0;disconn:0
+    const auto reply = this->m_rspConnector.TransmitAndReceive(RspData("qTStatus")).AsString();
+    if ( (reply.size() < 2) || (reply[0] != 'T') )
+        return status;
+
+    status.m_supported = true;
+    status.m_running = (reply[1] == '1');
+    status.m_stopReason = status.m_running ? TraceNotStopped : TraceUnknownStopReason;
+    for ( const auto& field : RspConnector::Split(reply.substr(2), ";") )
+    {
+        const auto colon = field.find(':');
+        const auto name = field.substr(0, colon);
+        const auto value = (colon == std::string::npos) ? std::string() : field.substr(colon + 1);
+        if ( name == "tframes" )
+            status.m_frames = std::strtoull(value.c_str(), nullptr, 16);
+        else if ( name == "tsize" )
+            status.m_bufferSize = std::strtoull(value.c_str(), nullptr, 16);
+        else if ( name == "tfree" )
+            status.m_bufferFree = std::strtoull(value.c_str(), nullptr, 16);
+        else if ( name == "tnotrun" )
+            status.m_stopReason = TraceNotRun;
+        else if ( name == "tstop" )
+            status.m_stopReason = TraceStoppedByUser;
+        else if ( name == "tfull" )
+            status.m_stopReason = TraceBufferFull;
+        else if ( name == "tdisconnected" )
+            status.m_stopReason = TraceDisconnected;
+        else if ( name == "tpasscount" )
+            status.m_stopReason = TracePassCountReached;
+        else if ( name == "terror" )
+            status.m_stopReason = TraceError;
+    }
+
+    return status;
+}
+
+
+std::unordered_map<std::string, std::uintptr_t> GdbAdapter::DecodeTraceFrameRegisters(const RspData& reply) const
+{
+    std::unordered_map<std::string, std::uintptr_t> result;
+    const std::string_view hex(static_cast<const char*>(reply.m_data.GetData()), reply.m_data.GetLength());
+    std::uint8_t bytes[sizeof(std::uintptr_t)];
+    for ( const auto& info : this->m_registerLayout )
+    {
+        const std::size_t size = info.m_bitSize / 8;
+        if ( (size == 0) || (size > sizeof(bytes)) || (2 * (info.m_offset + size) > hex.size()) )
+            continue;
+        // The registers that the frame does not have are sent as "xx..."
+        if ( !HexCodec::Decode(hex.data() + 2 * info.m_offset, size, bytes) )
+            continue;
+
+        std::uintptr_t value = 0;
+        for ( std::size_t i = 0; i < size; i++ )
+            value |= static_cast<std::uintptr_t>(bytes[i]) << (8 * i);
+        result[info.m_name] = value;
+    }
+    return result;
+}
+
+
+// The memory blocks of the selected trace frame, including the ones the collect expressions read
+std::vector<std::pair<std::uintptr_t, std::size_t>> GdbAdapter::ReadTraceFrameMemoryBlocks()
+{
+    std::vector<std::pair<std::uintptr_t, std::size_t>> blocks;
+    std::string xml;
+    try
+    {
+        xml = this->m_rspConnector.ReadXfer("traceframe-info", "");
+    }
+    catch ( const std::runtime_error& )
+    {
+        return blocks;
+    }
+
+    pugi::xml_document doc;
+    if ( !doc.load_string(xml.c_str()) )
+        return blocks;
+
+    for ( const auto& memory : doc.child("traceframe-info").children("memory") )
+        blocks.emplace_back(std::strtoull(memory.attribute("start").value(), nullptr, 0),
+                            std::strtoull(memory.attribute("length").value(), nullptr, 0));
+    return blocks;
+}
+
+
+static constexpr std::uint64_t TRACE_FRAMES_PER_BATCH = 64;
+static constexpr std::size_t TRACE_MEMORY_REQUESTS_PER_BATCH = 256;
+
+std::vector<DebugTraceFrame> GdbAdapter::GetTraceFrames()
+{
+    if ( IsActiveThreadRunning() )
+        return {};
+
+    const auto status = this->GetTraceStatus();
+    if ( !status.m_supported || (status.m_frames == 0) )
+        return {};
+
+    std::vector<DebugTraceFrame> frames;
+    frames.reserve(status.m_frames);
+    try
+    {
+        // Selecting a frame makes g and m read from the frame rather than the process. The requests are processed in
+        // order, so the selections and the reads of many frames are pipelined.
+        for ( std::uint64_t first = 0; first < status.m_frames; first += TRACE_FRAMES_PER_BATCH )
+        {
+            const auto last = std::min(first + TRACE_FRAMES_PER_BATCH, status.m_frames);
+            std::vector<RspData> requests;
+            for ( auto index = first; index < last; index++ )
+            {
+                requests.emplace_back(fmt::format("QTFrame:{:x}", index));
+                requests.emplace_back("g");
+            }
+
+            const auto replies = this->m_rspConnector.TransmitAndReceiveBatch(requests);
+            for ( std::size_t i = 0; i + 1 < replies.size(); i += 2 )
+            {
+                // F<frame>T<tracepoint>, or F-1 when there is no such frame
+                const auto selected = replies[i].AsString();
+                if ( (selected.size() < 2) || (selected[0] != 'F') || (selected[1] == '-') )
+                    continue;
+
+                DebugTraceFrame frame;
+                char* end{};
+                frame.m_index = std::strtoul(selected.c_str() + 1, &end, 16);
+                if ( *end == 'T' )
+                    frame.m_tracepoint = std::strtoul(end + 1, nullptr, 16);
+                frame.m_registers = this->DecodeTraceFrameRegisters(replies[i + 1]);
+                frames.push_back(std::move(frame));
+            }
+        }
+
+        // With traceframe-info, the backend lists the memory of each frame, including what the expressions read.
+        // Otherwise the memory ranges of the tracepoints are read.
+        const bool frameInfo = this->m_rspConnector.HasCapability("qXfer:traceframe-info:read");
+        std::vector<std::vector<std::size_t>> blockSizes(frames.size());
+        for ( std::size_t index = 0; index < frames.size(); index++ )
+        {
+            auto& frame = frames[index];
+            std::vector<std::pair<std::uintptr_t, std::size_t>> blocks;
+            if ( frameInfo )
+            {
+                const auto selected = this->m_rspConnector.TransmitAndReceive(
+                        RspData(fmt::format("QTFrame:{:x}", frame.m_index))).AsString();
+                if ( !selected.empty() && (selected[0] == 'F') )
+                    blocks = this->ReadTraceFrameMemoryBlocks();
+            }
+            else if ( const auto tracepoint = this->m_tracepoints.find(frame.m_tracepoint);
+                      tracepoint != this->m_tracepoints.end() )
+            {
+                blocks = tracepoint->second.m_memory;
+            }
+
+            for ( const auto& [address, size] : blocks )
+            {
+                frame.m_memory.emplace_back(address, DataBuffer());
+                blockSizes[index].push_back(size);
+            }
+        }
+
+        struct MemoryRead
+        {
+            std::size_t m_frame;
+            std::size_t m_block;
+            std::size_t m_offset;
+        };
+        std::vector<RspData> requests;
+        // One per request, and the frame selections have no block to read
+        std::vector<std::optional<MemoryRead>> reads;
+        const auto flush = [&]() {
+            const auto replies = this->m_rspConnector.TransmitAndReceiveBatch(requests);
+            for ( std::size_t i = 0; i < replies.size(); i++ )
+            {
+                if ( !reads[i] )
+                    continue;
+                auto& data = frames[reads[i]->m_frame].m_memory[reads[i]->m_block].second;
+                // A failed or short read ends the block, e.g., when the frame only has part of the range
+                if ( data.GetLength() != reads[i]->m_offset )
+                    continue;
+                data.Append(this->DecodeMemoryReadReply(replies[i]));
+            }
+            requests.clear();
+            reads.clear();
         };
 
-        while(*src && src[1]) {
-            *(dst++) = char_to_int(*src) * 16 + char_to_int(src[1]);
-            src += 2;
+        const auto chunkSize = this->GetMemoryReadChunkSize();
+        for ( std::size_t index = 0; index < frames.size(); index++ )
+        {
+            auto& frame = frames[index];
+            if ( frame.m_memory.empty() )
+                continue;
+
+            requests.emplace_back(fmt::format("QTFrame:{:x}", frame.m_index));
+            reads.emplace_back();
+            for ( std::size_t block = 0; block < frame.m_memory.size(); block++ )
+            {
+                const auto address = frame.m_memory[block].first;
+                for ( std::size_t offset = 0; offset < blockSizes[index][block]; offset += chunkSize )
+                {
+                    requests.push_back(this->MemoryReadRequest(address + offset,
+                                                               std::min(chunkSize, blockSizes[index][block] - offset)));
+                    reads.push_back(MemoryRead{index, block, offset});
+                }
+            }
+
+            // A batch only ends between frames, since the reads need the selection before them
+            if ( requests.size() >= TRACE_MEMORY_REQUESTS_PER_BATCH )
+                flush();
+        }
+        flush();
+
+        for ( auto& frame : frames )
+        {
+            frame.m_memory.erase(std::remove_if(frame.m_memory.begin(), frame.m_memory.end(),
+                    [](const std::pair<std::uintptr_t, DataBuffer>& block) { return block.second.GetLength() == 0; }),
+                    frame.m_memory.end());
+        }
+    }
+    catch ( ... )
+    {
+        // Leave the frames, so the registers and the memory are read from the process again
+        this->m_rspConnector.TransmitAndReceive(RspData("QTFrame:-1"));
+        this->InvalidateRegisterSnapshot();
+        throw;
+    }
+
+    this->m_rspConnector.TransmitAndReceive(RspData("QTFrame:-1"));
+    this->InvalidateRegisterSnapshot();
+    return frames;
+}
+
+
+void GdbAdapter::InvalidateRegisterSnapshot()
+{
+    std::fill(this->m_registerValid.begin(), this->m_registerValid.end(), false);
+    this->m_registerSnapshotComplete = false;
+}
+
+
+bool GdbAdapter::StoreRegisterBytes(const RegisterInfo& info, const char* hex, std::size_t length)
+{
+    const auto index = &info - this->m_registerLayout.data();
+    const std::size_t size = info.m_bitSize / 8;
+    // The unavailable registers are sent as "xx...", which do not decode
+    this->m_registerValid[index] = (length >= 2 * size) &&
+            HexCodec::Decode(hex, size, this->m_registerBlock.data() + info.m_offset);
+    return this->m_registerValid[index];
+}
+
+
+DebugRegister GdbAdapter::SnapshotRegister(const RegisterInfo& info) const
+{
+    // The registers are in the target byte order, which is little endian. Only the low bytes of the wide registers,
+    // e.g., xmm0, fit in the value, and the rest are kept in the register block.
+    const auto size = std::min<std::size_t>(info.m_bitSize / 8, sizeof(std::uintptr_t));
+    std::uintptr_t value = 0;
+    for ( std::size_t i = 0; i < size; i++ )
+        value |= static_cast<std::uintptr_t>(this->m_registerBlock[info.m_offset + i]) << (8 * i);
+    return DebugRegister(info.m_name, value, info.m_bitSize, info.m_regNum);
+}
+
+
+void GdbAdapter::LoadExpeditedRegisters(const RspStopReply& stopReply)
+{
+    this->InvalidateRegisterSnapshot();
+
+    for ( std::size_t index = 0; index < stopReply.m_registerCount; index++ ) {
+        const auto& [register_number, value] = stopReply.m_registers[index];
+        if ( const auto register_info = this->FindRegister(register_number) )
+            this->StoreRegisterBytes(*register_info, value.data(), value.size());
+    }
+}
+
+
+void GdbAdapter::FetchAllRegisters()
+{
+    char request{'g'};
+    const auto reply = this->m_rspConnector.TransmitAndReceive(RspData(&request, sizeof(request)));
+    const std::string_view registers(static_cast<const char*>(reply.m_data.GetData()), reply.m_data.GetLength());
+    if ( registers.empty() )
+        throw std::runtime_error("register request reply empty");
+
+    // Some backends leave out the registers at the end, so they are not valid
+    std::fill(this->m_registerValid.begin(), this->m_registerValid.end(), false);
+    for ( const auto& register_info : this->m_registerLayout ) {
+        if ( 2 * register_info.m_offset >= registers.size() )
+            break;
+        this->StoreRegisterBytes(register_info, registers.data() + 2 * register_info.m_offset,
+                                 registers.size() - 2 * register_info.m_offset);
+    }
+    this->m_registerSnapshotComplete = true;
+}
+
+
+std::unordered_map<std::string, DebugRegister> GdbAdapter::ReadAllRegisters()
+{
+    if ( this->m_registerLayout.empty() )
+        throw std::runtime_error("register info empty");
+
+    if ( this->IsActiveThreadRunning() )
+        return {};
+
+    if ( !this->m_registerSnapshotComplete )
+        this->FetchAllRegisters();
+
+    std::unordered_map<std::string, DebugRegister> all_regs{};
+    all_regs.reserve(this->m_registerLayout.size());
+    for ( std::size_t index{}; index < this->m_registerLayout.size(); index++ ) {
+        if ( this->m_registerValid[index] )
+            all_regs[this->m_registerLayout[index].m_name] = this->SnapshotRegister(this->m_registerLayout[index]);
+    }
+
+    return all_regs;
+}
+
+DebugRegister GdbAdapter::ReadRegister(const std::string& reg)
+{
+    if (IsActiveThreadRunning())
+        return DebugRegister{};
+
+    const auto register_info = this->FindRegister(reg);
+    if ( !register_info )
+        throw std::runtime_error(fmt::format("register {} does not exist in target", reg));
+
+    // The stop reply often has the register, e.g., the pc, so there is no need to read all registers
+    const auto index = register_info - this->m_registerLayout.data();
+    if ( !this->m_registerValid[index] && !this->m_registerSnapshotComplete )
+        this->FetchAllRegisters();
+
+    if ( !this->m_registerValid[index] )
+        return DebugRegister{};
+
+    return this->SnapshotRegister(*register_info);
+}
+
+bool GdbAdapter::WriteRegister(const std::string& reg, std::uintptr_t value)
+{
+    if (IsActiveThreadRunning())
+        return false;
+
+    const auto register_info = this->FindRegister(reg);
+    if ( !register_info )
+        return false;
+
+    // Writing a register can change other registers as well, e.g., eax and rax
+    this->InvalidateRegisterSnapshot();
+
+    // The value is sent in the target byte order, which is little endian
+    const auto register_size = std::min<std::size_t>(register_info->m_bitSize / 8, sizeof(value));
+    std::uint8_t value_bytes[sizeof(value)];
+    for ( std::size_t i = 0; i < register_size; i++ )
+        value_bytes[i] = static_cast<std::uint8_t>(value >> (8 * i));
+    const auto value_hex = HexCodec::Encode(value_bytes, register_size);
+
+    const auto reply = this->m_rspConnector.TransmitAndReceive(
+            RspData("P{:x}={}", register_info->m_regNum, value_hex));
+    if ( reply.AsString() == "OK" )
+        return true;
+
+    // Fall back to reading all registers, patching the bytes of this one, and writing them all back
+    char query{'g'};
+    auto registers = this->m_rspConnector.TransmitAndReceive(RspData(&query, sizeof(query))).AsString();
+    const auto register_offset = register_info->m_offset;
+    if ( 2 * (register_offset + register_size) > registers.size() )
+        return false;
+
+    std::copy(value_hex.begin(), value_hex.end(), registers.begin() + 2 * register_offset);
+    const auto payload = "G" + registers;
+
+    if ( this->m_rspConnector.TransmitAndReceive(RspData(payload)).AsString() != "OK" )
+        return false;
+
+    return true;
+}
+
+void GdbAdapter::NegotiateMemoryTransfer()
+{
+    // gdbserver advertises the x packet as binary-upload. Other servers, e.g., debugserver and lldb-server,
+    // support it without advertising it, and reply OK to a zero-length read. An unsupported packet gets an empty reply.
+    m_binaryReadPrefixed = this->m_rspConnector.HasCapability("binary-upload");
+    if (m_binaryReadPrefixed)
+        m_binaryMemoryRead = true;
+    else
+        m_binaryMemoryRead = this->m_rspConnector.TransmitAndReceive(RspData("x0,0")).AsString() == "OK";
+
+    // This is how gdb probes for the X packet. A zero-length write does not touch the target memory.
+    const auto reply = this->m_rspConnector.TransmitAndReceive(RspData("X0,0:")).AsString();
+    m_binaryMemoryWrite = (reply == "OK");
+
+    LogDebug("memory transfer mode: read %s, write %s", m_binaryMemoryRead ? "binary" : "hex",
+             m_binaryMemoryWrite ? "binary" : "hex");
+}
+
+
+// How long the thread waiting for a stop in the non-stop mode blocks on the socket before it checks for buffered
+// notifications again, in milliseconds
+static constexpr std::int32_t NON_STOP_POLL_INTERVAL = 100;
+
+// The packet header, e.g., "x7fffffffe000,1000:", and the framing bytes
+static constexpr std::size_t MEMORY_PACKET_OVERHEAD = 64;
+// The number of chunk requests that are sent as one batch
+static constexpr std::size_t MEMORY_CHUNKS_PER_BATCH = 64;
+
+
+// The number of bytes of (encoded) memory contents that fit in a packet of the negotiated size
+static std::size_t MemoryPayloadSize(std::size_t packetSize)
+{
+    return packetSize > 2 * MEMORY_PACKET_OVERHEAD ? packetSize - MEMORY_PACKET_OVERHEAD : MEMORY_PACKET_OVERHEAD;
+}
+
+
+std::size_t GdbAdapter::GetMemoryReadChunkSize() const
+{
+    // The reply must fit in a packet of the negotiated size. Hex encoding doubles the size of the data, while
+    // binary encoding only escapes a few bytes. If escaping makes the reply too large, the backend returns fewer
+    // bytes, and the rest is requested again.
+    const auto available = MemoryPayloadSize(this->m_rspConnector.GetMaxPacketLength());
+    return m_binaryMemoryRead ? available : available / 2;
+}
+
+
+RspData GdbAdapter::MemoryReadRequest(std::uintptr_t address, std::size_t size) const
+{
+    if (m_binaryMemoryRead)
+        return RspData("x{:x},{:x}", address, size);
+    return RspData("m{:x},{:x}", address, size);
+}
+
+
+DataBuffer GdbAdapter::DecodeMemoryReadReply(const RspData& reply) const
+{
+    const auto replySize = reply.m_data.GetLength();
+    const auto data = static_cast<const std::uint8_t*>(reply.m_data.GetData());
+    if (replySize == 0)
+        return DataBuffer{};
+
+    if (m_binaryMemoryRead)
+    {
+        std::size_t start = 0;
+        if (m_binaryReadPrefixed)
+        {
+            // Without the 'b', the reply is an error
+            if (data[0] != 'b')
+                return DataBuffer{};
+            start = 1;
+        }
+        else if ((replySize == 3) && (data[0] == 'E') && std::isxdigit(data[1]) && std::isxdigit(data[2]))
+        {
+            // debugserver replies E80 when failing to read the memory. The check here does not remove all ambiguity,
+            // but it should probably work in most cases
+            return DataBuffer{};
+        }
+
+        DataBuffer result(replySize - start);
+        std::size_t length = 0;
+        for (std::size_t i = start; i < replySize; i++)
+        {
+            if ((data[i] == '}') && (i + 1 < replySize))
+                result[length++] = data[++i] ^ 0x20;
+            else
+                result[length++] = data[i];
+        }
+        result.SetSize(length);
+        return result;
+    }
+
+    if (data[0] == 'E')
+        return DataBuffer{};
+
+    // The actual bytes read might be fewer than the requested size
+    const auto size = replySize / 2;
+    if (size == 0)
+        return DataBuffer{};
+
+    DataBuffer result(size);
+    if (!HexCodec::Decode(reinterpret_cast<const char*>(data), size, static_cast<std::uint8_t*>(result.GetData())))
+        return DataBuffer{};
+
+    return result;
+}
+
+
+DataBuffer GdbAdapter::ReadMemory(std::uintptr_t address, std::size_t size)
+{
+    // This means whether the target is running. If it is, then we cannot read memory at the moment
+    if (m_isTargetRunning)
+        return DataBuffer{};
+
+    // Large reads are split into chunks that fit in a packet, and the chunks are pipelined. The result can be
+    // shorter than the requested size if part of the range cannot be read.
+    const auto chunkSize = GetMemoryReadChunkSize();
+    DataBuffer result;
+    std::size_t offset = 0;
+    while (offset < size)
+    {
+        std::vector<RspData> requests;
+        std::vector<std::size_t> lengths;
+        for (std::size_t chunk = offset; (chunk < size) && (requests.size() < MEMORY_CHUNKS_PER_BATCH);
+             chunk += chunkSize)
+        {
+            lengths.push_back(std::min(chunkSize, size - chunk));
+            requests.push_back(MemoryReadRequest(address + chunk, lengths.back()));
+        }
+
+        const auto replies = this->m_rspConnector.TransmitAndReceiveBatch(requests);
+        for (std::size_t i = 0; i < replies.size(); i++)
+        {
+            const auto data = DecodeMemoryReadReply(replies[i]);
+            if (data.GetLength() == 0)
+                return result;
+
+            result.Append(data);
+            offset += data.GetLength();
+            // A short read means the following chunks do not start where the data ends, so request again from the
+            // end of the data
+            if (data.GetLength() < lengths[i])
+                break;
+        }
+    }
+
+    return result;
+}
+
+
+std::vector<RspData> GdbAdapter::MemoryWriteRequests(std::uintptr_t address, const DataBuffer& buffer) const
+{
+    const auto payloadSize = MemoryPayloadSize(this->m_rspConnector.GetMaxPacketLength());
+
+    const size_t size = buffer.GetLength();
+    const auto data = static_cast<const std::uint8_t*>(buffer.GetData());
+
+    std::vector<RspData> requests;
+    std::size_t start = 0;
+    while (start < size)
+    {
+        std::size_t end = start;
+        std::string payload;
+        if (m_binaryMemoryWrite)
+        {
+            // Most bytes take one byte in the packet, and the escaped ones take two
+            end += RspConnector::BinaryEncode(data + start, size - start, payload, payloadSize);
+            requests.emplace_back("X{:x},{:x}:{}", address + start, end - start, payload);
+        }
+        else
+        {
+            end = std::min(size, start + payloadSize / 2);
+            payload = HexCodec::Encode(data + start, end - start);
+            requests.emplace_back("M{:x},{:x}:{}", address + start, end - start, payload);
+        }
+        start = end;
+    }
+
+    return requests;
+}
+
+
+bool GdbAdapter::WriteMemory(std::uintptr_t address, const DataBuffer& buffer)
+{
+    if (m_isTargetRunning)
+        return false;
+
+    const auto requests = MemoryWriteRequests(address, buffer);
+    for (std::size_t i = 0; i < requests.size(); i += MEMORY_CHUNKS_PER_BATCH)
+    {
+        const std::vector<RspData> batch(requests.begin() + i,
+            requests.begin() + std::min(requests.size(), i + MEMORY_CHUNKS_PER_BATCH));
+        for (const auto& reply : this->m_rspConnector.TransmitAndReceiveBatch(batch))
+        {
+            if (reply.AsString() != "OK")
+                return false;
         }
-    }(source.get(), dest.get());
+    }
 
-    return DataBuffer(dest.get(), size);
+    return true;
 }
 
 
-bool GdbAdapter::WriteMemory(std::uintptr_t address, const DataBuffer& buffer)
-{
-    if (m_isTargetRunning)
-        return false;
+// The pread header, e.g., "vFile:pread:7,3fc0,2a00000", and the framing bytes
+static constexpr std::size_t HOST_IO_PACKET_OVERHEAD = 64;
+// The number of pread requests that are sent as one batch
+static constexpr std::size_t HOST_IO_BLOCKS_PER_BATCH = 64;
+// The stat structure of the fstat reply, in the gdb File-I/O layout. The fields are big endian.
+static constexpr std::size_t HOST_IO_STAT_SIZE = 64;
+static constexpr std::size_t HOST_IO_STAT_MODE_OFFSET = 8;
+static constexpr std::size_t HOST_IO_STAT_SIZE_OFFSET = 28;
+static constexpr std::size_t HOST_IO_STAT_MTIME_OFFSET = 56;
+static constexpr std::uint32_t HOST_IO_S_IFREG = 0100000;
 
-    size_t size = buffer.GetLength();
-	DataBuffer dest(2 * size);
 
-    for ( std::size_t index{}; index < size; index++ )
-	{
-		// Feel free to write it in a more elegant way...
-		std::string hex = fmt::format("{:02X}", buffer[index]);
-		dest[2 * index] = hex[0];
-		dest[2 * index + 1] = hex[1];
-	}
+static std::uint64_t ReadBigEndian(const std::uint8_t* data, std::size_t size)
+{
+    std::uint64_t value = 0;
+    for ( std::size_t i = 0; i < size; i++ )
+        value = (value << 8) | data[i];
+    return value;
+}
 
-    auto reply = this->m_rspConnector.TransmitAndReceive(RspData("M{:x},{:x}:{}", address, size, dest.ToEscapedString()));
-    if (reply.AsString() != "OK")
-        return false;
 
-    return true;
+std::string GdbAdapter::GetRemoteFileCachePath(const std::string& path, std::uint64_t size, std::uint64_t mtime)
+{
+    const auto hash = HashString(fmt::format("{};{:x};{:x}", path, size, mtime));
+    const auto directory = std::filesystem::path(GetUserDirectory()) / "debugger" / "remote-files";
+    return (directory / fmt::format("{:016x}-{}", hash, DebugModule::GetPathBaseName(path))).string();
 }
 
 
@@ -607,10 +1834,7 @@ std::string GdbAdapter::GetRemoteFile(const std::string& path)
     if (ret < 0)
         throw runtime_error("could not set remote filesystem");
 
-    std::string path_hex_string{};
-    for ( const auto& ch : path )
-        path_hex_string += fmt::format("{:02X}", ch);
-
+    const auto path_hex_string = HexCodec::Encode(path);
     ret = this->m_rspConnector.HostFileIO(
                     RspData("vFile:open:{},{:X},{:X}", path_hex_string.c_str(), 0, 0), output, error);
     if (ret < 0)
@@ -618,98 +1842,339 @@ std::string GdbAdapter::GetRemoteFile(const std::string& path)
 
     int32_t fd = ret;
 
+    // Regular files are cached locally, keyed by their path, size and mtime. The files in /proc report a size of 0,
+    // so they are read until EOF and never cached. Servers without fstat only lose the cache.
+    std::size_t size = 0;
+    std::string cache_path;
+    try
+    {
+        RspData stat;
+        ret = this->m_rspConnector.HostFileIO(RspData(fmt::format("vFile:fstat:{:X}", fd)), stat, error);
+        if ((ret >= (int32_t)HOST_IO_STAT_SIZE) && (stat.m_data.GetLength() >= HOST_IO_STAT_SIZE))
+        {
+            const auto fields = static_cast<const std::uint8_t*>(stat.m_data.GetData());
+            const auto mode = ReadBigEndian(fields + HOST_IO_STAT_MODE_OFFSET, 4);
+            size = ReadBigEndian(fields + HOST_IO_STAT_SIZE_OFFSET, 8);
+            const auto mtime = ReadBigEndian(fields + HOST_IO_STAT_MTIME_OFFSET, 4);
+            if (((mode & 0170000) == HOST_IO_S_IFREG) && (size > 0))
+                cache_path = GetRemoteFileCachePath(path, size, mtime);
+        }
+    }
+    catch (const std::exception&)
+    {
+        size = 0;
+    }
+
     std::string data;
-    size_t offset = 0;
-    const size_t blockSize = 1024;
+    if (!cache_path.empty())
+    {
+        std::ifstream cached(cache_path, std::ios::binary | std::ios::ate);
+        if (cached && ((std::size_t)cached.tellg() == size))
+        {
+            data.resize(size);
+            cached.seekg(0);
+            if (!cached.read(data.data(), size))
+                data.clear();
+        }
+    }
 
-    while(true)
+    // Several preads are kept in flight, and each reply is decoded in place into the preallocated buffer. The block
+    // starts at the largest one that fits in a packet, and shrinks to what the server returns when its replies come
+    // back short, e.g., when the binary escaping does not fit in its packet buffer.
+    std::size_t blockSize = MemoryPayloadSize(this->m_rspConnector.GetMaxPacketLength());
+    std::size_t offset = 0;
+    const bool from_cache = !data.empty();
+    bool eof = from_cache;
+    if (!from_cache)
+        data.resize(size);
+
+    while (!eof)
     {
-        ret = this->m_rspConnector.HostFileIO(
-                    RspData("vFile:pread:{:X},{:X},{:X}", fd, blockSize, offset), output, error);
-        if (ret < 0)
-            throw runtime_error(fmt::format("host i/o pread() failed, result=%d, errno=%d", ret, error));
-        if (ret == 0)
-            // EOF
+        RspPipeline pipeline(this->m_rspConnector);
+        std::vector<std::future<RspData>> replies;
+        std::vector<std::size_t> lengths;
+        // When the size is unknown, e.g., for the files in /proc, the blocks are read one at a time. Those files
+        // return short reads at line boundaries, which says nothing about where the file ends.
+        const std::size_t batchEnd = size ? size : offset + blockSize;
+        for (std::size_t block = offset; (block < batchEnd) && (replies.size() < HOST_IO_BLOCKS_PER_BATCH);
+             block += blockSize)
+        {
+            lengths.push_back(std::min(blockSize, batchEnd - block));
+            replies.push_back(pipeline.Queue(RspData(fmt::format("vFile:pread:{:X},{:X},{:X}", fd, lengths.back(), block))));
+        }
+        if (replies.empty())
             break;
-        if (ret != (int32_t)output.AsString().length())
-            throw runtime_error(fmt::format("host i/o pread() returned {:X} but decoded binary attachment is size {:X}",
-                    ret, output.AsString().length()));
-        
-        data += output.AsString();
-        offset += output.AsString().length();
+
+        for (std::size_t i = 0; i < replies.size(); i++)
+        {
+            const auto reply = replies[i].get();
+            std::string_view attachment;
+            ret = RspConnector::ParseHostFileIOReply(reply, attachment, error);
+            if (ret < 0)
+                throw runtime_error(fmt::format("host i/o pread() failed, result={}, errno={}", ret, error));
+            if (ret == 0)
+            {
+                // EOF
+                eof = true;
+                break;
+            }
+
+            if (data.size() < offset + ret)
+                data.resize(std::max<std::size_t>(offset + ret, data.size() * 2));
+            const auto decoded = RspConnector::BinaryDecode(attachment, data.data() + offset, ret);
+            if (decoded != (std::size_t)ret)
+                throw runtime_error(fmt::format("host i/o pread() returned {:X} but decoded binary attachment is size {:X}",
+                        ret, decoded));
+
+            offset += ret;
+            if (size && (offset >= size))
+            {
+                eof = true;
+                break;
+            }
+            // A short read means the following blocks do not start where the data ends, so request again from the
+            // end of the data, with the block size the server can return
+            if (size && ((std::size_t)ret < lengths[i]))
+            {
+                blockSize = ret;
+                break;
+            }
+        }
     }
 
+    if (!from_cache)
+        data.resize(offset);
+
     ret = this->m_rspConnector.HostFileIO(RspData(fmt::format("vFile:close:{:X}", fd)), output, error);
     if (ret)
         throw runtime_error(fmt::format("host i/o close() failed, result={}, errno={}", ret, error));
 
+    if (!from_cache && !cache_path.empty() && (offset == size))
+        WriteCacheFile(cache_path, data.data(), data.size());
+
     return data;
 }
 
-std::vector<DebugModule> GdbAdapter::GetModuleList()
+
+void GdbAdapter::InvalidateModuleCache()
 {
-    if (m_isTargetRunning)
-        return {};
+    this->m_moduleCacheValid = false;
+    this->m_moduleCache.clear();
+    this->m_linkMapAddresses.clear();
+    this->m_linkMapGeneration.clear();
+}
 
-    std::map<std::string, BNAddressRange> moduleRanges;
 
-    const auto path = "/proc/" + std::to_string(this->m_lastActiveThreadId) + "/maps";
-    std::string data = GetRemoteFile(path);
-    for (const std::string& line: RspConnector::Split(data, "\n"))
+void GdbAdapter::ParseProcMaps(std::string_view data, std::map<std::string, BNAddressRange>& moduleRanges)
+{
+    // Each line is "start-end perms offset dev inode   path", and only the lines with an absolute path are modules
+    while ( !data.empty() )
     {
-        std::string_view v = line;
-        v.remove_prefix(std::min(v.find_first_not_of(" "), v.size()));
-        auto trimPosition = v.find_last_not_of(" ");
-        if (trimPosition != v.npos)
-            v.remove_suffix(v.size() - trimPosition - 1);
-
-        // regex_match() requires the first argument to be const
-        const std::string trimmedLine = std::string(v);
-
-        std::smatch match;
-        const std::regex module_regex("^([0-9a-f]+)-([0-9a-f]+) [rwxp-]{4} .* (/.*)$");
-        bool found = std::regex_match(trimmedLine, match, module_regex);
-        if (found)
+        const auto lineEnd = data.find('\n');
+        std::string_view line = data.substr(0, lineEnd);
+        data.remove_prefix(lineEnd == std::string_view::npos ? data.size() : lineEnd + 1);
+
+        line.remove_prefix(std::min(line.find_first_not_of(' '), line.size()));
+        const auto trimPosition = line.find_last_not_of(" \r");
+        if ( trimPosition == std::string_view::npos )
+            continue;
+        line.remove_suffix(line.size() - trimPosition - 1);
+
+        uint64_t start{}, end{};
+        const char* const lineLast = line.data() + line.size();
+        auto [startLast, startError] = std::from_chars(line.data(), lineLast, start, 16);
+        if ( startError != std::errc() || startLast == lineLast || *startLast != '-' )
+            continue;
+        auto [endLast, endError] = std::from_chars(startLast + 1, lineLast, end, 16);
+        if ( endError != std::errc() )
+            continue;
+        line.remove_prefix(endLast - line.data());
+
+        // Skip the perms, offset, dev and inode fields
+        for ( int field = 0; field < 4 && !line.empty(); field++ )
         {
-            if (match.size() == 4) {
-                std::string startString = match[1].str();
-                uint64_t start = std::strtoull(startString.c_str(), nullptr, 16);
-                std::string endString = match[2].str();
-                uint64_t end = std::strtoull(endString.c_str(), nullptr, 16);
-                std::string path = match[3].str();
-
-                auto iter = moduleRanges.find(path);
-                if (iter != moduleRanges.end())
-                {
-                    BNAddressRange currentRange = iter->second;
-                    BNAddressRange newRange;
-                    newRange.start = std::min<uint64_t>(currentRange.start, start);
-                    newRange.end = std::max<uint64_t>(currentRange.end, end);
-                    iter->second = newRange;
-                }
-                else
-                {
-                    moduleRanges[path] = {start, end};
-                }
-            }
+            line.remove_prefix(std::min(line.find_first_not_of(' '), line.size()));
+            line.remove_prefix(std::min(line.find(' '), line.size()));
+        }
+        line.remove_prefix(std::min(line.find_first_not_of(' '), line.size()));
+        if ( line.empty() || line[0] != '/' )
+            continue;
+
+        auto [iter, inserted] = moduleRanges.try_emplace(std::string(line), BNAddressRange{start, end});
+        if ( !inserted )
+        {
+            iter->second.start = std::min<uint64_t>(iter->second.start, start);
+            iter->second.end = std::max<uint64_t>(iter->second.end, end);
+        }
+    }
+}
+
+
+// The svr4 names are the paths that the loader opened, e.g., "/lib/x86_64-linux-gnu/libc.so.6", while the maps file
+// has the resolved path of the same file, e.g., "/usr/lib/x86_64-linux-gnu/libc.so.6" when /lib links to /usr/lib.
+// The symlinks on the target cannot be resolved cheaply, so the path is normalized, and the top level directories that
+// merged-/usr systems link into /usr are put under it.
+std::string GdbAdapter::CanonicalModulePath(const std::string& path)
+{
+    std::vector<std::string> components;
+    for ( const auto& component : RspConnector::Split(path, "/") )
+    {
+        if ( component.empty() || component == "." )
+            continue;
+        if ( component == ".." )
+        {
+            if ( !components.empty() )
+                components.pop_back();
+            continue;
         }
+        components.push_back(component);
     }
 
+    static const std::unordered_set<std::string> mergedDirectories = {"bin", "sbin", "lib", "lib32", "lib64", "libx32"};
+    if ( (components.size() > 1) && mergedDirectories.count(components.front()) )
+        components.insert(components.begin(), "usr");
+
+    std::string result;
+    for ( const auto& component : components )
+        result += "/" + component;
+    return result.empty() ? "/" : result;
+}
+
+
+std::vector<DebugModule> GdbAdapter::ReadModuleListMaps()
+{
+    std::map<std::string, BNAddressRange> moduleRanges;
+    const auto path = "/proc/" + std::to_string(this->m_lastActiveThreadId) + "/maps";
+    ParseProcMaps(GetRemoteFile(path), moduleRanges);
+
     std::vector<DebugModule> result;
+    result.reserve(moduleRanges.size());
     for (auto& iter: moduleRanges)
+        result.emplace_back(iter.first, iter.first, iter.second.start, iter.second.end - iter.second.start, true);
+    return result;
+}
+
+
+std::string GdbAdapter::ReadLinkMapGeneration(const std::vector<std::uintptr_t>& linkMaps)
+{
+    // l_next follows l_addr, l_name and l_ld in the link_map
+    const auto ip_register = this->FindRegister(this->GetInstructionPointerRegisterName());
+    const std::size_t pointerSize = ip_register ? ip_register->m_bitSize / 8 : sizeof(std::uint64_t);
+
+    std::vector<RspData> requests;
+    requests.reserve(linkMaps.size());
+    for ( const auto linkMap : linkMaps )
+        requests.push_back(this->MemoryReadRequest(linkMap + 3 * pointerSize, pointerSize));
+
+    std::string generation;
+    generation.reserve(linkMaps.size() * pointerSize);
+    for ( const auto& reply : this->m_rspConnector.TransmitAndReceiveBatch(requests) )
+    {
+        const auto data = this->DecodeMemoryReadReply(reply);
+        if ( data.GetLength() != pointerSize )
+            return {};
+        generation.append(static_cast<const char*>(data.GetData()), data.GetLength());
+    }
+
+    return generation;
+}
+
+
+std::vector<DebugModule> GdbAdapter::ReadModuleListSvr4()
+{
+    const auto xml = this->m_rspConnector.ReadXfer("libraries-svr4", "");
+
+    pugi::xml_document doc{};
+    if ( !doc.load_string(xml.c_str()) )
+        throw std::runtime_error("failed to parse the svr4 library list");
+
+    // The svr4 list has neither the sizes nor the main executable, and l_addr is the load bias rather than the base.
+    // The ranges come from the maps file, which is only read again when the link_map chain changes.
+    std::map<std::string, BNAddressRange> moduleRanges;
+    ParseProcMaps(GetRemoteFile("/proc/" + std::to_string(this->m_lastActiveThreadId) + "/maps"), moduleRanges);
+
+    std::vector<DebugModule> libraries;
+    std::unordered_set<std::string> sharedPaths;
+    std::vector<std::uintptr_t> linkMaps;
+    for ( auto library = doc.child("library-list-svr4").child("library"); library;
+          library = library.next_sibling("library") )
+    {
+        linkMaps.push_back(std::strtoull(library.attribute("lm").value(), nullptr, 16));
+
+        const std::string name = library.attribute("name").value();
+        if ( name.empty() )
+            continue;
+
+        // The dynamic section is mapped with its library, which tells the library apart even if the loader opened it
+        // through a symlink. The canonical paths are compared when that fails.
+        const auto dynamic = std::strtoull(library.attribute("l_ld").value(), nullptr, 16);
+        auto range = std::find_if(moduleRanges.begin(), moduleRanges.end(), [dynamic](const auto& entry) {
+            return (dynamic >= entry.second.start) && (dynamic < entry.second.end);
+        });
+        if ( range == moduleRanges.end() )
+        {
+            const auto canonicalName = CanonicalModulePath(name);
+            range = std::find_if(moduleRanges.begin(), moduleRanges.end(), [&canonicalName](const auto& entry) {
+                return CanonicalModulePath(entry.first) == canonicalName;
+            });
+        }
+
+        // The vdso is not mapped from a file, and it is linked at 0, so its bias is its base
+        if ( range == moduleRanges.end() )
+        {
+            libraries.emplace_back(name, name, std::strtoull(library.attribute("l_addr").value(), nullptr, 16), 0, true);
+            continue;
+        }
+
+        if ( !sharedPaths.insert(range->first).second )
+            continue;
+        libraries.emplace_back(range->first, range->first, range->second.start,
+                range->second.end - range->second.start, true);
+    }
+
+    // The main executable, and anything else mapped from a file that the loader did not load, comes first
+    std::vector<DebugModule> result;
+    for ( const auto& [path, range] : moduleRanges )
     {
-        DebugModule module;
-        module.m_address = iter.second.start;
-        module.m_size = iter.second.end - iter.second.start;
-        module.m_name = iter.first;
-        module.m_short_name = iter.first;
-        module.m_loaded = true;
-        result.push_back(module);
+        if ( !sharedPaths.count(path) )
+            result.emplace_back(path, path, range.start, range.end - range.start, true);
     }
+    result.insert(result.end(), libraries.begin(), libraries.end());
+
+    this->m_linkMapGeneration = this->ReadLinkMapGeneration(linkMaps);
+    this->m_linkMapAddresses = std::move(linkMaps);
     return result;
 }
 
 
+std::vector<DebugModule> GdbAdapter::GetModuleList()
+{
+    if (m_isTargetRunning)
+        return {};
+
+    const bool svr4 = this->m_rspConnector.HasCapability("qXfer:libraries-svr4:read");
+
+    // Without library stop events from the server, a dlopen()/dlclose() only shows up in the link_map chain
+    if ( this->m_moduleCacheValid && svr4 && !this->m_linkMapAddresses.empty() )
+    {
+        const auto generation = this->ReadLinkMapGeneration(this->m_linkMapAddresses);
+        if ( generation.empty() || generation != this->m_linkMapGeneration )
+            this->InvalidateModuleCache();
+    }
+
+    // The mappings cannot be checked cheaply, so the maps file is read again at every stop
+    if ( !svr4 )
+        return this->ReadModuleListMaps();
+
+    if ( this->m_moduleCacheValid )
+        return this->m_moduleCache;
+
+    this->m_moduleCache = this->ReadModuleListSvr4();
+    this->m_moduleCacheValid = true;
+    return this->m_moduleCache;
+}
+
+
 std::string GdbAdapter::GetTargetArchitecture()
 {
     if (m_remoteArch != "")
@@ -718,7 +2183,7 @@ std::string GdbAdapter::GetTargetArchitecture()
     if (m_isTargetRunning)
         return "";
 
-    const auto xml = this->m_rspConnector.GetXml("target.xml");
+    const auto& xml = this->GetTargetDescription();
 
     pugi::xml_document doc{};
     const auto parse_result = doc.load_string(xml.c_str());
@@ -747,6 +2212,11 @@ std::string GdbAdapter::GetTargetArchitecture()
 
 bool GdbAdapter::BreakInto()
 {
+    // ^C is not used in the non-stop mode. vCont;t stops all threads, and the thread waiting in GenericGo() receives
+    // their stops. The connector lock keeps the request from interleaving with a transaction of the adapter thread.
+    if (m_nonStop)
+        return this->m_rspConnector.TransmitAndReceive(RspData("vCont;t")).AsString() == "OK";
+
     char var = '\x03';
     this->m_rspConnector.SendRaw(RspData(&var, sizeof(var)));
     m_isTargetRunning = false;
@@ -762,11 +2232,14 @@ DebugStopReason GdbAdapter::ResponseHandler()
 		if (reply[0] == 'T')
 		{
 			// Target stopped
-			auto map = RspConnector::PacketToUnorderedMap(reply);
-			const auto tid = map["thread"];
+			RspStopReply stop_reply{};
+			stop_reply.Parse(std::string_view(static_cast<const char*>(reply.m_data.GetData()), reply.m_data.GetLength()));
 			m_isTargetRunning = false;
-            m_lastActiveThreadId = tid;
-            return SignalToStopReason(map);
+            m_lastActiveThreadId = stop_reply.m_threadId;
+            LoadExpeditedRegisters(stop_reply);
+            if (stop_reply.m_library || !stop_reply.m_event.empty())
+                InvalidateModuleCache();
+            return SignalToStopReason(stop_reply);
 		}
 		else if (reply[0] == 'W')
 		{
@@ -775,48 +2248,14 @@ DebugStopReason GdbAdapter::ResponseHandler()
 			uint8_t exitCode = strtoul(exitCodeString.c_str(), nullptr, 16);
 			m_isTargetRunning = false;
             m_exitCode = exitCode;
+            InvalidateModuleCache();
             return DebugStopReason::ProcessExited;
 			break;
 		}
 		else if (reply[0] == 'O')
 		{
 			// stdout message
-			const auto string = reply.AsString();
-			const auto message = string.substr(1);
-
-			// These duplicate code in GdbAdapter::ReadMemory(). We should probably add a ParseFromHex() and EncodeAsHex()
-			// to the RspData class.
-			if (message.size() % 2 == 1)
-                continue;
-
-			size_t size = message.size() / 2;
-			if (size == 0)
-				continue;
-
-			std::string result;
-			result.resize(size);
-
-			[](const std::uint8_t* src, std::uint8_t* dst) {
-				const auto char_to_int = [](std::uint8_t input) -> int {
-					if(input >= '0' && input <= '9')
-						return input - '0';
-					if(input >= 'A' && input <= 'F')
-						return input - 'A' + 10;
-					if(input >= 'a' && input <= 'f')
-						return input - 'a' + 10;
-					throw std::invalid_argument("Invalid input string");
-				};
-
-				while(*src && src[1]) {
-					*(dst++) = char_to_int(*src) * 16 + char_to_int(src[1]);
-					src += 2;
-				}
-			}((const std::uint8_t*)message.c_str(), (std::uint8_t*)result.c_str());
-
-			DebuggerEvent event;
-			event.type = StdoutMessageEventType;
-			event.data.messageData.message = result;
-			PostDebuggerEvent(event);
+			HandleAsyncPacket(reply);
 		}
 		else
 		{
@@ -827,14 +2266,239 @@ DebugStopReason GdbAdapter::ResponseHandler()
 
 
 // this should return the information about the target stop
+std::string GdbAdapter::ThreadGoCommand(const std::string& goCommand, std::uint32_t tid)
+{
+    if (goCommand.rfind("vCont;", 0) != 0)
+        return fmt::format("vCont;{}:{:x}", goCommand, tid);
+
+    // The leftmost action that matches the thread applies to it, i.e., one for the thread, for all threads (-1), or
+    // without a thread
+    for (const auto& action : RspConnector::Split(goCommand.substr(6), ";"))
+    {
+        if (action.empty())
+            continue;
+
+        const auto colon = action.find(':');
+        std::uint32_t actionThread{};
+        if ((colon == std::string::npos) || (action.substr(colon + 1) == "-1")
+            || (ParseThreadId(action.substr(colon + 1), actionThread) && (actionThread == tid)))
+            return fmt::format("vCont;{}:{:x}", action.substr(0, colon), tid);
+    }
+    return fmt::format("vCont;c:{:x}", tid);
+}
+
+
 DebugStopReason GdbAdapter::GenericGo(const std::string& goCommand)
 {
-	m_isTargetRunning = true;
-	// TODO: these two calls should be combined
-	m_rspConnector.SendPayload(RspData(goCommand));
-	m_rspConnector.ExpectAck();
+	if (m_nonStop)
+	{
+		{
+			const auto lock = m_rspConnector.Lock();
+			// Stops that arrived since the last wait are recorded first, so they do not end this wait
+			ProcessPendingStops();
+			InvalidateRegisterSnapshot();
+			// The backend acknowledges the resume right away, and reports the stops as notifications
+			if (m_rspConnector.TransmitAndReceive(RspData(goCommand)).AsString() != "OK")
+				throw runtime_error("failed to resume the target");
+			MarkThreadsResumed(goCommand);
+			m_isTargetRunning = true;
+		}
+		auto reason = WaitForNonStopStop();
+		// Only the thread at the breakpoint stopped, so the same command is sent again for that thread alone. A step
+		// stays a step rather than becoming a continue.
+		while ((reason == DebugStopReason::Breakpoint) && IsBreakpointConditionFalse())
+		{
+			{
+				const auto lock = m_rspConnector.Lock();
+				const auto command = ThreadGoCommand(goCommand, m_lastActiveThreadId);
+				InvalidateRegisterSnapshot();
+				if (m_rspConnector.TransmitAndReceive(RspData(command)).AsString() != "OK")
+					break;
+				MarkThreadsResumed(command);
+				m_isTargetRunning = true;
+			}
+			reason = WaitForNonStopStop();
+		}
+		return reason;
+	}
+
+	while (true)
+	{
+		m_isTargetRunning = true;
+		InvalidateRegisterSnapshot();
+		// TODO: these two calls should be combined
+		m_rspConnector.SendPayload(RspData(goCommand));
+		m_rspConnector.ExpectAck();
+
+		const auto reason = ResponseHandler();
+		// The conditions that the backend cannot evaluate are checked here, and the process is resumed when they are
+		// false. A step ends before it reaches another breakpoint, so sending the same command again is fine.
+		if ((reason != DebugStopReason::Breakpoint) || !IsBreakpointConditionFalse())
+			return reason;
+	}
+}
+
+
+// In the non-stop mode, the other threads can keep running while the active one is stopped
+bool GdbAdapter::IsActiveThreadRunning() const
+{
+    // ResumeThread() and StopThread() can change the stopped threads from another thread
+    const auto lock = m_rspConnector.Lock();
+    return m_isTargetRunning || (m_nonStop && !m_stoppedThreads.count(m_lastActiveThreadId));
+}
+
+
+// Record a stop reply of the non-stop mode, from a %Stop notification, a vStopped reply or the reply to "?". The
+// activated thread becomes the active thread, and its expedited registers are loaded.
+DebugStopReason GdbAdapter::RecordNonStopStop(const RspData& reply, bool activate)
+{
+    if (reply.m_data.GetLength() == 0)
+        return DebugStopReason::UnknownReason;
+
+    if ((reply[0] == 'W') || (reply[0] == 'X'))
+    {
+        if (reply[0] == 'W')
+            m_exitCode = strtoul(reply.AsString().substr(1).c_str(), nullptr, 16);
+        m_stoppedThreads.clear();
+        InvalidateModuleCache();
+        return DebugStopReason::ProcessExited;
+    }
+
+    RspStopReply stop_reply{};
+    stop_reply.Parse(std::string_view(static_cast<const char*>(reply.m_data.GetData()), reply.m_data.GetLength()));
+    if (stop_reply.m_hasThread)
+        m_stoppedThreads.insert(stop_reply.m_threadId);
+    if (stop_reply.m_library || !stop_reply.m_event.empty())
+        InvalidateModuleCache();
+
+    if (activate && stop_reply.m_hasThread)
+    {
+        // The backend does not switch the general thread to the stopped one in the non-stop mode
+        if (m_rspConnector.TransmitAndReceive(RspData(string("Hg{:x}"), stop_reply.m_threadId)).AsString() != "OK")
+            throw runtime_error("failed to set thread");
+        m_lastActiveThreadId = stop_reply.m_threadId;
+        InvalidateRegisterSnapshot();
+        LoadExpeditedRegisters(stop_reply);
+    }
+
+    return SignalToStopReason(stop_reply);
+}
+
+
+// The backend sends a notification for the first stop only, and queues the others until they are asked for
+void GdbAdapter::DrainNonStopStops()
+{
+    while (true)
+    {
+        const auto reply = m_rspConnector.TransmitAndReceive(RspData("vStopped"));
+        if ((reply.m_data.GetLength() == 0) || (reply.AsString() == "OK"))
+            break;
+        RecordNonStopStop(reply, false);
+    }
+}
+
+
+// Record the stops that were notified while nothing was waiting for them, e.g., after StopThread()
+void GdbAdapter::ProcessPendingStops()
+{
+    RspData notification;
+    while (m_rspConnector.ReceiveNotification(notification, 0))
+    {
+        const auto text = notification.AsString();
+        if (text.rfind("Stop:", 0) != 0)
+            continue;
+        RecordNonStopStop(RspData(text.substr(5)), false);
+        DrainNonStopStops();
+    }
+}
+
+
+DebugStopReason GdbAdapter::WaitForNonStopStop()
+{
+    while (true)
+    {
+        {
+            const auto lock = m_rspConnector.Lock();
+            RspData notification;
+            if (m_rspConnector.ReceiveNotification(notification, 0))
+            {
+                const auto text = notification.AsString();
+                if (text.rfind("Stop:", 0) != 0)
+                    continue;
+
+                const auto reason = RecordNonStopStop(RspData(text.substr(5)), true);
+                DrainNonStopStops();
+                m_isTargetRunning = false;
+                return reason;
+            }
+        }
+        // Wait without the lock, so BreakInto() can send its request in the meantime
+        m_transport->WaitForData(NON_STOP_POLL_INTERVAL);
+    }
+}
+
+
+// Forget the stops of the threads that a resume packet applies to
+void GdbAdapter::MarkThreadsResumed(const std::string& command)
+{
+    if (command.rfind("vCont;", 0) != 0)
+    {
+        m_stoppedThreads.clear();
+        return;
+    }
+
+    for (const auto& action : RspConnector::Split(command.substr(6), ";"))
+    {
+        // vCont;t stops threads rather than resuming them
+        if (action.empty() || (action[0] == 't'))
+            continue;
+
+        std::uint32_t tid{};
+        const auto colon = action.find(':');
+        if ((colon == std::string::npos) || !ParseThreadId(action.substr(colon + 1), tid))
+        {
+            m_stoppedThreads.clear();
+            return;
+        }
+        m_stoppedThreads.erase(tid);
+    }
+}
+
+
+bool GdbAdapter::ResumeThread(std::uint32_t tid)
+{
+    if (!m_nonStop)
+        return false;
+
+    const auto lock = m_rspConnector.Lock();
+    // While the adapter thread waits in GenericGo(), the stops are its to receive
+    if (!m_isTargetRunning)
+        ProcessPendingStops();
+    const auto command = fmt::format("vCont;c:{:x}", tid);
+    if (m_rspConnector.TransmitAndReceive(RspData(command)).AsString() != "OK")
+        return false;
+
+    MarkThreadsResumed(command);
+    if (tid == m_lastActiveThreadId)
+        InvalidateRegisterSnapshot();
+    return true;
+}
+
+
+bool GdbAdapter::StopThread(std::uint32_t tid)
+{
+    if (!m_nonStop)
+        return false;
 
-	return ResponseHandler();
+    const auto lock = m_rspConnector.Lock();
+    if (!m_isTargetRunning)
+        ProcessPendingStops();
+    // A stopped thread would not report another stop
+    if (m_stoppedThreads.count(tid))
+        return true;
+    // The stop is not waited for here, since the adapter thread can be waiting in GenericGo() already. It either
+    // receives the stop there, or it is recorded before the next request that depends on it.
+    return m_rspConnector.TransmitAndReceive(RspData(fmt::format("vCont;t:{:x}", tid))).AsString() == "OK";
 }
 
 
@@ -847,10 +2511,39 @@ DebugStopReason GdbAdapter::Go()
 
 DebugStopReason GdbAdapter::StepInto()
 {
+    // In the non-stop mode, an action without a thread applies to all threads, so only the active one is stepped
+    if (m_nonStop)
+        return GenericGo(fmt::format("vCont;s:{:x}", m_lastActiveThreadId));
     return GenericGo("vCont;s");
 }
 
 
+DebugStopReason GdbAdapter::StepRange(std::uintptr_t start, std::uintptr_t end)
+{
+    // The backend steps while the pc stays in the range, and only reports the stop out of it. Like the s action, only
+    // the active thread is stepped in the non-stop mode.
+    if (m_rangeStepping)
+    {
+        if (m_nonStop || m_lastActiveThreadId)
+            return GenericGo(fmt::format("vCont;r{:x},{:x}:{:x}", start, end, m_lastActiveThreadId));
+        return GenericGo(fmt::format("vCont;r{:x},{:x}", start, end));
+    }
+
+    // Otherwise the steps are done here. The pc is expedited in the stop reply, so each one is a single round trip, and
+    // the controller does not process the stops in the range.
+    while (true)
+    {
+        const auto reason = StepInto();
+        if (reason != DebugStopReason::SingleStep)
+            return reason;
+
+        const auto ip = GetInstructionOffset();
+        if ((ip < start) || (ip >= end))
+            return reason;
+    }
+}
+
+
 DebugStopReason GdbAdapter::StepOver()
 {
     // GdbAdapter does not support StepOver(), it relies on DebuggerState to do a breakpoint and continue execution
@@ -863,21 +2556,23 @@ std::string GdbAdapter::InvokeBackendCommand(const std::string& command)
 	return "";
 }
 
-std::uintptr_t GdbAdapter::GetInstructionOffset()
+std::string GdbAdapter::GetInstructionPointerRegisterName()
 {
     // TODO: obviously this will only support x86/x86_64, so we need a more systematic way for it
-    std::string ipRegisterName = "";
 	std::string targetArch = GetTargetArchitecture();
     if ((targetArch == "x86") || (targetArch == "i386"))
-        ipRegisterName = "eip";
+        return "eip";
     else if (targetArch == "x86_64")
-        ipRegisterName = "rip";
+        return "rip";
     else if ((targetArch == "aarch64") || (targetArch == "arm64"))
-        ipRegisterName = "pc";
+        return "pc";
     else
-        ipRegisterName = "pc";
+        return "pc";
+}
 
-	uint64_t value = this->ReadRegister(ipRegisterName).m_value;
+std::uintptr_t GdbAdapter::GetInstructionOffset()
+{
+	uint64_t value = this->ReadRegister(GetInstructionPointerRegisterName()).m_value;
     return value;
 }
 
@@ -897,12 +2592,49 @@ bool GdbAdapter::SupportFeature(DebugAdapterCapacity feature)
         return true;
     case DebugAdapterSupportThreads:
         return true;
+    case DebugAdapterSupportRangeStepping:
+        return true;
     default:
         return false;
     }
 }
 
-DebugStopReason GdbAdapter::SignalToStopReason(std::unordered_map<std::string, std::uint64_t>& map)
+Ref<Metadata> GdbAdapter::GetProperty(const std::string& name)
+{
+    if (name == "memory_read_mode")
+        return new Metadata(std::string(m_binaryMemoryRead ? "binary" : "hex"));
+    else if (name == "memory_write_mode")
+        return new Metadata(std::string(m_binaryMemoryWrite ? "binary" : "hex"));
+    else if (name == "non_stop")
+        return new Metadata(m_nonStopRequested);
+    else if (name == "non_stop_active")
+        return new Metadata(m_nonStop);
+    else if (name == "rsp_statistics")
+    {
+        std::map<std::string, Ref<Metadata>> values;
+        values["packets_sent"] = new Metadata((uint64_t)m_rspStatistics.m_packetsSent);
+        values["packets_received"] = new Metadata((uint64_t)m_rspStatistics.m_packetsReceived);
+        values["bytes_sent"] = new Metadata((uint64_t)m_rspStatistics.m_bytesSent);
+        values["bytes_received"] = new Metadata((uint64_t)m_rspStatistics.m_bytesReceived);
+        return new Metadata(values);
+    }
+    return nullptr;
+}
+
+
+bool GdbAdapter::SetProperty(const std::string& name, const Ref<Metadata>& value)
+{
+    // Takes effect on the next connection
+    if ((name == "non_stop") && value->IsBoolean())
+    {
+        m_nonStopRequested = value->GetBoolean();
+        return true;
+    }
+    return false;
+}
+
+
+DebugStopReason GdbAdapter::SignalToStopReason(const RspStopReply& stopReply)
 {
     static std::unordered_map<std::uint64_t, DebugStopReason> signal_lookup = {
             {1, DebugStopReason::SignalHup},
@@ -938,59 +2670,47 @@ DebugStopReason GdbAdapter::SignalToStopReason(std::unordered_map<std::string, s
             { 31, DebugStopReason::SignalSys },
     };
 
-	if (map.find("signal") != map.end())
+	if (RecordWatchpointStop(stopReply))
+		return DebugStopReason::Watchpoint;
+
+	uint64_t signal = stopReply.m_signal;
+	if ((signal == 5) && (stopReply.m_swbreak || stopReply.m_hwbreak))
 	{
-		uint64_t signal = map["signal"];
-		if ((signal == 5) && (map.find("swbreak") != map.end()))
-		{
-			return DebugStopReason::Breakpoint;
-		}
-		else if (signal_lookup.find(signal) != signal_lookup.end())
-		{
-			return signal_lookup[signal];
-		}
+		return DebugStopReason::Breakpoint;
+	}
+	else if (signal_lookup.find(signal) != signal_lookup.end())
+	{
+		return signal_lookup[signal];
 	}
 
     return DebugStopReason::UnknownReason;
 }
 
 
+bool GdbAdapter::RecordWatchpointStop(const RspStopReply& stopReply)
+{
+    if (stopReply.m_watchKind.empty())
+        return false;
+
+    m_lastWatchpointAddress = stopReply.m_watchAddress;
+    return true;
+}
+
+
 void GdbAdapter::HandleAsyncPacket(const RspData& data)
 {
     if ( data.m_data[0] != 'O' )
         return;
 
-    const auto string = data.AsString();
-    const auto message = string.substr(1);
-
-	// These duplicate code in GdbAdapter::ReadMemory(). We should probably add a ParseFromHex() and EncodeAsHex()
-	// to the RspData class.
-	if (message.size() % 2 == 1)
-		return;
-
-	size_t size = message.size() / 2;
-	if (size == 0)
-		return;
-
-	std::string result;
-	result.resize(size);
-
-	[](const std::uint8_t* src, std::uint8_t* dst) {
-		const auto char_to_int = [](std::uint8_t input) -> int {
-			if(input >= '0' && input <= '9')
-				return input - '0';
-			if(input >= 'A' && input <= 'F')
-				return input - 'A' + 10;
-			if(input >= 'a' && input <= 'f')
-				return input - 'a' + 10;
-			throw std::invalid_argument("Invalid input string");
-		};
-
-		while(*src && src[1]) {
-			*(dst++) = char_to_int(*src) * 16 + char_to_int(src[1]);
-			src += 2;
-		}
-	}((const std::uint8_t*)message.c_str(), (std::uint8_t*)result.c_str());
+    // The message is hex encoded after the 'O'
+    const auto length = data.m_data.GetLength() - 1;
+    if ((length % 2 == 1) || (length == 0))
+        return;
+
+    std::string result(length / 2, '\0');
+    if (!HexCodec::Decode(static_cast<const char*>(data.m_data.GetData()) + 1, result.size(),
+                          reinterpret_cast<std::uint8_t*>(result.data())))
+        return;
 
 	DebuggerEvent event;
 	event.type = StdoutMessageEventType;
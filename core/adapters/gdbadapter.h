@@ -18,8 +18,14 @@ limitations under the License.
 #include "../debugadapter.h"
 #include "../debugadaptertype.h"
 #include "rspconnector.h"
+#include "agentexpression.h"
+#include <pugixml/pugixml.hpp>
+#include <atomic>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <queue>
+#include <unordered_set>
 #include "../semaphore.h"
 
 namespace BinaryNinjaDebugger
@@ -29,22 +35,61 @@ namespace BinaryNinjaDebugger
 	protected:
 		struct RegisterInfo
 		{
+			std::string m_name{};
 			std::uint32_t m_bitSize{};
 			std::uint32_t m_regNum{};
+			// Byte offset of the register in the g packet contents
 			std::uint32_t m_offset{};
 		};
 
 		DebugStopReason m_lastStopReason{};
 
-		using register_pair = std::pair<std::string, RegisterInfo>;
-
-		Socket* m_socket;
+		std::unique_ptr<Transport> m_transport{};
 		RspConnector m_rspConnector{};
-
-		std::map<std::string, RegisterInfo> m_registerInfo{};
+		RspStatistics m_rspStatistics{};
+		// Takes over a connected transport and performs the initial handshake with the backend
+		bool InitializeConnection(std::unique_ptr<Transport> transport);
+
+		// The registers in the order of the g packet, built once from target.xml
+		std::vector<RegisterInfo> m_registerLayout{};
+		std::unordered_map<std::string, std::size_t> m_registerIndexByName{};
+		// Indexed by register number, SIZE_MAX for the numbers that are not used
+		std::vector<std::size_t> m_registerIndexByNumber{};
+		void ParseRegisterFeature(const pugi::xml_node& feature, std::vector<RegisterInfo>& registers);
+		void BuildRegisterLayout(std::vector<RegisterInfo> registers);
+		const RegisterInfo* FindRegister(const std::string& name) const;
+		const RegisterInfo* FindRegister(std::uint32_t regNum) const;
 
 		std::uint32_t m_internalBreakpointId{};
-		std::vector<DebugBreakpoint> m_debugBreakpoints{};
+		// Indexed by address, so looking up a breakpoint does not scan all of them
+		std::unordered_map<std::uintptr_t, DebugBreakpoint> m_debugBreakpoints{};
+		std::size_t GetSoftwareBreakpointKind() const;
+
+		struct BreakpointCondition
+		{
+			std::string m_source;
+			AgentExpression m_expression;
+			// Evaluated by the backend when the breakpoint is hit, rather than by the adapter after the stop
+			bool m_serverSide{};
+			std::uint16_t m_hitCountVariable{};
+		};
+		std::unordered_map<std::uintptr_t, BreakpointCondition> m_breakpointConditions{};
+		// The hit counts of the conditions evaluated by the adapter, indexed by trace state variable
+		std::unordered_map<std::uint16_t, std::uint64_t> m_conditionVariables{};
+		std::uint16_t m_nextConditionVariable{1};
+		std::string BreakpointInsertRequest(std::uintptr_t address) const;
+		bool DefineConditionVariable(std::uint16_t variable);
+		bool IsBreakpointConditionFalse();
+
+		// The watchpoints set with the Z2 (write), Z3 (read) and Z4 (access) packets, by address
+		std::unordered_map<std::uintptr_t, DebugWatchpoint> m_watchpoints{};
+		std::uintptr_t m_lastWatchpointAddress{};
+
+		// The tracepoints of the current trace, for the memory ranges to read from its frames
+		std::unordered_map<std::uint32_t, DebugTracepoint> m_tracepoints{};
+		std::vector<std::string> TracepointDefinitionRequests(const DebugTracepoint& tracepoint);
+		std::unordered_map<std::string, std::uintptr_t> DecodeTraceFrameRegisters(const RspData& reply) const;
+		std::vector<std::pair<std::uintptr_t, std::size_t>> ReadTraceFrameMemoryBlocks();
 
 		std::uint32_t m_lastActiveThreadId{};
 		uint8_t m_exitCode{};
@@ -54,16 +99,92 @@ namespace BinaryNinjaDebugger
 		std::string ExecuteShellCommand(const std::string& command);
 		virtual bool LoadRegisterInfo();
 
+		// target.xml with the includes resolved, read once per connection. The assembled document is also cached on
+		// disk, so reconnecting to the same server skips reading the included files.
+		std::string m_targetDescription{};
+		void ResolveXmlIncludes(pugi::xml_node node, std::size_t depth);
+		std::string GetTargetDescriptionCachePath(const std::string& targetXml);
+		const std::string& GetTargetDescription();
+
 		// This name is confusing. It actually means whether the target is running, so certain operations, e.g.,
-		// reading memory, adding breakpoint, cannot be carried out at the moment.
-		bool m_isTargetRunning;
+		// reading memory, adding breakpoint, cannot be carried out at the moment. It is read from the threads that
+		// break into or resume the target, hence atomic.
+		std::atomic<bool> m_isTargetRunning;
 
 		// Cache the name of the remote architecture, so there is no need to read it repeatedly.
 		// However, this does not handle the case when the remote arch changes. Though other changes are also needed to
 		// support the case -- so we do not really lose a lot anyways.
 		std::string m_remoteArch;
 
-		virtual DebugStopReason SignalToStopReason(std::unordered_map<std::string, std::uint64_t>& map);
+		// Whether the backend accepts the binary x/X memory packets, which are about half the size of the hex
+		// m/M packets. These are probed after connecting, and the hex packets are used as the fallback.
+		bool m_binaryMemoryRead{};
+		bool m_binaryMemoryWrite{};
+		// gdbserver prefixes the data in an x reply with a 'b', while debugserver/lldb-server do not
+		bool m_binaryReadPrefixed{};
+		void NegotiateMemoryTransfer();
+
+		// Whether the backend lists the r action in the vCont? reply, which steps through a range of addresses in one
+		// request. gdbserver supports it, and debugserver/lldb-server do not.
+		bool m_rangeStepping{};
+		std::size_t GetMemoryReadChunkSize() const;
+		RspData MemoryReadRequest(std::uintptr_t address, std::size_t size) const;
+		DataBuffer DecodeMemoryReadReply(const RspData& reply) const;
+		std::vector<RspData> MemoryWriteRequests(std::uintptr_t address, const DataBuffer& buffer) const;
+
+		std::string GetRemoteFileCachePath(const std::string& path, std::uint64_t size, std::uint64_t mtime);
+
+		static bool DecodeRegisterValue(const std::string& reply, std::size_t bitSize, std::uintptr_t& value);
+		static bool ParseThreadId(const std::string& text, std::uint32_t& tid);
+		// The action of a resume packet that applies to the thread, as a packet for that thread alone
+		static std::string ThreadGoCommand(const std::string& goCommand, std::uint32_t tid);
+		std::vector<DebugThread> ReadThreadListXfer();
+		std::vector<DebugThread> ReadThreadListPaged();
+		void ReadThreadInstructionOffsets(std::vector<DebugThread>& threads);
+
+		// Registers of the current thread at the last stop, as raw bytes laid out like the g packet contents. The stop
+		// reply expedites a few of them, e.g., the pc and the sp, and the rest are read with a g packet when one of
+		// them is asked for.
+		std::vector<std::uint8_t> m_registerBlock{};
+		std::vector<bool> m_registerValid{};
+		bool m_registerSnapshotComplete{};
+		void InvalidateRegisterSnapshot();
+		bool StoreRegisterBytes(const RegisterInfo& info, const char* hex, std::size_t length);
+		DebugRegister SnapshotRegister(const RegisterInfo& info) const;
+		void LoadExpeditedRegisters(const RspStopReply& stopReply);
+		void FetchAllRegisters();
+
+		// The module list is kept between the stops. It is read again after a library load/unload or exec stop, or
+		// when the svr4 link_map chain has changed since it was read.
+		std::vector<DebugModule> m_moduleCache{};
+		bool m_moduleCacheValid{};
+		// The addresses of the svr4 link_map entries, and their l_next pointers as raw target bytes when the list was
+		// read. The chain changes when a library is loaded or unloaded.
+		std::vector<std::uintptr_t> m_linkMapAddresses{};
+		std::string m_linkMapGeneration{};
+		void InvalidateModuleCache();
+		std::string ReadLinkMapGeneration(const std::vector<std::uintptr_t>& linkMaps);
+		std::vector<DebugModule> ReadModuleListSvr4();
+		std::vector<DebugModule> ReadModuleListMaps();
+		static void ParseProcMaps(std::string_view data, std::map<std::string, BNAddressRange>& moduleRanges);
+		static std::string CanonicalModulePath(const std::string& path);
+
+		// In the non-stop mode, the threads stop and resume individually, and the stops arrive as %Stop
+		// notifications. It is requested with the "non_stop" property before connecting.
+		bool m_nonStopRequested{};
+		bool m_nonStop{};
+		// Guarded by the connector lock, since BreakInto(), ResumeThread() and StopThread() run on other threads
+		std::unordered_set<std::uint32_t> m_stoppedThreads{};
+		bool IsActiveThreadRunning() const;
+		DebugStopReason RecordNonStopStop(const RspData& reply, bool activate);
+		void DrainNonStopStops();
+		void ProcessPendingStops();
+		DebugStopReason WaitForNonStopStop();
+		void MarkThreadsResumed(const std::string& command);
+
+		virtual DebugStopReason SignalToStopReason(const RspStopReply& stopReply);
+		// Records the data address if the stop reply has a watch, rwatch or awatch field
+		bool RecordWatchpointStop(const RspStopReply& stopReply);
 
 	public:
 		GdbAdapter(BinaryView* data, bool redirectGDBServer = true);
@@ -85,11 +206,26 @@ namespace BinaryNinjaDebugger
 		bool SetActiveThreadId(std::uint32_t tid) override;
 
 		DebugBreakpoint AddBreakpoint(std::uintptr_t address, unsigned long breakpoint_type = 0) override;
+		DebugBreakpoint AddBreakpoint(const ModuleNameAndOffset& address, unsigned long breakpoint_type = 0) override;
+		std::vector<DebugBreakpoint> AddBreakpoints(const std::vector<std::uintptr_t>& addresses) override;
+		std::vector<DebugBreakpoint> AddBreakpoints(const std::vector<ModuleNameAndOffset>& addresses) override;
 
 		bool RemoveBreakpoint(const DebugBreakpoint& breakpoint) override;
+		bool RemoveBreakpoints(const std::vector<DebugBreakpoint>& breakpoints) override;
 
 		std::vector<DebugBreakpoint> GetBreakpointList() const override;
 		bool BreakpointExists(uint64_t address) const;
+		bool SetBreakpointCondition(std::uintptr_t address, const std::string& condition) override;
+
+		bool AddWatchpoint(std::uintptr_t address, std::size_t size, DebugWatchpointType type) override;
+		bool RemoveWatchpoint(std::uintptr_t address) override;
+		std::vector<DebugWatchpoint> GetWatchpointList() const override;
+		std::uintptr_t GetStopDataAddress() override { return m_lastWatchpointAddress; }
+
+		bool StartTrace(const std::vector<DebugTracepoint>& tracepoints) override;
+		bool StopTrace() override;
+		DebugTraceStatus GetTraceStatus() override;
+		std::vector<DebugTraceFrame> GetTraceFrames() override;
 
 		std::unordered_map<std::string, DebugRegister> ReadAllRegisters() override;
 		DebugRegister ReadRegister(const std::string& reg) override;
@@ -97,6 +233,7 @@ namespace BinaryNinjaDebugger
 
 		DataBuffer ReadMemory(std::uintptr_t address, std::size_t size) override;
 		bool WriteMemory(std::uintptr_t address, const DataBuffer& buffer) override;
+		// Read a whole file from the remote filesystem with host I/O. Regular files are also kept in a local cache.
 		std::string GetRemoteFile(const std::string& path);
 		std::vector<DebugModule> GetModuleList() override;
 
@@ -110,14 +247,23 @@ namespace BinaryNinjaDebugger
 		DebugStopReason Go() override;
 		DebugStopReason StepInto() override;
 		DebugStopReason StepOver() override;
+		DebugStopReason StepRange(std::uintptr_t start, std::uintptr_t end) override;
 
 		std::string InvokeBackendCommand(const std::string& command) override;
+		std::string GetInstructionPointerRegisterName();
 		std::uintptr_t GetInstructionOffset() override;
 
 		DebugStopReason ResponseHandler();
 
+		// Resume or stop a single thread in the non-stop mode. Neither waits for the thread to stop.
+		bool ResumeThread(std::uint32_t tid) override;
+		bool StopThread(std::uint32_t tid) override;
+
 		bool SupportFeature(DebugAdapterCapacity feature) override;
 		void HandleAsyncPacket(const RspData& data);
+
+		Ref<Metadata> GetProperty(const std::string& name) override;
+		bool SetProperty(const std::string& name, const Ref<Metadata>& value) override;
 	};
 
 
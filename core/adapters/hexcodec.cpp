@@ -0,0 +1,443 @@
+/*
+Copyright 2020-2022 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "hexcodec.h"
+#include <array>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define HEXCODEC_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define HEXCODEC_NEON
+#include <arm_neon.h>
+#endif
+
+// MSVC does not need the target attribute to emit AVX2 instructions
+#if defined(HEXCODEC_X86) && (defined(__GNUC__) || defined(__clang__))
+#define HEXCODEC_TARGET_AVX2 __attribute__((target("avx2")))
+#define HEXCODEC_TARGET_SSE2 __attribute__((target("sse2")))
+#else
+#define HEXCODEC_TARGET_AVX2
+#define HEXCODEC_TARGET_SSE2
+#endif
+
+using namespace BinaryNinjaDebugger;
+
+
+namespace
+{
+	using DecodeFunction = bool (*)(const char*, std::size_t, std::uint8_t*);
+	using EncodeFunction = void (*)(const std::uint8_t*, std::size_t, char*);
+
+	constexpr std::uint8_t INVALID_NIBBLE = 0xff;
+
+	constexpr std::array<std::uint8_t, 256> MakeDecodeTable()
+	{
+		std::array<std::uint8_t, 256> table{};
+		for (std::size_t i = 0; i < table.size(); i++)
+			table[i] = INVALID_NIBBLE;
+		for (std::uint8_t i = 0; i < 10; i++)
+			table['0' + i] = i;
+		for (std::uint8_t i = 0; i < 6; i++)
+		{
+			table['a' + i] = 10 + i;
+			table['A' + i] = 10 + i;
+		}
+		return table;
+	}
+
+	constexpr std::array<std::uint8_t, 256> DECODE_TABLE = MakeDecodeTable();
+	constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+
+	bool DecodeScalar(const char* src, std::size_t size, std::uint8_t* dst)
+	{
+		for (std::size_t i = 0; i < size; i++)
+		{
+			const std::uint8_t high = DECODE_TABLE[static_cast<std::uint8_t>(src[2 * i])];
+			const std::uint8_t low = DECODE_TABLE[static_cast<std::uint8_t>(src[2 * i + 1])];
+			if ((high | low) & 0xf0)
+				return false;
+			dst[i] = (high << 4) | low;
+		}
+		return true;
+	}
+
+
+	void EncodeScalar(const std::uint8_t* src, std::size_t size, char* dst)
+	{
+		for (std::size_t i = 0; i < size; i++)
+		{
+			dst[2 * i] = HEX_DIGITS[src[i] >> 4];
+			dst[2 * i + 1] = HEX_DIGITS[src[i] & 0xf];
+		}
+	}
+
+
+#ifdef HEXCODEC_X86
+	// Converts 16 hex characters into their nibble values, and clears the bits in valid for the non-hex characters.
+	// The comparisons are signed, which also rejects the characters >= 0x80 since they wrap to negative values.
+	HEXCODEC_TARGET_SSE2 inline __m128i NibblesSSE2(__m128i chars, __m128i& valid)
+	{
+		const __m128i digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+		const __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(digit, _mm_set1_epi8(-1)),
+			_mm_cmplt_epi8(digit, _mm_set1_epi8(10)));
+		const __m128i alpha = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+		const __m128i isAlpha = _mm_and_si128(_mm_cmpgt_epi8(alpha, _mm_set1_epi8(-1)),
+			_mm_cmplt_epi8(alpha, _mm_set1_epi8(6)));
+		valid = _mm_and_si128(valid, _mm_or_si128(isDigit, isAlpha));
+		return _mm_or_si128(_mm_and_si128(isDigit, digit),
+			_mm_and_si128(isAlpha, _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+	}
+
+
+	// Merges the nibble pairs into bytes, one per 16-bit lane. The first character of a pair is the low byte.
+	HEXCODEC_TARGET_SSE2 inline __m128i MergeNibblesSSE2(__m128i nibbles)
+	{
+		const __m128i high = _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00ff)), 4);
+		const __m128i low = _mm_srli_epi16(nibbles, 8);
+		return _mm_or_si128(high, low);
+	}
+
+
+	HEXCODEC_TARGET_SSE2 inline __m128i AsciiSSE2(__m128i nibbles)
+	{
+		const __m128i isAlpha = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+		return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')),
+			_mm_and_si128(isAlpha, _mm_set1_epi8('a' - '0' - 10)));
+	}
+
+
+	HEXCODEC_TARGET_SSE2 bool DecodeSSE2(const char* src, std::size_t size, std::uint8_t* dst)
+	{
+		std::size_t i = 0;
+		__m128i valid = _mm_set1_epi8(-1);
+		for (; i + 16 <= size; i += 16)
+		{
+			const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+			const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i + 16));
+			const __m128i bytes = _mm_packus_epi16(MergeNibblesSSE2(NibblesSSE2(first, valid)),
+				MergeNibblesSSE2(NibblesSSE2(second, valid)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), bytes);
+		}
+		if (_mm_movemask_epi8(valid) != 0xffff)
+			return false;
+		return DecodeScalar(src + 2 * i, size - i, dst + i);
+	}
+
+
+	HEXCODEC_TARGET_SSE2 void EncodeSSE2(const std::uint8_t* src, std::size_t size, char* dst)
+	{
+		std::size_t i = 0;
+		const __m128i mask = _mm_set1_epi8(0xf);
+		for (; i + 16 <= size; i += 16)
+		{
+			const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			const __m128i high = AsciiSSE2(_mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+			const __m128i low = AsciiSSE2(_mm_and_si128(bytes, mask));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i), _mm_unpacklo_epi8(high, low));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i + 16), _mm_unpackhi_epi8(high, low));
+		}
+		EncodeScalar(src + i, size - i, dst + 2 * i);
+	}
+
+
+	HEXCODEC_TARGET_AVX2 inline __m256i NibblesAVX2(__m256i chars, __m256i& valid)
+	{
+		const __m256i digit = _mm256_sub_epi8(chars, _mm256_set1_epi8('0'));
+		const __m256i isDigit = _mm256_and_si256(_mm256_cmpgt_epi8(digit, _mm256_set1_epi8(-1)),
+			_mm256_cmpgt_epi8(_mm256_set1_epi8(10), digit));
+		const __m256i alpha = _mm256_sub_epi8(_mm256_or_si256(chars, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+		const __m256i isAlpha = _mm256_and_si256(_mm256_cmpgt_epi8(alpha, _mm256_set1_epi8(-1)),
+			_mm256_cmpgt_epi8(_mm256_set1_epi8(6), alpha));
+		valid = _mm256_and_si256(valid, _mm256_or_si256(isDigit, isAlpha));
+		return _mm256_or_si256(_mm256_and_si256(isDigit, digit),
+			_mm256_and_si256(isAlpha, _mm256_add_epi8(alpha, _mm256_set1_epi8(10))));
+	}
+
+
+	HEXCODEC_TARGET_AVX2 inline __m256i MergeNibblesAVX2(__m256i nibbles)
+	{
+		const __m256i high = _mm256_slli_epi16(_mm256_and_si256(nibbles, _mm256_set1_epi16(0x00ff)), 4);
+		const __m256i low = _mm256_srli_epi16(nibbles, 8);
+		return _mm256_or_si256(high, low);
+	}
+
+
+	HEXCODEC_TARGET_AVX2 inline __m256i AsciiAVX2(__m256i nibbles)
+	{
+		const __m256i isAlpha = _mm256_cmpgt_epi8(nibbles, _mm256_set1_epi8(9));
+		return _mm256_add_epi8(_mm256_add_epi8(nibbles, _mm256_set1_epi8('0')),
+			_mm256_and_si256(isAlpha, _mm256_set1_epi8('a' - '0' - 10)));
+	}
+
+
+	HEXCODEC_TARGET_AVX2 bool DecodeAVX2(const char* src, std::size_t size, std::uint8_t* dst)
+	{
+		std::size_t i = 0;
+		__m256i valid = _mm256_set1_epi8(-1);
+		for (; i + 32 <= size; i += 32)
+		{
+			const __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i));
+			const __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i + 32));
+			// The pack works within the 128-bit lanes, so the middle quadwords are swapped afterwards
+			const __m256i packed = _mm256_packus_epi16(MergeNibblesAVX2(NibblesAVX2(first, valid)),
+				MergeNibblesAVX2(NibblesAVX2(second, valid)));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permute4x64_epi64(packed, 0xd8));
+		}
+		if (_mm256_movemask_epi8(valid) != -1)
+			return false;
+		return DecodeSSE2(src + 2 * i, size - i, dst + i);
+	}
+
+
+	HEXCODEC_TARGET_AVX2 void EncodeAVX2(const std::uint8_t* src, std::size_t size, char* dst)
+	{
+		std::size_t i = 0;
+		const __m256i mask = _mm256_set1_epi8(0xf);
+		for (; i + 32 <= size; i += 32)
+		{
+			const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+			const __m256i high = AsciiAVX2(_mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask));
+			const __m256i low = AsciiAVX2(_mm256_and_si256(bytes, mask));
+			// The unpacks also work within the 128-bit lanes
+			const __m256i first = _mm256_unpacklo_epi8(high, low);
+			const __m256i second = _mm256_unpackhi_epi8(high, low);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i), _mm256_permute2x128_si256(first, second, 0x20));
+			_mm256_storeu_si256(
+				reinterpret_cast<__m256i*>(dst + 2 * i + 32), _mm256_permute2x128_si256(first, second, 0x31));
+		}
+		EncodeSSE2(src + i, size - i, dst + 2 * i);
+	}
+
+
+	bool CpuSupportsAVX2()
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+		__cpuid(info, 1);
+		// OSXSAVE and AVX, and the OS must save the YMM registers on context switches
+		if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+			return false;
+		if ((_xgetbv(0) & 0x6) != 0x6)
+			return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+
+
+	bool CpuSupportsSSE2()
+	{
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		return true;
+#elif defined(__GNUC__) || defined(__clang__)
+		return __builtin_cpu_supports("sse2");
+#else
+		return false;
+#endif
+	}
+#endif
+
+
+#ifdef HEXCODEC_NEON
+	inline uint8x16_t NibblesNEON(uint8x16_t chars, uint8x16_t& valid)
+	{
+		const uint8x16_t digit = vsubq_u8(chars, vdupq_n_u8('0'));
+		const uint8x16_t isDigit = vcltq_u8(digit, vdupq_n_u8(10));
+		const uint8x16_t alpha = vsubq_u8(vorrq_u8(chars, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+		const uint8x16_t isAlpha = vcltq_u8(alpha, vdupq_n_u8(6));
+		valid = vandq_u8(valid, vorrq_u8(isDigit, isAlpha));
+		return vbslq_u8(isDigit, digit, vaddq_u8(alpha, vdupq_n_u8(10)));
+	}
+
+
+	bool DecodeNEON(const char* src, std::size_t size, std::uint8_t* dst)
+	{
+		std::size_t i = 0;
+		uint8x16_t valid = vdupq_n_u8(0xff);
+		for (; i + 16 <= size; i += 16)
+		{
+			// De-interleave the high and the low nibble characters
+			const uint8x16x2_t chars = vld2q_u8(reinterpret_cast<const std::uint8_t*>(src + 2 * i));
+			const uint8x16_t high = NibblesNEON(chars.val[0], valid);
+			const uint8x16_t low = NibblesNEON(chars.val[1], valid);
+			vst1q_u8(dst + i, vorrq_u8(vshlq_n_u8(high, 4), low));
+		}
+		if (vminvq_u8(valid) != 0xff)
+			return false;
+		return DecodeScalar(src + 2 * i, size - i, dst + i);
+	}
+
+
+	void EncodeNEON(const std::uint8_t* src, std::size_t size, char* dst)
+	{
+		std::size_t i = 0;
+		const uint8x16_t digits = vld1q_u8(reinterpret_cast<const std::uint8_t*>(HEX_DIGITS));
+		for (; i + 16 <= size; i += 16)
+		{
+			const uint8x16_t bytes = vld1q_u8(src + i);
+			uint8x16x2_t chars;
+			chars.val[0] = vqtbl1q_u8(digits, vshrq_n_u8(bytes, 4));
+			chars.val[1] = vqtbl1q_u8(digits, vandq_u8(bytes, vdupq_n_u8(0xf)));
+			vst2q_u8(reinterpret_cast<std::uint8_t*>(dst + 2 * i), chars);
+		}
+		EncodeScalar(src + i, size - i, dst + 2 * i);
+	}
+#endif
+
+
+	struct KernelSelection
+	{
+		HexCodec::Kernel kernel;
+		DecodeFunction decode;
+		EncodeFunction encode;
+	};
+
+
+	// Returns false if the kernel is not built for this architecture, or the host CPU does not support it
+	bool FindKernel(HexCodec::Kernel kernel, KernelSelection& selection)
+	{
+		switch (kernel)
+		{
+		case HexCodec::ScalarKernel:
+			selection = {kernel, DecodeScalar, EncodeScalar};
+			return true;
+#ifdef HEXCODEC_X86
+		case HexCodec::AVX2Kernel:
+			if (!CpuSupportsAVX2())
+				return false;
+			selection = {kernel, DecodeAVX2, EncodeAVX2};
+			return true;
+		case HexCodec::SSE2Kernel:
+			if (!CpuSupportsSSE2())
+				return false;
+			selection = {kernel, DecodeSSE2, EncodeSSE2};
+			return true;
+#endif
+#ifdef HEXCODEC_NEON
+		case HexCodec::NEONKernel:
+			selection = {kernel, DecodeNEON, EncodeNEON};
+			return true;
+#endif
+		default:
+			return false;
+		}
+	}
+
+
+	KernelSelection SelectKernel()
+	{
+		// The fastest one first
+		KernelSelection selection{};
+		for (const auto kernel: {HexCodec::AVX2Kernel, HexCodec::SSE2Kernel, HexCodec::NEONKernel})
+		{
+			if (FindKernel(kernel, selection))
+				return selection;
+		}
+		FindKernel(HexCodec::ScalarKernel, selection);
+		return selection;
+	}
+
+
+	const KernelSelection& GetKernelSelection()
+	{
+		static const KernelSelection selection = SelectKernel();
+		return selection;
+	}
+}
+
+
+bool HexCodec::Decode(const char* src, std::size_t size, std::uint8_t* dst)
+{
+	return GetKernelSelection().decode(src, size, dst);
+}
+
+
+void HexCodec::Encode(const std::uint8_t* src, std::size_t size, char* dst)
+{
+	GetKernelSelection().encode(src, size, dst);
+}
+
+
+std::string HexCodec::Encode(const std::uint8_t* src, std::size_t size)
+{
+	std::string result(2 * size, '\0');
+	Encode(src, size, result.data());
+	return result;
+}
+
+
+std::string HexCodec::Encode(const std::string& src)
+{
+	return Encode(reinterpret_cast<const std::uint8_t*>(src.data()), src.size());
+}
+
+
+HexCodec::Kernel HexCodec::GetKernel()
+{
+	return GetKernelSelection().kernel;
+}
+
+
+bool HexCodec::IsKernelSupported(Kernel kernel)
+{
+	KernelSelection selection{};
+	return FindKernel(kernel, selection);
+}
+
+
+bool HexCodec::Decode(Kernel kernel, const char* src, std::size_t size, std::uint8_t* dst)
+{
+	KernelSelection selection{};
+	if (!FindKernel(kernel, selection))
+		return false;
+	return selection.decode(src, size, dst);
+}
+
+
+bool HexCodec::Encode(Kernel kernel, const std::uint8_t* src, std::size_t size, char* dst)
+{
+	KernelSelection selection{};
+	if (!FindKernel(kernel, selection))
+		return false;
+	selection.encode(src, size, dst);
+	return true;
+}
+
+
+const char* HexCodec::GetKernelName(Kernel kernel)
+{
+	switch (kernel)
+	{
+	case SSE2Kernel:
+		return "sse2";
+	case AVX2Kernel:
+		return "avx2";
+	case NEONKernel:
+		return "neon";
+	default:
+		return "scalar";
+	}
+}
@@ -0,0 +1,57 @@
+/*
+Copyright 2020-2022 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace BinaryNinjaDebugger
+{
+	// Hex encoding and decoding for the RSP packets, e.g., m/M memory packets, g/G register packets, O stdout packets
+	// and vFile path names. The best kernel for the host CPU (AVX2, SSE2, NEON) is picked on first use, and the
+	// scalar code handles the tail and the hosts without SIMD support.
+	class HexCodec
+	{
+	public:
+		enum Kernel
+		{
+			ScalarKernel,
+			SSE2Kernel,
+			AVX2Kernel,
+			NEONKernel
+		};
+
+		// Decode 2 * size hex characters from src into size bytes at dst. Both upper and lower case digits are
+		// accepted. Returns false if any of the characters is not a hex digit, in which case dst is left partially
+		// written.
+		static bool Decode(const char* src, std::size_t size, std::uint8_t* dst);
+		// Encode size bytes from src into 2 * size lower case hex characters at dst
+		static void Encode(const std::uint8_t* src, std::size_t size, char* dst);
+
+		static std::string Encode(const std::uint8_t* src, std::size_t size);
+		static std::string Encode(const std::string& src);
+
+		static Kernel GetKernel();
+		static const char* GetKernelName(Kernel kernel);
+
+		// Run a specific kernel rather than the selected one, e.g., to compare them. Both return false if the host
+		// CPU does not support the kernel.
+		static bool IsKernelSupported(Kernel kernel);
+		static bool Decode(Kernel kernel, const char* src, std::size_t size, std::uint8_t* dst);
+		static bool Encode(Kernel kernel, const std::uint8_t* src, std::size_t size, char* dst);
+	};
+};
@@ -15,8 +15,10 @@ limitations under the License.
 */
 
 #include <inttypes.h>
+#include <algorithm>
 #include "lldbadapter.h"
 #include "queuedadapter.h"
+#include "meteredadapter.h"
 #include "thread"
 
 using namespace lldb;
@@ -69,7 +71,7 @@ DebugAdapter* LldbAdapterType::Create(BinaryNinja::BinaryView *data)
 #endif
 
 	// TODO: someone should free this.
-	return new LldbAdapter(data);
+	return new MeteredAdapter(new LldbAdapter(data));
 }
 
 
@@ -344,6 +346,14 @@ DebugBreakpoint LldbAdapter::AddBreakpoint(const std::uintptr_t address, unsigne
 	if (!bp.IsValid())
 		return DebugBreakpoint{};
 
+	bool hasCondition;
+	{
+		std::unique_lock<std::mutex> lock(m_conditionMutex);
+		hasCondition = m_breakpointConditions.find(address) != m_breakpointConditions.end();
+	}
+	if (hasCondition)
+		bp.SetCallback(BreakpointHitCallback, this);
+
 	return DebugBreakpoint(address, bp.GetID(), bp.IsEnabled());
 }
 
@@ -394,6 +404,173 @@ std::vector<DebugBreakpoint> LldbAdapter::GetBreakpointList() const
 }
 
 
+SBBreakpoint LldbAdapter::FindBreakpoint(std::uintptr_t address)
+{
+	for (size_t i = 0; i < m_target.GetNumBreakpoints(); i++)
+	{
+		auto bp = m_target.GetBreakpointAtIndex(i);
+		for (size_t j = 0; j < bp.GetNumLocations(); j++)
+		{
+			if (bp.GetLocationAtIndex(j).GetAddress().GetLoadAddress(m_target) == address)
+				return bp;
+		}
+	}
+	return SBBreakpoint();
+}
+
+
+// LLDB's own conditions are C expressions, which cannot express $hits, and go through the expression evaluator at
+// every hit. The conditions are compiled with the GDB adapter's compiler instead, and the callback evaluates them.
+bool LldbAdapter::SetBreakpointCondition(std::uintptr_t address, const std::string& condition)
+{
+	std::unique_lock<std::mutex> lock(m_conditionMutex);
+	if (condition.empty())
+	{
+		// The callback stays installed, and stops at every hit once there is no condition
+		m_breakpointConditions.erase(address);
+		return true;
+	}
+
+	SBFrame frame = m_process.GetSelectedThread().GetFrameAtIndex(0);
+	BreakpointCondition entry;
+	entry.m_hitCountVariable = m_nextConditionVariable++;
+	try
+	{
+		entry.m_expression = AgentExpression::Compile(condition,
+			[this, &frame](const std::string& name, std::uint32_t& regNum) {
+				if (!frame.FindRegister(name.c_str()).IsValid())
+					return false;
+				auto iter = std::find(m_conditionRegisters.begin(), m_conditionRegisters.end(), name);
+				if (iter == m_conditionRegisters.end())
+					iter = m_conditionRegisters.insert(m_conditionRegisters.end(), name);
+				regNum = (std::uint32_t)(iter - m_conditionRegisters.begin());
+				return true;
+			}, entry.m_hitCountVariable);
+	}
+	catch (const std::runtime_error& e)
+	{
+		LogError("invalid breakpoint condition \"%s\": %s", condition.c_str(), e.what());
+		return false;
+	}
+
+	m_conditionVariables.erase(entry.m_hitCountVariable);
+	m_breakpointConditions[address] = std::move(entry);
+	lock.unlock();
+
+	SBBreakpoint bp = FindBreakpoint(address);
+	if (bp.IsValid())
+		bp.SetCallback(BreakpointHitCallback, this);
+	return true;
+}
+
+
+// Runs on LLDB's thread while the target is running. Returns whether the process stops.
+bool LldbAdapter::BreakpointHitCallback(void* baton, SBProcess& process, SBThread& thread,
+	SBBreakpointLocation& location)
+{
+	auto adapter = static_cast<LldbAdapter*>(baton);
+	const auto address = location.GetLoadAddress();
+	std::unique_lock<std::mutex> lock(adapter->m_conditionMutex);
+	auto condition = adapter->m_breakpointConditions.find(address);
+	if (condition == adapter->m_breakpointConditions.end())
+		return true;
+
+	SBFrame frame = thread.GetFrameAtIndex(0);
+	AgentExpression::Context context;
+	context.readRegister = [adapter, &frame](std::uint32_t regNum, std::uint64_t& value) {
+		if (regNum >= adapter->m_conditionRegisters.size())
+			return false;
+		SBValue reg = frame.FindRegister(adapter->m_conditionRegisters[regNum].c_str());
+		if (!reg.IsValid())
+			return false;
+		SBError error;
+		value = reg.GetValueAsUnsigned(error, 0);
+		return error.Success();
+	};
+	context.readMemory = [&process](std::uint64_t address, std::size_t size, std::uint64_t& value) {
+		uint8_t buffer[8];
+		SBError error;
+		if ((size > sizeof(buffer)) || (process.ReadMemory(address, buffer, size, error) != size) || error.Fail())
+			return false;
+		value = 0;
+		for (size_t i = size; i > 0; i--)
+			value = (value << 8) | buffer[i - 1];
+		return true;
+	};
+	context.variables = &adapter->m_conditionVariables;
+
+	// A condition that cannot be evaluated stops the process, like it does in the GDB adapter
+	std::uint64_t result{};
+	if (!condition->second.m_expression.Evaluate(context, result))
+	{
+		LogWarn("failed to evaluate the condition of the breakpoint at 0x%" PRIx64, (uint64_t)address);
+		return true;
+	}
+	return result != 0;
+}
+
+
+bool LldbAdapter::AddWatchpoint(std::uintptr_t address, std::size_t size, DebugWatchpointType type)
+{
+	bool read = (type == WatchpointRead) || (type == WatchpointAccess);
+	bool write = (type == WatchpointWrite) || (type == WatchpointAccess);
+	if (m_watchpoints.find(address) != m_watchpoints.end())
+		return false;
+
+	SBError error;
+	SBWatchpoint watchpoint = m_target.WatchAddress(address, size, read, write, error);
+	if (!watchpoint.IsValid() || error.Fail())
+	{
+		LogWarn("failed to set a watchpoint at 0x%" PRIx64 ": %s", (uint64_t)address,
+			error.GetCString() ? error.GetCString() : "");
+		return false;
+	}
+	m_watchpoints[address] = DebugWatchpoint(address, size, type, watchpoint.GetID());
+	return true;
+}
+
+
+bool LldbAdapter::RemoveWatchpoint(std::uintptr_t address)
+{
+	auto iter = m_watchpoints.find(address);
+	if (iter == m_watchpoints.end())
+		return false;
+
+	if (!m_target.DeleteWatchpoint(iter->second.m_id))
+		return false;
+
+	m_watchpoints.erase(iter);
+	return true;
+}
+
+
+std::vector<DebugWatchpoint> LldbAdapter::GetWatchpointList() const
+{
+	std::vector<DebugWatchpoint> result;
+	for (const auto& [address, watchpoint]: m_watchpoints)
+		result.push_back(watchpoint);
+	return result;
+}
+
+
+std::uintptr_t LldbAdapter::GetStopDataAddress()
+{
+	// The first stop reason data of a watchpoint stop is the id of the watchpoint
+	size_t numThreads = m_process.GetNumThreads();
+	for (size_t i = 0; i < numThreads; i++)
+	{
+		SBThread thread = m_process.GetThreadAtIndex(i);
+		if ((thread.GetStopReason() != lldb::eStopReasonWatchpoint) || (thread.GetStopReasonDataCount() == 0))
+			continue;
+
+		auto watchpoint = m_target.FindWatchpointByID(thread.GetStopReasonDataAtIndex(0));
+		if (watchpoint.IsValid())
+			return watchpoint.GetWatchAddress();
+	}
+	return 0;
+}
+
+
 std::unordered_map<std::string, DebugRegister> LldbAdapter::ReadAllRegisters()
 {
 	std::unordered_map<std::string, DebugRegister> result;
@@ -724,6 +901,10 @@ DebugStopReason LldbAdapter::StopReason()
 			{
 				reason = DebugStopReason::Breakpoint;
 			}
+			else if (threadReason == lldb::eStopReasonWatchpoint)
+			{
+				reason = DebugStopReason::Watchpoint;
+			}
 			else if (threadReason == lldb::eStopReasonSignal)
 			{
 				size_t dataCount = thread.GetStopReasonDataCount();
@@ -830,6 +1011,54 @@ DebugStopReason LldbAdapter::StepOver()
 }
 
 
+DebugStopReason LldbAdapter::StepRange(std::uintptr_t start, std::uintptr_t end)
+{
+#ifndef WIN32
+	SBThread thread = m_process.GetSelectedThread();
+	if (!thread.IsValid())
+		return DebugStopReason::InternalError;
+
+	// LLDB has no public API to step through an arbitrary range, so it is done here. In the synchronous mode, the
+	// steps wait for the stop themselves, and the event listener does not see the stops in the range, nor the exit
+	// of the process, which is therefore posted here.
+	m_debugger.SetAsync(false);
+	DebugStopReason reason = DebugStopReason::SingleStep;
+	while (true)
+	{
+		SBError error;
+		thread.StepInstruction(false, error);
+		if (!error.Success())
+		{
+			reason = DebugStopReason::InternalError;
+			break;
+		}
+
+		if (m_process.GetState() == lldb::eStateExited)
+		{
+			DebuggerEvent dbgevt;
+			dbgevt.type = TargetExitedEventType;
+			dbgevt.data.exitData.exitCode = ExitCode();
+			PostDebuggerEvent(dbgevt);
+			reason = DebugStopReason::ProcessExited;
+			break;
+		}
+
+		reason = StopReason();
+		if (reason != DebugStopReason::SingleStep)
+			break;
+
+		uint64_t ip = GetInstructionOffset();
+		if ((ip < start) || (ip >= end))
+			break;
+	}
+	m_debugger.SetAsync(true);
+	return reason;
+#else
+	return DebugStopReason::OperationNotSupported;
+#endif
+}
+
+
 DebugStopReason LldbAdapter::StepReturn()
 {
 //	The following method, calling StepOutOfFrame(), will receive an unexpected lldb::eStateRunning event when the
@@ -914,7 +1143,11 @@ uint64_t LldbAdapter::GetStackPointer()
 
 bool LldbAdapter::SupportFeature(DebugAdapterCapacity feature)
 {
+#ifndef WIN32
+	return feature == DebugAdapterSupportRangeStepping;
+#else
 	return false;
+#endif
 }
 
 
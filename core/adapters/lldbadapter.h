@@ -16,6 +16,8 @@ limitations under the License.
 
 #include "../debugadapter.h"
 #include "../debugadaptertype.h"
+#include "agentexpression.h"
+#include <mutex>
 #ifdef WIN32
 #pragma warning(push)
 #pragma warning(disable: 4251)
@@ -33,6 +35,27 @@ namespace BinaryNinjaDebugger {
 		lldb::SBTarget m_target;
 		lldb::SBProcess m_process;
 
+		// The types of the watchpoints are kept here, since older SBWatchpoint cannot tell them
+		std::unordered_map<std::uintptr_t, DebugWatchpoint> m_watchpoints;
+
+		// The breakpoint conditions use the language of the GDB adapter, and are evaluated in a breakpoint callback.
+		// The registers are numbered by their position in m_conditionRegisters. The callback runs on LLDB's event
+		// thread, so these are guarded by m_conditionMutex.
+		struct BreakpointCondition
+		{
+			AgentExpression m_expression;
+			std::uint16_t m_hitCountVariable{};
+		};
+		std::unordered_map<std::uintptr_t, BreakpointCondition> m_breakpointConditions;
+		std::unordered_map<std::uint16_t, std::uint64_t> m_conditionVariables;
+		std::uint16_t m_nextConditionVariable{1};
+		std::vector<std::string> m_conditionRegisters;
+		std::mutex m_conditionMutex;
+
+		lldb::SBBreakpoint FindBreakpoint(std::uintptr_t address);
+		static bool BreakpointHitCallback(void* baton, lldb::SBProcess& process, lldb::SBThread& thread,
+			lldb::SBBreakpointLocation& location);
+
 	public:
 
 		LldbAdapter(BinaryView* data);
@@ -74,6 +97,16 @@ namespace BinaryNinjaDebugger {
 
 		std::vector<DebugBreakpoint> GetBreakpointList() const override;
 
+		bool SetBreakpointCondition(std::uintptr_t address, const std::string& condition) override;
+
+		bool AddWatchpoint(std::uintptr_t address, std::size_t size, DebugWatchpointType type) override;
+
+		bool RemoveWatchpoint(std::uintptr_t address) override;
+
+		std::vector<DebugWatchpoint> GetWatchpointList() const override;
+
+		std::uintptr_t GetStopDataAddress() override;
+
 		std::unordered_map<std::string, DebugRegister> ReadAllRegisters() override;
 
 		DebugRegister ReadRegister(const std::string &reg) override;
@@ -102,6 +135,8 @@ namespace BinaryNinjaDebugger {
 
 		DebugStopReason StepReturn() override;
 
+		DebugStopReason StepRange(std::uintptr_t start, std::uintptr_t end) override;
+
 		std::string InvokeBackendCommand(const std::string &command) override;
 
 		uintptr_t GetInstructionOffset() override;
@@ -16,6 +16,7 @@ limitations under the License.
 
 #include <thread>
 #include <regex>
+#include <charconv>
 #ifndef WIN32
 #include <spawn.h>
 #endif
@@ -29,87 +30,200 @@ limitations under the License.
 using namespace BinaryNinjaDebugger;
 
 
+namespace
+{
+	// A small reader for the JSON replies of debugserver and lldb-server, e.g., jThreadsInfo. It does not build a tree;
+	// the caller reads the values it needs and skips the rest.
+	class JsonReader
+	{
+		std::string_view m_text;
+		std::size_t m_offset{};
+
+		void SkipWhitespace()
+		{
+			while ((m_offset < m_text.size()) && std::isspace(static_cast<unsigned char>(m_text[m_offset])))
+				m_offset++;
+		}
+
+	public:
+		JsonReader(std::string_view text): m_text(text) {}
+
+		bool Consume(char c)
+		{
+			SkipWhitespace();
+			if ((m_offset >= m_text.size()) || (m_text[m_offset] != c))
+				return false;
+			m_offset++;
+			return true;
+		}
+
+		bool ReadString(std::string& value)
+		{
+			if (!Consume('"'))
+				return false;
+
+			value.clear();
+			while (m_offset < m_text.size())
+			{
+				const char c = m_text[m_offset++];
+				if (c == '"')
+					return true;
+				if (c != '\\')
+				{
+					value.push_back(c);
+					continue;
+				}
+
+				if (m_offset >= m_text.size())
+					return false;
+				const char escaped = m_text[m_offset++];
+				switch (escaped)
+				{
+				case 'n': value.push_back('\n'); break;
+				case 'r': value.push_back('\r'); break;
+				case 't': value.push_back('\t'); break;
+				case 'b': value.push_back('\b'); break;
+				case 'f': value.push_back('\f'); break;
+				case 'u':
+				{
+					// Only the ASCII code points are kept, which covers the names and paths in these replies
+					std::uint64_t code_point{};
+					if ((m_offset + 4 > m_text.size()) || !RspTokenizer::ParseHex(m_text.substr(m_offset, 4), code_point))
+						return false;
+					m_offset += 4;
+					value.push_back(code_point < 0x80 ? static_cast<char>(code_point) : '?');
+					break;
+				}
+				default: value.push_back(escaped); break;
+				}
+			}
+			return false;
+		}
+
+		bool ReadNumber(std::uint64_t& value)
+		{
+			SkipWhitespace();
+			const auto result = std::from_chars(m_text.data() + m_offset, m_text.data() + m_text.size(), value);
+			if (result.ec != std::errc())
+				return false;
+			m_offset = result.ptr - m_text.data();
+			return true;
+		}
+
+		bool SkipValue()
+		{
+			SkipWhitespace();
+			if (m_offset >= m_text.size())
+				return false;
+
+			const char c = m_text[m_offset];
+			if (c == '"')
+			{
+				std::string value;
+				return ReadString(value);
+			}
+			if (c == '{')
+				return ReadObject([this](const std::string&) { return SkipValue(); });
+			if (c == '[')
+				return ReadArray([this]() { return SkipValue(); });
+
+			// Numbers, true, false and null
+			const auto end = m_text.find_first_of(",}] \t\r\n", m_offset);
+			m_offset = (end == std::string_view::npos) ? m_text.size() : end;
+			return true;
+		}
+
+		// Calls handler(key) for every member of an object. The handler must read or skip the value.
+		template <typename Handler>
+		bool ReadObject(Handler handler)
+		{
+			if (!Consume('{'))
+				return false;
+			if (Consume('}'))
+				return true;
+
+			do
+			{
+				std::string key;
+				if (!ReadString(key) || !Consume(':') || !handler(key))
+					return false;
+			} while (Consume(','));
+			return Consume('}');
+		}
+
+		// Calls handler() for every element of an array. The handler must read or skip the element.
+		template <typename Handler>
+		bool ReadArray(Handler handler)
+		{
+			if (!Consume('['))
+				return false;
+			if (Consume(']'))
+				return true;
+
+			do
+			{
+				if (!handler())
+					return false;
+			} while (Consume(','));
+			return Consume(']');
+		}
+	};
+}
+
+
 LldbRspAdapter::LldbRspAdapter(BinaryView *data): GdbAdapter(data)
 {
 	m_remoteArch = m_data->GetDefaultArchitecture()->GetName();
 }
 
 bool LldbRspAdapter::LoadRegisterInfo() {
-    const auto xml = this->m_rspConnector.GetXml("target.xml");
+    const auto& xml = this->GetTargetDescription();
 
     pugi::xml_document doc{};
     const auto parse_result = doc.load_string(xml.c_str());
     if (!parse_result)
         return false;
 
-    for (auto node = doc.first_child().child("feature"); node; node = node.next_sibling())
-    {
-        using namespace std::literals::string_literals;
-
-        for (auto reg_child = node.child("reg"); reg_child; reg_child = reg_child.next_sibling())
-        {
-            std::string register_name{};
-            RegisterInfo register_info{};
-
-            for (auto reg_attribute = reg_child.attribute("name"); reg_attribute; reg_attribute = reg_attribute.next_attribute())
-            {
-                if (reg_attribute.name() == "name"s )
-                    register_name = reg_attribute.value();
-                else if (reg_attribute.name() == "bitsize"s )
-                    register_info.m_bitSize = reg_attribute.as_uint();
-                else if (reg_attribute.name() == "regnum"s)
-                    register_info.m_regNum = reg_attribute.as_uint();
-            }
-
-            this->m_registerInfo[register_name] = register_info;
-        }
-    }
-
-    std::unordered_map<std::uint32_t, std::string> id_name{};
-    std::unordered_map<std::uint32_t, std::uint32_t> id_width{};
-
-    for ( auto [key, value] : this->m_registerInfo ) {
-        id_name[value.m_regNum] = key;
-        id_width[value.m_regNum] = value.m_bitSize;
-    }
-
-    std::size_t max_id{};
-    for ( auto [key, value] : this->m_registerInfo )
-        max_id += value.m_regNum;
-
-    std::size_t offset{};
-    for ( std::size_t index{}; index < max_id; index++ ) {
-        if ( !id_width[index] )
-            break;
-
-        const auto name = id_name[index];
-        this->m_registerInfo[name].m_offset = offset;
-        offset += id_width[index];
-    }
+    std::vector<RegisterInfo> registers{};
+    for (auto node = doc.first_child().child("feature"); node; node = node.next_sibling("feature"))
+        ParseRegisterFeature(node, registers);
 
+    this->BuildRegisterLayout(std::move(registers));
     return true;
 }
 
 
 std::unordered_map<std::string, DebugRegister> LldbRspAdapter::ReadAllRegisters()
 {
-    if ( this->m_registerInfo.empty() )
+    if ( this->m_registerLayout.empty() )
         throw std::runtime_error("register info empty");
 
-    std::vector<register_pair> register_info_vec{};
-    for ( const auto& [register_name, register_info] : this->m_registerInfo )
-        register_info_vec.emplace_back(register_name, register_info);
+    if ( this->m_nonStop && this->IsActiveThreadRunning() )
+        return {};
+
+    // Read the registers that are not in the snapshot with pipelined p packets
+    if ( !this->m_registerSnapshotComplete ) {
+        RspPipeline pipeline(this->m_rspConnector);
+        std::vector<std::pair<std::size_t, std::future<RspData>>> replies{};
+        for ( std::size_t index{}; index < this->m_registerLayout.size(); index++ ) {
+            if ( !this->m_registerValid[index] )
+                replies.emplace_back(index, pipeline.Queue(
+                        RspData(fmt::format("p{:02x}", this->m_registerLayout[index].m_regNum))));
+        }
 
-    std::sort(register_info_vec.begin(), register_info_vec.end(),
-              [](const register_pair& lhs, const register_pair& rhs) {
-                  return lhs.second.m_regNum < rhs.second.m_regNum;
-              });
+        for ( auto& [index, future] : replies ) {
+            const auto reply = future.get();
+            this->StoreRegisterBytes(this->m_registerLayout[index], static_cast<const char*>(reply.m_data.GetData()),
+                                     reply.m_data.GetLength());
+        }
+        this->m_registerSnapshotComplete = true;
+    }
 
     std::unordered_map<std::string, DebugRegister> all_regs{};
-    for ( const auto& [register_name, register_info] : register_info_vec )
-    {
-        DebugRegister value = ReadRegister(register_name);
-        all_regs[register_name] = value;
+    all_regs.reserve(this->m_registerLayout.size());
+    for ( std::size_t index{}; index < this->m_registerLayout.size(); index++ ) {
+        if ( this->m_registerValid[index] )
+            all_regs[this->m_registerLayout[index].m_name] = this->SnapshotRegister(this->m_registerLayout[index]);
     }
 
     return all_regs;
@@ -120,22 +234,95 @@ DebugRegister LldbRspAdapter::ReadRegister(const std::string& reg)
 {
 //    if (!m_isTargetRunning)
 //        return DebugRegister{};
+    if ( this->m_nonStop && this->IsActiveThreadRunning() )
+        return DebugRegister{};
 
-    auto iter = m_registerInfo.find(reg);
-    if (iter == m_registerInfo.end())
+    const auto register_info = this->FindRegister(reg);
+    if ( !register_info )
         throw std::runtime_error(fmt::format("register {} does not exist in target", reg));
 
-    const auto reply = this->m_rspConnector.TransmitAndReceive(RspData(
-            fmt::format("p{:02x}", iter->second.m_regNum)));
+    const auto index = register_info - this->m_registerLayout.data();
+    if ( !this->m_registerValid[index] ) {
+        const auto reply = this->m_rspConnector.TransmitAndReceive(RspData(
+                fmt::format("p{:02x}", register_info->m_regNum)));
+        if ( !this->StoreRegisterBytes(*register_info, static_cast<const char*>(reply.m_data.GetData()),
+                                       reply.m_data.GetLength()) )
+            return DebugRegister{};
+    }
 
-    // TODO: handle exceptions in parsing
-    uint64_t value = RspConnector::SwapEndianness(strtoull(reply.AsString().c_str(), nullptr, 16));
-    DebugRegister result;
-    result.m_name = iter->first;
-    result.m_value = value;
-    result.m_registerIndex = iter->second.m_regNum;
-    result.m_width = iter->second.m_bitSize;
-    return result;
+    return this->SnapshotRegister(*register_info);
+}
+
+
+bool LldbRspAdapter::ReadThreadsInfo(std::vector<DebugThread>& threads)
+{
+    const auto ip_register = this->FindRegister(this->GetInstructionPointerRegisterName());
+    if ( !ip_register )
+        return false;
+
+    // [{"tid":4711,"name":"a.out","reason":"none","registers":{"16":"f03f000001000000",...}},...]
+    // The reply is binary encoded, since the JSON can contain the special characters, e.g., '}'.
+    const auto reply = this->m_rspConnector.TransmitAndReceive(RspData("jThreadsInfo"));
+    if ( (reply.m_data.GetLength() == 0) || (reply[0] != '[') )
+        return false;
+    const auto json = RspConnector::BinaryDecode(reply).AsString();
+
+    JsonReader reader(json);
+    bool all_resolved = true;
+    const bool parsed = reader.ReadArray([&]() {
+        DebugThread thread{};
+        bool has_tid = false, has_rip = false;
+        const bool ok = reader.ReadObject([&](const std::string& key) {
+            if ( key == "tid" ) {
+                std::uint64_t tid{};
+                has_tid = reader.ReadNumber(tid);
+                thread.m_tid = static_cast<std::uint32_t>(tid);
+                return has_tid;
+            }
+            if ( key != "registers" )
+                return reader.SkipValue();
+
+            // The keys are the register numbers in decimal, and the values are in the target byte order
+            return reader.ReadObject([&](const std::string& register_number) {
+                std::string value;
+                if ( !reader.ReadString(value) )
+                    return false;
+                if ( register_number == std::to_string(ip_register->m_regNum) )
+                    has_rip = DecodeRegisterValue(value, ip_register->m_bitSize, thread.m_rip);
+                return true;
+            });
+        });
+
+        if ( ok && has_tid ) {
+            threads.push_back(thread);
+            all_resolved = all_resolved && has_rip;
+        }
+        return ok && has_tid;
+    });
+
+    if ( !parsed ) {
+        threads.clear();
+        return false;
+    }
+
+    // Older servers do not expedite the registers
+    if ( !all_resolved )
+        this->ReadThreadInstructionOffsets(threads);
+    return true;
+}
+
+
+std::vector<DebugThread> LldbRspAdapter::GetThreadList()
+{
+    if (m_isTargetRunning)
+        return {};
+
+    // jThreadsInfo has all threads with their expedited registers, so this takes a single round trip
+    std::vector<DebugThread> threads{};
+    if ( this->ReadThreadsInfo(threads) )
+        return threads;
+
+    return GdbAdapter::GetThreadList();
 }
 
 
@@ -183,9 +370,12 @@ bool LldbRspAdapter::ExecuteWithArgs(const std::string &path, const std::string
 
     lldb_server_path = lldb_server_path.substr(0, lldb_server_path.find('\n'));
 
-    this->m_socket = new Socket(AF_INET, SOCK_STREAM, 0);
+    // debugserver only listens on TCP
+    const auto port = TcpTransport::FindFreePort();
+    if (port == 0)
+        return false;
 
-    const auto host_with_port = fmt::format("127.0.0.1:{}", this->m_socket->GetPort());
+    const auto host_with_port = fmt::format("127.0.0.1:{}", port);
 
     char* arg[] = {(char*)lldb_server_path.c_str(),
 				   "--stdio-path", "/dev/stdin",
@@ -218,7 +408,7 @@ bool LldbRspAdapter::ExecuteWithArgs(const std::string &path, const std::string
 		system(fullCmd.c_str());
 	}
 
-    return this->Connect("127.0.0.1", this->m_socket->GetPort());
+    return this->Connect("127.0.0.1", port);
 #endif
 }
 
@@ -232,9 +422,11 @@ bool LldbRspAdapter::Attach(std::uint32_t pid)
     if ( lldb_server_path.empty() )
         return false;
 
-    this->m_socket = new Socket(AF_INET, SOCK_STREAM, 0);
+    const auto port = TcpTransport::FindFreePort();
+    if (port == 0)
+        return false;
 
-    const auto host_with_port = fmt::format("127.0.0.1:{}", this->m_socket->GetPort());
+    const auto host_with_port = fmt::format("127.0.0.1:{}", port);
 
     char* arg[] = {(char*)lldb_server_path.c_str(),
 				   "--stdio-path", "/dev/stdin",
@@ -250,7 +442,7 @@ bool LldbRspAdapter::Attach(std::uint32_t pid)
 		return false;
 	}
 
-    return this->Connect("127.0.0.1", this->m_socket->GetPort());
+    return this->Connect("127.0.0.1", port);
 #endif
 }
 
@@ -302,48 +494,7 @@ std::vector<DebugModule> LldbRspAdapter::GetModuleList()
 }
 
 
-DataBuffer LldbRspAdapter::ReadMemory(std::uintptr_t address, std::size_t size)
-{
-    // This means whether the target is running. If it is, then we cannot read memory at the moment
-    if (m_isTargetRunning)
-        return DataBuffer{};
-
-    auto reply = this->m_rspConnector.TransmitAndReceive(RspData("x{:x},{:x}", address, size));
-	// debugserver replies E80 when failing to read the memory. The error number might change
-	// The check here does not remove all ambiguity, but it should probably work in most cases
-    if ((reply.m_data[0] == 'E') && (reply.AsString().size() == 3)
-		&& std::isdigit(reply.m_data[1]) && std::isdigit(reply.m_data[2]))
-	{
-		return DataBuffer{};
-	}
-
-	std::string replyString = reply.AsString();
-	std::vector<uint8_t> bufferUnquoted;
-	bufferUnquoted.reserve(size);
-	size_t i = 0;
-	while (i < replyString.size())
-	{
-		if (replyString[i] == '}')
-		{
-			bufferUnquoted.push_back(replyString[i + 1] ^ 0x20);
-			i += 2;
-		}
-		else
-		{
-			bufferUnquoted.push_back(replyString[i]);
-			i++;
-		}
-	}
-
-	std::ostringstream s;
-	for (i = 0; i < bufferUnquoted.size(); i++)
-		s << bufferUnquoted[i];
-
-	return DataBuffer(s.str().c_str(), s.str().size());
-}
-
-
-DebugStopReason LldbRspAdapter::SignalToStopReason(std::unordered_map<std::string, std::uint64_t>& dict)
+DebugStopReason LldbRspAdapter::SignalToStopReason(const RspStopReply& stopReply)
 {
 //	metype:6;mecount:2;medata:1;medata:0;memory:0x16f5ba940=d0ad5b6f0100000068a8b60001801c5e;
 //	memory:0x16f5badd0=90b65b6f01000000f416b600018006f6;#00
@@ -430,19 +581,19 @@ Target 0: (commandline_test) stopped.
 		{10, DebugStopReason::ExcCrash}
 	};
 
-	if (dict.find("metype") != dict.end())
+	// lldb-server reports the watchpoints with the gdb fields, in addition to its "reason:watchpoint"
+	if (RecordWatchpointStop(stopReply))
+		return DebugStopReason::Watchpoint;
+
+	uint64_t metype{};
+	if (stopReply.FindHexField("metype", metype))
 	{
-		uint64_t metype = dict["metype"];
 		if (metype_lookup.find(metype) != metype_lookup.end())
 			return metype_lookup[metype];
 	}
 
-	if (dict.find("signal") != dict.end())
-	{
-		uint64_t signal = dict["signal"];
-		if (signal_lookup.find(signal) != signal_lookup.end())
-			return signal_lookup[signal];
-	}
+	if (signal_lookup.find(stopReply.m_signal) != signal_lookup.end())
+		return signal_lookup[stopReply.m_signal];
 
 	return DebugStopReason::UnknownReason;
 }
@@ -22,9 +22,10 @@ namespace BinaryNinjaDebugger
 	class LldbRspAdapter : public GdbAdapter
 	{
 		bool LoadRegisterInfo() override;
-		DebugStopReason SignalToStopReason(std::unordered_map<std::string, std::uint64_t>& dict) override;
+		DebugStopReason SignalToStopReason(const RspStopReply& stopReply) override;
 
 		std::string GetDebugServerPath();
+		bool ReadThreadsInfo(std::vector<DebugThread>& threads);
 
 	public:
 		LldbRspAdapter(BinaryView* data);
@@ -34,12 +35,11 @@ namespace BinaryNinjaDebugger
 		DebugStopReason Go() override;
 		std::string GetTargetArchitecture() override;
 		std::vector<DebugModule> GetModuleList() override;
+		std::vector<DebugThread> GetThreadList() override;
 
 		// LLDB requires a different way of reading register values, the g packet that works for gdb does not work for lldb
 		std::unordered_map<std::string, DebugRegister> ReadAllRegisters() override;
 		DebugRegister ReadRegister(const std::string& reg) override;
-
-		DataBuffer ReadMemory(std::uintptr_t address, std::size_t size) override;
 	};
 
 
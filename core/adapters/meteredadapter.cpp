@@ -0,0 +1,422 @@
+/*
+Copyright 2020-2022 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "meteredadapter.h"
+
+using namespace BinaryNinja;
+using namespace std;
+using namespace BinaryNinjaDebugger;
+
+
+MeteredAdapter::MeteredAdapter(DebugAdapter* adapter): DebugAdapter(nullptr), m_adapter(adapter)
+{
+}
+
+
+bool MeteredAdapter::Execute(const std::string& path, const LaunchConfigurations& configs)
+{
+    OperationTimer timer(m_operationMetrics, "Execute");
+    return m_adapter->Execute(path, configs);
+}
+
+
+bool MeteredAdapter::ExecuteWithArgs(const std::string &path, const std::string &args, const std::string &workingDir,
+    const LaunchConfigurations &configs)
+{
+    OperationTimer timer(m_operationMetrics, "ExecuteWithArgs");
+    return m_adapter->ExecuteWithArgs(path, args, workingDir, configs);
+}
+
+
+bool MeteredAdapter::Attach(std::uint32_t pid)
+{
+    OperationTimer timer(m_operationMetrics, "Attach");
+    return m_adapter->Attach(pid);
+}
+
+
+bool MeteredAdapter::Connect(const std::string& server, std::uint32_t port)
+{
+    OperationTimer timer(m_operationMetrics, "Connect");
+    return m_adapter->Connect(server, port);
+}
+
+
+bool MeteredAdapter::ConnectToDebugServer(const std::string& server, std::uint32_t port)
+{
+    OperationTimer timer(m_operationMetrics, "ConnectToDebugServer");
+    return m_adapter->ConnectToDebugServer(server, port);
+}
+
+
+bool MeteredAdapter::DisconnectDebugServer()
+{
+    OperationTimer timer(m_operationMetrics, "DisconnectDebugServer");
+    return m_adapter->DisconnectDebugServer();
+}
+
+
+void MeteredAdapter::Detach()
+{
+    OperationTimer timer(m_operationMetrics, "Detach");
+    m_adapter->Detach();
+}
+
+
+void MeteredAdapter::Quit()
+{
+    OperationTimer timer(m_operationMetrics, "Quit");
+    m_adapter->Quit();
+}
+
+
+std::vector<DebugThread> MeteredAdapter::GetThreadList()
+{
+    OperationTimer timer(m_operationMetrics, "GetThreadList");
+    return m_adapter->GetThreadList();
+}
+
+
+DebugThread MeteredAdapter::GetActiveThread() const
+{
+    OperationTimer timer(m_operationMetrics, "GetActiveThread");
+    return m_adapter->GetActiveThread();
+}
+
+
+std::uint32_t MeteredAdapter::GetActiveThreadId() const
+{
+    OperationTimer timer(m_operationMetrics, "GetActiveThreadId");
+    return m_adapter->GetActiveThreadId();
+}
+
+
+bool MeteredAdapter::SetActiveThread(const DebugThread& thread)
+{
+    OperationTimer timer(m_operationMetrics, "SetActiveThread");
+    return m_adapter->SetActiveThread(thread);
+}
+
+
+bool MeteredAdapter::SetActiveThreadId(std::uint32_t tid)
+{
+    OperationTimer timer(m_operationMetrics, "SetActiveThreadId");
+    return m_adapter->SetActiveThreadId(tid);
+}
+
+
+std::vector<DebugFrame> MeteredAdapter::GetFramesOfThread(uint32_t tid)
+{
+    OperationTimer timer(m_operationMetrics, "GetFramesOfThread");
+    return m_adapter->GetFramesOfThread(tid);
+}
+
+
+DebugBreakpoint MeteredAdapter::AddBreakpoint(std::uintptr_t address, unsigned long breakpoint_type)
+{
+    OperationTimer timer(m_operationMetrics, "AddBreakpoint");
+    return m_adapter->AddBreakpoint(address, breakpoint_type);
+}
+
+
+DebugBreakpoint MeteredAdapter::AddBreakpoint(const ModuleNameAndOffset& address, unsigned long breakpoint_type)
+{
+    OperationTimer timer(m_operationMetrics, "AddBreakpoint");
+    return m_adapter->AddBreakpoint(address, breakpoint_type);
+}
+
+
+std::vector<DebugBreakpoint> MeteredAdapter::AddBreakpoints(const std::vector<std::uintptr_t>& addresses)
+{
+    OperationTimer timer(m_operationMetrics, "AddBreakpoints");
+    return m_adapter->AddBreakpoints(addresses);
+}
+
+
+std::vector<DebugBreakpoint> MeteredAdapter::AddBreakpoints(const std::vector<ModuleNameAndOffset>& addresses)
+{
+    OperationTimer timer(m_operationMetrics, "AddBreakpoints");
+    return m_adapter->AddBreakpoints(addresses);
+}
+
+
+bool MeteredAdapter::RemoveBreakpoint(const DebugBreakpoint& breakpoint)
+{
+    OperationTimer timer(m_operationMetrics, "RemoveBreakpoint");
+    return m_adapter->RemoveBreakpoint(breakpoint);
+}
+
+
+bool MeteredAdapter::RemoveBreakpoint(const ModuleNameAndOffset& address)
+{
+    OperationTimer timer(m_operationMetrics, "RemoveBreakpoint");
+    return m_adapter->RemoveBreakpoint(address);
+}
+
+
+bool MeteredAdapter::RemoveBreakpoints(const std::vector<DebugBreakpoint>& breakpoints)
+{
+    OperationTimer timer(m_operationMetrics, "RemoveBreakpoints");
+    return m_adapter->RemoveBreakpoints(breakpoints);
+}
+
+
+bool MeteredAdapter::SetBreakpointCondition(std::uintptr_t address, const std::string& condition)
+{
+    OperationTimer timer(m_operationMetrics, "SetBreakpointCondition");
+    return m_adapter->SetBreakpointCondition(address, condition);
+}
+
+
+std::vector<DebugBreakpoint> MeteredAdapter::GetBreakpointList() const
+{
+    OperationTimer timer(m_operationMetrics, "GetBreakpointList");
+    return m_adapter->GetBreakpointList();
+}
+
+
+bool MeteredAdapter::AddWatchpoint(std::uintptr_t address, std::size_t size, DebugWatchpointType type)
+{
+    OperationTimer timer(m_operationMetrics, "AddWatchpoint");
+    return m_adapter->AddWatchpoint(address, size, type);
+}
+
+
+bool MeteredAdapter::RemoveWatchpoint(std::uintptr_t address)
+{
+    OperationTimer timer(m_operationMetrics, "RemoveWatchpoint");
+    return m_adapter->RemoveWatchpoint(address);
+}
+
+
+std::vector<DebugWatchpoint> MeteredAdapter::GetWatchpointList() const
+{
+    OperationTimer timer(m_operationMetrics, "GetWatchpointList");
+    return m_adapter->GetWatchpointList();
+}
+
+
+std::uintptr_t MeteredAdapter::GetStopDataAddress()
+{
+    OperationTimer timer(m_operationMetrics, "GetStopDataAddress");
+    return m_adapter->GetStopDataAddress();
+}
+
+
+bool MeteredAdapter::StartTrace(const std::vector<DebugTracepoint>& tracepoints)
+{
+    OperationTimer timer(m_operationMetrics, "StartTrace");
+    return m_adapter->StartTrace(tracepoints);
+}
+
+
+bool MeteredAdapter::StopTrace()
+{
+    OperationTimer timer(m_operationMetrics, "StopTrace");
+    return m_adapter->StopTrace();
+}
+
+
+DebugTraceStatus MeteredAdapter::GetTraceStatus()
+{
+    OperationTimer timer(m_operationMetrics, "GetTraceStatus");
+    return m_adapter->GetTraceStatus();
+}
+
+
+std::vector<DebugTraceFrame> MeteredAdapter::GetTraceFrames()
+{
+    OperationTimer timer(m_operationMetrics, "GetTraceFrames");
+    return m_adapter->GetTraceFrames();
+}
+
+
+std::unordered_map<std::string, DebugRegister> MeteredAdapter::ReadAllRegisters()
+{
+    OperationTimer timer(m_operationMetrics, "ReadAllRegisters");
+    return m_adapter->ReadAllRegisters();
+}
+
+
+DebugRegister MeteredAdapter::ReadRegister(const std::string& reg)
+{
+    OperationTimer timer(m_operationMetrics, "ReadRegister");
+    return m_adapter->ReadRegister(reg);
+}
+
+
+bool MeteredAdapter::WriteRegister(const std::string& reg, std::uintptr_t value)
+{
+    OperationTimer timer(m_operationMetrics, "WriteRegister");
+    return m_adapter->WriteRegister(reg, value);
+}
+
+
+DataBuffer MeteredAdapter::ReadMemory(std::uintptr_t address, std::size_t size)
+{
+    OperationTimer timer(m_operationMetrics, "ReadMemory");
+    return m_adapter->ReadMemory(address, size);
+}
+
+
+bool MeteredAdapter::WriteMemory(std::uintptr_t address, const DataBuffer& buffer)
+{
+    OperationTimer timer(m_operationMetrics, "WriteMemory");
+    return m_adapter->WriteMemory(address, buffer);
+}
+
+
+std::vector<DebugModule> MeteredAdapter::GetModuleList()
+{
+    OperationTimer timer(m_operationMetrics, "GetModuleList");
+    return m_adapter->GetModuleList();
+}
+
+
+std::string MeteredAdapter::GetTargetArchitecture()
+{
+    OperationTimer timer(m_operationMetrics, "GetTargetArchitecture");
+    return m_adapter->GetTargetArchitecture();
+}
+
+
+DebugStopReason MeteredAdapter::StopReason()
+{
+    OperationTimer timer(m_operationMetrics, "StopReason");
+    return m_adapter->StopReason();
+}
+
+
+uint64_t MeteredAdapter::ExitCode()
+{
+    OperationTimer timer(m_operationMetrics, "ExitCode");
+    return m_adapter->ExitCode();
+}
+
+
+bool MeteredAdapter::BreakInto()
+{
+    OperationTimer timer(m_operationMetrics, "BreakInto");
+    return m_adapter->BreakInto();
+}
+
+
+bool MeteredAdapter::ResumeThread(std::uint32_t tid)
+{
+    OperationTimer timer(m_operationMetrics, "ResumeThread");
+    return m_adapter->ResumeThread(tid);
+}
+
+
+bool MeteredAdapter::StopThread(std::uint32_t tid)
+{
+    OperationTimer timer(m_operationMetrics, "StopThread");
+    return m_adapter->StopThread(tid);
+}
+
+
+DebugStopReason MeteredAdapter::Go()
+{
+    OperationTimer timer(m_operationMetrics, "Go");
+    return m_adapter->Go();
+}
+
+
+DebugStopReason MeteredAdapter::StepInto()
+{
+    OperationTimer timer(m_operationMetrics, "StepInto");
+    return m_adapter->StepInto();
+}
+
+
+DebugStopReason MeteredAdapter::StepOver()
+{
+    OperationTimer timer(m_operationMetrics, "StepOver");
+    return m_adapter->StepOver();
+}
+
+
+DebugStopReason MeteredAdapter::StepReturn()
+{
+    OperationTimer timer(m_operationMetrics, "StepReturn");
+    return m_adapter->StepReturn();
+}
+
+
+DebugStopReason MeteredAdapter::StepRange(std::uintptr_t start, std::uintptr_t end)
+{
+    OperationTimer timer(m_operationMetrics, "StepRange");
+    return m_adapter->StepRange(start, end);
+}
+
+
+std::string MeteredAdapter::InvokeBackendCommand(const std::string& command)
+{
+    OperationTimer timer(m_operationMetrics, "InvokeBackendCommand");
+    return m_adapter->InvokeBackendCommand(command);
+}
+
+
+std::uintptr_t MeteredAdapter::GetInstructionOffset()
+{
+    OperationTimer timer(m_operationMetrics, "GetInstructionOffset");
+    return m_adapter->GetInstructionOffset();
+}
+
+
+uint64_t MeteredAdapter::GetStackPointer()
+{
+    OperationTimer timer(m_operationMetrics, "GetStackPointer");
+    return m_adapter->GetStackPointer();
+}
+
+
+void MeteredAdapter::WriteStdin(const std::string& msg)
+{
+    OperationTimer timer(m_operationMetrics, "WriteStdin");
+    m_adapter->WriteStdin(msg);
+}
+
+
+bool MeteredAdapter::SupportFeature(DebugAdapterCapacity feature)
+{
+    return m_adapter->SupportFeature(feature);
+}
+
+
+void MeteredAdapter::SetEventCallback(std::function<void(const DebuggerEvent &)> function)
+{
+    m_adapter->SetEventCallback(function);
+}
+
+
+Ref<Metadata> MeteredAdapter::GetProperty(const std::string& name)
+{
+    if (name == "stats")
+    {
+        std::map<std::string, Ref<Metadata>> stats;
+        stats["operations"] = m_operationMetrics.ToMetadata();
+        return new Metadata(stats);
+    }
+
+    return m_adapter->GetProperty(name);
+}
+
+
+bool MeteredAdapter::SetProperty(const std::string& name, const Ref<Metadata>& value)
+{
+    return m_adapter->SetProperty(name, value);
+}
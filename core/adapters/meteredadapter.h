@@ -0,0 +1,113 @@
+/*
+Copyright 2020-2022 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+#pragma once
+#include "../debugadapter.h"
+#include "adaptermetrics.h"
+
+namespace BinaryNinjaDebugger
+{
+	// Times every call to an adapter that does not queue its requests, e.g., LLDB and DbgEng. The queued adapters
+	// time their calls in QueuedAdapter instead, so each call is only measured once.
+	class MeteredAdapter : public DebugAdapter
+	{
+		DebugAdapter* m_adapter;
+
+		// The calls to the adapter, by the name of the method
+		mutable OperationMetrics m_operationMetrics;
+
+	public:
+		MeteredAdapter(DebugAdapter* adapter);
+
+		bool Execute(const std::string& path, const LaunchConfigurations& configs) override;
+		bool ExecuteWithArgs(const std::string &path, const std::string &args, const std::string &workingDir,
+							 const LaunchConfigurations &configs) override;
+		bool Attach(std::uint32_t pid) override;
+		bool Connect(const std::string& server, std::uint32_t port) override;
+		bool ConnectToDebugServer(const std::string& server, std::uint32_t port) override;
+		bool DisconnectDebugServer() override;
+
+		void Detach() override;
+		void Quit() override;
+
+		std::vector<DebugThread> GetThreadList() override;
+		DebugThread GetActiveThread() const override;
+		std::uint32_t GetActiveThreadId() const override;
+		bool SetActiveThread(const DebugThread& thread) override;
+		bool SetActiveThreadId(std::uint32_t tid) override;
+		std::vector<DebugFrame> GetFramesOfThread(uint32_t tid) override;
+
+		DebugBreakpoint AddBreakpoint(std::uintptr_t address, unsigned long breakpoint_type = 0) override;
+		DebugBreakpoint AddBreakpoint(const ModuleNameAndOffset& address, unsigned long breakpoint_type = 0) override;
+		std::vector<DebugBreakpoint> AddBreakpoints(const std::vector<std::uintptr_t>& addresses) override;
+		std::vector<DebugBreakpoint> AddBreakpoints(const std::vector<ModuleNameAndOffset>& addresses) override;
+
+		bool RemoveBreakpoint(const DebugBreakpoint& breakpoint) override;
+		bool RemoveBreakpoint(const ModuleNameAndOffset& address) override;
+		bool RemoveBreakpoints(const std::vector<DebugBreakpoint>& breakpoints) override;
+		bool SetBreakpointCondition(std::uintptr_t address, const std::string& condition) override;
+
+		std::vector<DebugBreakpoint> GetBreakpointList() const override;
+
+		bool AddWatchpoint(std::uintptr_t address, std::size_t size, DebugWatchpointType type) override;
+		bool RemoveWatchpoint(std::uintptr_t address) override;
+		std::vector<DebugWatchpoint> GetWatchpointList() const override;
+		std::uintptr_t GetStopDataAddress() override;
+
+		bool StartTrace(const std::vector<DebugTracepoint>& tracepoints) override;
+		bool StopTrace() override;
+		DebugTraceStatus GetTraceStatus() override;
+		std::vector<DebugTraceFrame> GetTraceFrames() override;
+
+		std::unordered_map<std::string, DebugRegister> ReadAllRegisters() override;
+		DebugRegister ReadRegister(const std::string& reg) override;
+		bool WriteRegister(const std::string& reg, std::uintptr_t value) override;
+
+		DataBuffer ReadMemory(std::uintptr_t address, std::size_t size) override;
+		bool WriteMemory(std::uintptr_t address, const DataBuffer& buffer) override;
+
+		std::vector<DebugModule> GetModuleList() override;
+
+		std::string GetTargetArchitecture() override;
+
+		DebugStopReason StopReason() override;
+
+		uint64_t ExitCode() override;
+
+		bool BreakInto() override;
+		bool ResumeThread(std::uint32_t tid) override;
+		bool StopThread(std::uint32_t tid) override;
+		DebugStopReason Go() override;
+		DebugStopReason StepInto() override;
+		DebugStopReason StepOver() override;
+		DebugStopReason StepReturn() override;
+		DebugStopReason StepRange(std::uintptr_t start, std::uintptr_t end) override;
+
+		std::string InvokeBackendCommand(const std::string& command) override;
+		std::uintptr_t GetInstructionOffset() override;
+		uint64_t GetStackPointer() override;
+
+		bool SupportFeature(DebugAdapterCapacity feature) override;
+
+		void SetEventCallback(std::function<void(const DebuggerEvent &)> function) override;
+
+		void WriteStdin(const std::string& msg) override;
+
+		Ref<Metadata> GetProperty(const std::string& name) override;
+		bool SetProperty(const std::string& name, const Ref<Metadata>& value) override;
+	};
+};
@@ -49,407 +49,390 @@ using namespace BinaryNinjaDebugger;
 
 QueuedAdapter::QueuedAdapter(DebugAdapter* adapter): DebugAdapter(nullptr), m_adapter(adapter)
 {
-    std::thread worker([&](){
+    m_worker = std::thread([this](){
         Worker();
     });
-    worker.detach();
 }
 
 
 QueuedAdapter::~QueuedAdapter()
 {
+    {
+        std::unique_lock<std::mutex> lock(m_queueMutex);
+        m_stopWorker = true;
+    }
+    m_queueCondition.notify_one();
+    if (m_worker.joinable())
+        m_worker.join();
+}
 
+
+void QueuedAdapter::Push(RequestPriority priority, std::function<void()> run, std::function<void()> drop,
+    bool resumesTarget) const
+{
+    if (priority == RequestPriority::Control)
+    {
+        m_pendingMemoryReads.clear();
+        m_pendingAllRegisterReads.clear();
+        m_pendingRegisterReads.clear();
+        m_pendingThreadListReads.clear();
+        m_pendingModuleListReads.clear();
+    }
+    if (resumesTarget)
+        m_stopGeneration++;
+
+    m_queues[(std::size_t)priority].push({std::move(run), std::move(drop), m_stopGeneration,
+        std::chrono::steady_clock::now()});
 }
 
 
-bool QueuedAdapter::Execute(const std::string& path, const LaunchConfigurations& configs)
+void QueuedAdapter::Submit(RequestPriority priority, std::function<void()> run, std::function<void()> drop,
+    bool resumesTarget) const
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    {
+        std::unique_lock<std::mutex> lock(m_queueMutex);
+        Push(priority, std::move(run), std::move(drop), resumesTarget);
+    }
+    m_queueCondition.notify_one();
+}
 
-    bool ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->Execute(path, configs);
-        sem.Release();
-    });
 
-    lock.unlock();
-    sem.Wait();
-    return ret;
+std::size_t QueuedAdapter::QueueDepth() const
+{
+    std::size_t depth = 0;
+    for (const auto& queue: m_queues)
+        depth += queue.size();
+    return depth;
 }
 
 
-bool QueuedAdapter::ExecuteWithArgs(const std::string &path, const std::string &args, const std::string &workingDir,
-					 const LaunchConfigurations &configs)
+bool QueuedAdapter::Execute(const std::string& path, const LaunchConfigurations& configs)
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return Enqueue("Execute", [&]{
+        return m_adapter->Execute(path, configs);
+    }, RequestPriority::Control, true).get();
+}
 
-    bool ret;
-    Semaphore sem;
-    m_queue.push([&, path, args]{
-        ret = m_adapter->ExecuteWithArgs(path, args, workingDir, configs);
-        sem.Release();
-    });
 
-    lock.unlock();
-    sem.Wait();
-    return ret;
+bool QueuedAdapter::ExecuteWithArgs(const std::string &path, const std::string &args, const std::string &workingDir,
+					 const LaunchConfigurations &configs)
+{
+    return Enqueue("ExecuteWithArgs", [&]{
+        return m_adapter->ExecuteWithArgs(path, args, workingDir, configs);
+    }, RequestPriority::Control, true).get();
 }
 
 
 bool QueuedAdapter::Attach(std::uint32_t pid)
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return Enqueue("Attach", [&]{
+        return m_adapter->Attach(pid);
+    }, RequestPriority::Control, true).get();
+}
 
-    bool ret;
-    Semaphore sem;
-    m_queue.push([&, pid]{
-        ret = m_adapter->Attach(pid);
-        sem.Release();
-    });
 
-    lock.unlock();
-    sem.Wait();
-    return ret;
+bool QueuedAdapter::Connect(const std::string& server, std::uint32_t port)
+{
+    return Enqueue("Connect", [&]{
+        return m_adapter->Connect(server, port);
+    }, RequestPriority::Control, true).get();
 }
 
 
-bool QueuedAdapter::Connect(const std::string& server, std::uint32_t port)
+void QueuedAdapter::Detach()
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    Enqueue("Detach", [&]{
+        m_adapter->Detach();
+    }, RequestPriority::Control, true).get();
+}
 
-    bool ret;
-    Semaphore sem;
-    m_queue.push([&, server, port]{
-        ret = m_adapter->Connect(server, port);
-        sem.Release();
-    });
 
-    lock.unlock();
-    sem.Wait();
-    return ret;
+void QueuedAdapter::Quit()
+{
+    Enqueue("Quit", [&]{
+        m_adapter->Quit();
+    }, RequestPriority::Control, true).get();
 }
 
 
-void QueuedAdapter::Detach()
+std::vector<DebugThread> QueuedAdapter::GetThreadList()
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return GetThreadListAsync().get();
+}
 
-    Semaphore sem;
-    m_queue.push([&]{
-        m_adapter->Detach();
-        sem.Release();
-    });
 
-    lock.unlock();
-    sem.Wait();
+DebugThread QueuedAdapter::GetActiveThread() const
+{
+    return Enqueue("GetActiveThread", [&]{
+        return m_adapter->GetActiveThread();
+    }, RequestPriority::Snapshot).get();
 }
 
 
-void QueuedAdapter::Quit()
+std::uint32_t QueuedAdapter::GetActiveThreadId() const
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return Enqueue("GetActiveThreadId", [&]{
+        return m_adapter->GetActiveThreadId();
+    }, RequestPriority::Snapshot).get();
+}
 
-    Semaphore sem;
-    m_queue.push([&]{
-        m_adapter->Quit();
-        sem.Release();
-    });
 
-    lock.unlock();
-    sem.Wait();
+bool QueuedAdapter::SetActiveThread(const DebugThread& thread)
+{
+    return Enqueue("SetActiveThread", [&]{
+        return m_adapter->SetActiveThread(thread);
+    }, RequestPriority::Control).get();
 }
 
 
-std::vector<DebugThread> QueuedAdapter::GetThreadList()
+bool QueuedAdapter::SetActiveThreadId(std::uint32_t tid)
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return Enqueue("SetActiveThreadId", [&]{
+        return m_adapter->SetActiveThreadId(tid);
+    }, RequestPriority::Control).get();
+}
 
-    std::vector<DebugThread> threads;
-    Semaphore sem;
-    m_queue.push([&]{
-        threads = m_adapter->GetThreadList();
-        sem.Release();
-    });
 
-    lock.unlock();
-    sem.Wait();
-    return threads;
+std::vector<DebugFrame> QueuedAdapter::GetFramesOfThread(std::uint32_t tid)
+{
+    return Enqueue("GetFramesOfThread", [&]{
+        return m_adapter->GetFramesOfThread(tid);
+    }, RequestPriority::Snapshot).get();
 }
 
 
-DebugThread QueuedAdapter::GetActiveThread() const
+DebugBreakpoint QueuedAdapter::AddBreakpoint(std::uintptr_t address, unsigned long breakpoint_type)
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return Enqueue("AddBreakpoint", [&]{
+        return m_adapter->AddBreakpoint(address, breakpoint_type);
+    }, RequestPriority::Control).get();
+}
 
-    DebugThread thread;
-    Semaphore sem;
-    m_queue.push([&]{
-        thread = m_adapter->GetActiveThread();
-        sem.Release();
-    });
 
-    lock.unlock();
-    sem.Wait();
-    return thread;
+DebugBreakpoint QueuedAdapter::AddBreakpoint(const ModuleNameAndOffset& address, unsigned long breakpoint_type)
+{
+    return Enqueue("AddBreakpoint", [&]{
+        return m_adapter->AddBreakpoint(address, breakpoint_type);
+    }, RequestPriority::Control).get();
 }
 
 
-std::uint32_t QueuedAdapter::GetActiveThreadId() const
+std::vector<DebugBreakpoint> QueuedAdapter::AddBreakpoints(const std::vector<std::uintptr_t>& addresses)
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return Enqueue("AddBreakpoints", [&]{
+        return m_adapter->AddBreakpoints(addresses);
+    }, RequestPriority::Control).get();
+}
 
-    std::uint32_t tid;
-    Semaphore sem;
-    m_queue.push([&]{
-        tid = m_adapter->GetActiveThreadId();
-        sem.Release();
-    });
 
-    lock.unlock();
-    sem.Wait();
-    return tid;
+std::vector<DebugBreakpoint> QueuedAdapter::AddBreakpoints(const std::vector<ModuleNameAndOffset>& addresses)
+{
+    return Enqueue("AddBreakpoints", [&]{
+        return m_adapter->AddBreakpoints(addresses);
+    }, RequestPriority::Control).get();
 }
 
 
-bool QueuedAdapter::SetActiveThread(const DebugThread& thread)
+bool QueuedAdapter::RemoveBreakpoints(const std::vector<DebugBreakpoint>& breakpoints)
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return Enqueue("RemoveBreakpoints", [&]{
+        return m_adapter->RemoveBreakpoints(breakpoints);
+    }, RequestPriority::Control).get();
+}
 
-    bool ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->SetActiveThread(thread);
-        sem.Release();
-    });
 
-    lock.unlock();
-    sem.Wait();
-    return ret;
+bool QueuedAdapter::SetBreakpointCondition(std::uintptr_t address, const std::string& condition)
+{
+    return Enqueue("SetBreakpointCondition", [&]{
+        return m_adapter->SetBreakpointCondition(address, condition);
+    }, RequestPriority::Control).get();
 }
 
 
-bool QueuedAdapter::SetActiveThreadId(std::uint32_t tid)
+bool QueuedAdapter::RemoveBreakpoint(const DebugBreakpoint& breakpoint)
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return Enqueue("RemoveBreakpoint", [&]{
+        return m_adapter->RemoveBreakpoint(breakpoint);
+    }, RequestPriority::Control).get();
+}
 
-    bool ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->SetActiveThreadId(tid);
-        sem.Release();
-    });
-    lock.unlock();
-    sem.Wait();
-    return ret;
+
+std::vector<DebugBreakpoint> QueuedAdapter::GetBreakpointList() const
+{
+    return Enqueue("GetBreakpointList", [&]{
+        return m_adapter->GetBreakpointList();
+    }, RequestPriority::Snapshot).get();
 }
 
 
-std::vector<DebugFrame> QueuedAdapter::GetFramesOfThread(std::uint32_t tid)
+bool QueuedAdapter::AddWatchpoint(std::uintptr_t address, std::size_t size, DebugWatchpointType type)
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return Enqueue("AddWatchpoint", [&]{
+        return m_adapter->AddWatchpoint(address, size, type);
+    }, RequestPriority::Control).get();
+}
 
-    std::vector<DebugFrame> result;
-    Semaphore sem;
-    m_queue.push([&]{
-        result = m_adapter->GetFramesOfThread(tid);
-        sem.Release();
-    });
-    lock.unlock();
-    sem.Wait();
-    return result;
+
+bool QueuedAdapter::RemoveWatchpoint(std::uintptr_t address)
+{
+    return Enqueue("RemoveWatchpoint", [&]{
+        return m_adapter->RemoveWatchpoint(address);
+    }, RequestPriority::Control).get();
 }
 
 
-DebugBreakpoint QueuedAdapter::AddBreakpoint(std::uintptr_t address, unsigned long breakpoint_type)
+std::vector<DebugWatchpoint> QueuedAdapter::GetWatchpointList() const
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return Enqueue("GetWatchpointList", [&]{
+        return m_adapter->GetWatchpointList();
+    }, RequestPriority::Snapshot).get();
+}
 
-    DebugBreakpoint ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->AddBreakpoint(address, breakpoint_type);
-        sem.Release();
-    });
-    lock.unlock();
-    sem.Wait();
-    return ret;
+
+std::uintptr_t QueuedAdapter::GetStopDataAddress()
+{
+    return Enqueue("GetStopDataAddress", [&]{
+        return m_adapter->GetStopDataAddress();
+    }, RequestPriority::Snapshot).get();
 }
 
 
-bool QueuedAdapter::RemoveBreakpoint(const DebugBreakpoint& breakpoint)
+bool QueuedAdapter::StartTrace(const std::vector<DebugTracepoint>& tracepoints)
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return Enqueue("StartTrace", [&]{
+        return m_adapter->StartTrace(tracepoints);
+    }, RequestPriority::Control).get();
+}
 
-    bool ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->RemoveBreakpoint(breakpoint);
-        sem.Release();
-    });
-    lock.unlock();
-    sem.Wait();
-    return ret;
+
+bool QueuedAdapter::StopTrace()
+{
+    return Enqueue("StopTrace", [&]{
+        return m_adapter->StopTrace();
+    }, RequestPriority::Control).get();
 }
 
 
-std::vector<DebugBreakpoint> QueuedAdapter::GetBreakpointList() const
+DebugTraceStatus QueuedAdapter::GetTraceStatus()
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return Enqueue("GetTraceStatus", [&]{
+        return m_adapter->GetTraceStatus();
+    }, RequestPriority::Snapshot).get();
+}
 
-    std::vector<DebugBreakpoint> ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->GetBreakpointList();
-        sem.Release();
-    });
-    lock.unlock();
-    sem.Wait();
-    return ret;
+
+std::vector<DebugTraceFrame> QueuedAdapter::GetTraceFrames()
+{
+    return Enqueue("GetTraceFrames", [&]{
+        return m_adapter->GetTraceFrames();
+    }, RequestPriority::Snapshot).get();
 }
 
 
 std::unordered_map<std::string, DebugRegister> QueuedAdapter::ReadAllRegisters()
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
-
-    std::unordered_map<std::string, DebugRegister> ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->ReadAllRegisters();
-        sem.Release();
-    });
-    lock.unlock();
-    sem.Wait();
-    return ret;
+    return ReadAllRegistersAsync().get();
 }
 
 
 DebugRegister QueuedAdapter::ReadRegister(const std::string& reg)
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
-
-    DebugRegister ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->ReadRegister(reg);
-        sem.Release();
-    });
-    lock.unlock();
-    sem.Wait();
-    return ret;
+    return ReadRegisterAsync(reg).get();
 }
 
 
 bool QueuedAdapter::WriteRegister(const std::string& reg, std::uintptr_t value)
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
-
-    bool ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->WriteRegister(reg, value);
-        sem.Release();
-    });
-    lock.unlock();
-    sem.Wait();
-    return ret;
+    return Enqueue("WriteRegister", [&]{
+        return m_adapter->WriteRegister(reg, value);
+    }, RequestPriority::Control).get();
 }
 
 
 DataBuffer QueuedAdapter::ReadMemory(std::uintptr_t address, std::size_t size)
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return ReadMemoryAsync(address, size).get();
+}
 
-    DataBuffer ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->ReadMemory(address, size);
-        sem.Release();
-    });
-    lock.unlock();
-    sem.Wait();
-    return ret;
+
+std::shared_future<DataBuffer> QueuedAdapter::ReadMemoryAsync(std::uintptr_t address, std::size_t size,
+    RequestPriority priority)
+{
+    return EnqueueCoalesced("ReadMemory", m_pendingMemoryReads, fmt::format("{:x}:{:x}", address, size), priority,
+        [this, address, size]{
+            return m_adapter->ReadMemory(address, size);
+        });
 }
 
 
-bool QueuedAdapter::WriteMemory(std::uintptr_t address, const DataBuffer& buffer)
+std::shared_future<std::unordered_map<std::string, DebugRegister>> QueuedAdapter::ReadAllRegistersAsync(
+    RequestPriority priority)
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return EnqueueCoalesced("ReadAllRegisters", m_pendingAllRegisterReads, "", priority, [this]{
+        return m_adapter->ReadAllRegisters();
+    });
+}
+
 
-    bool ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->WriteMemory(address, buffer);
-        sem.Release();
+std::shared_future<DebugRegister> QueuedAdapter::ReadRegisterAsync(const std::string& reg, RequestPriority priority)
+{
+    return EnqueueCoalesced("ReadRegister", m_pendingRegisterReads, reg, priority, [this, reg]{
+        return m_adapter->ReadRegister(reg);
     });
-    lock.unlock();
-    sem.Wait();
-    return ret;
 }
 
 
-std::vector<DebugModule> QueuedAdapter::GetModuleList()
+std::shared_future<std::vector<DebugThread>> QueuedAdapter::GetThreadListAsync(RequestPriority priority)
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return EnqueueCoalesced("GetThreadList", m_pendingThreadListReads, "", priority, [this]{
+        return m_adapter->GetThreadList();
+    });
+}
+
 
-    std::vector<DebugModule> ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->GetModuleList();
-        sem.Release();
+std::shared_future<std::vector<DebugModule>> QueuedAdapter::GetModuleListAsync(RequestPriority priority)
+{
+    return EnqueueCoalesced("GetModuleList", m_pendingModuleListReads, "", priority, [this]{
+        return m_adapter->GetModuleList();
     });
-    lock.unlock();
-    sem.Wait();
-    return ret;
 }
 
 
-std::string QueuedAdapter::GetTargetArchitecture()
+bool QueuedAdapter::WriteMemory(std::uintptr_t address, const DataBuffer& buffer)
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return Enqueue("WriteMemory", [&]{
+        return m_adapter->WriteMemory(address, buffer);
+    }, RequestPriority::Control).get();
+}
 
-    std::string ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->GetTargetArchitecture();
-        sem.Release();
-    });
-    lock.unlock();
-    sem.Wait();
-    return ret;
+
+std::vector<DebugModule> QueuedAdapter::GetModuleList()
+{
+    return GetModuleListAsync().get();
 }
 
 
-DebugStopReason QueuedAdapter::StopReason()
+std::string QueuedAdapter::GetTargetArchitecture()
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return Enqueue("GetTargetArchitecture", [&]{
+        return m_adapter->GetTargetArchitecture();
+    }, RequestPriority::Snapshot).get();
+}
 
-    DebugStopReason ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->StopReason();
-        sem.Release();
-    });
-    lock.unlock();
-    sem.Wait();
-    return ret;
+
+DebugStopReason QueuedAdapter::StopReason()
+{
+    return Enqueue("StopReason", [&]{
+        return m_adapter->StopReason();
+    }, RequestPriority::Snapshot).get();
 }
 
 
 uint64_t QueuedAdapter::ExitCode()
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
-
-    uint64_t ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->ExitCode();
-        sem.Release();
-    });
-    lock.unlock();
-    sem.Wait();
-    return ret;
+    return Enqueue("ExitCode", [&]{
+        return m_adapter->ExitCode();
+    }, RequestPriority::Snapshot).get();
 }
 
 
@@ -461,67 +444,57 @@ bool QueuedAdapter::BreakInto()
 }
 
 
-DebugStopReason QueuedAdapter::Go()
+// Like BreakInto, these are used while Go() occupies the worker, so they skip the queue. The adapter serializes them
+// with the requests of the worker.
+bool QueuedAdapter::ResumeThread(std::uint32_t tid)
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return m_adapter->ResumeThread(tid);
+}
 
-    DebugStopReason ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->Go();
-        sem.Release();
-    });
-    lock.unlock();
-    sem.Wait();
-    return ret;
+
+bool QueuedAdapter::StopThread(std::uint32_t tid)
+{
+    return m_adapter->StopThread(tid);
 }
 
 
-DebugStopReason QueuedAdapter::StepInto()
+DebugStopReason QueuedAdapter::Go()
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return Enqueue("Go", [&]{
+        return m_adapter->Go();
+    }, RequestPriority::Control, true).get();
+}
 
-    DebugStopReason ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->StepInto();
-        sem.Release();
-    });
-    lock.unlock();
-    sem.Wait();
-    return ret;
+
+DebugStopReason QueuedAdapter::StepInto()
+{
+    return Enqueue("StepInto", [&]{
+        return m_adapter->StepInto();
+    }, RequestPriority::Control, true).get();
 }
 
 
 DebugStopReason QueuedAdapter::StepOver()
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
-
-    DebugStopReason ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->StepOver();
-        sem.Release();
-    });
-    lock.unlock();
-    sem.Wait();
-    return ret;
+    return Enqueue("StepOver", [&]{
+        return m_adapter->StepOver();
+    }, RequestPriority::Control, true).get();
 }
 
 
 DebugStopReason QueuedAdapter::StepReturn()
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
+    return Enqueue("StepReturn", [&]{
+        return m_adapter->StepReturn();
+    }, RequestPriority::Control, true).get();
+}
 
-    DebugStopReason ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->StepReturn();
-        sem.Release();
-    });
-    lock.unlock();
-    sem.Wait();
-    return ret;
+
+DebugStopReason QueuedAdapter::StepRange(std::uintptr_t start, std::uintptr_t end)
+{
+    return Enqueue("StepRange", [&]{
+        return m_adapter->StepRange(start, end);
+    }, RequestPriority::Control, true).get();
 }
 
 
@@ -534,33 +507,17 @@ std::string QueuedAdapter::InvokeBackendCommand(const std::string& command)
 
 std::uintptr_t QueuedAdapter::GetInstructionOffset()
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
-
-    std::uintptr_t ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->GetInstructionOffset();
-        sem.Release();
-    });
-    lock.unlock();
-    sem.Wait();
-    return ret;
+    return Enqueue("GetInstructionOffset", [&]{
+        return m_adapter->GetInstructionOffset();
+    }, RequestPriority::Snapshot).get();
 }
 
 
 uint64_t QueuedAdapter::GetStackPointer()
 {
-    std::unique_lock<std::mutex> lock(m_queueMutex);
-
-    std::uintptr_t ret;
-    Semaphore sem;
-    m_queue.push([&]{
-        ret = m_adapter->GetStackPointer();
-        sem.Release();
-    });
-    lock.unlock();
-    sem.Wait();
-    return ret;
+    return Enqueue("GetStackPointer", [&]{
+        return m_adapter->GetStackPointer();
+    }, RequestPriority::Snapshot).get();
 }
 
 
@@ -572,17 +529,36 @@ bool QueuedAdapter::SupportFeature(DebugAdapterCapacity feature)
 
 void QueuedAdapter::Worker()
 {
+    std::unique_lock<std::mutex> lock(m_queueMutex);
     while (true)
     {
-        std::unique_lock<std::mutex> lock(m_queueMutex);
-        if (m_queue.size() != 0)
-        {
-            std::function<void()> func = m_queue.front();
-            m_queue.pop();
+        m_queueCondition.wait(lock, [this]{ return m_stopWorker || (QueueDepth() != 0); });
+        // Run the tasks that are already queued before stopping, so no caller is left waiting for its result
+        auto queue = std::find_if(m_queues.begin(), m_queues.end(), [](const auto& queue) { return !queue.empty(); });
+        if (queue == m_queues.end())
+            return;
+
+        m_maxQueueDepth = std::max(m_maxQueueDepth, QueueDepth());
+        QueuedTask task = std::move(queue->front());
+        queue->pop();
 
+        if (task.m_drop && (task.m_stopGeneration != m_stopGeneration))
+        {
+            m_droppedRequests++;
             lock.unlock();
-            func();
+            task.m_drop();
+            lock.lock();
+            continue;
         }
+
+        const auto waitTime = std::chrono::steady_clock::now() - task.m_queuedTime;
+        m_totalWaitTime += waitTime;
+        m_maxWaitTime = std::max(m_maxWaitTime, waitTime);
+        m_tasksRun++;
+
+        lock.unlock();
+        task.m_run();
+        lock.lock();
     }
 }
 
@@ -598,3 +574,58 @@ void QueuedAdapter::WriteStdin(const std::string &msg)
 {
 	m_adapter->WriteStdin(msg);
 }
+
+
+Ref<Metadata> QueuedAdapter::GetProperty(const std::string& name)
+{
+	if (name == "stats")
+	{
+		using namespace std::chrono;
+		std::map<std::string, Ref<Metadata>> queue;
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			queue["depth"] = new Metadata((uint64_t)QueueDepth());
+			queue["max_depth"] = new Metadata((uint64_t)m_maxQueueDepth);
+			queue["tasks_run"] = new Metadata(m_tasksRun);
+			queue["coalesced_requests"] = new Metadata(m_coalescedRequests);
+			queue["dropped_requests"] = new Metadata(m_droppedRequests);
+			queue["total_wait_time"] = new Metadata((uint64_t)duration_cast<microseconds>(m_totalWaitTime).count());
+			queue["max_wait_time"] = new Metadata((uint64_t)duration_cast<microseconds>(m_maxWaitTime).count());
+		}
+
+		std::map<std::string, Ref<Metadata>> stats;
+		stats["operations"] = m_operationMetrics.ToMetadata();
+		stats["queue"] = new Metadata(queue);
+		if (auto rsp = m_adapter->GetProperty("rsp_statistics"))
+			stats["rsp"] = rsp;
+		return new Metadata(stats);
+	}
+
+	if (name.rfind("queue_", 0) == 0)
+	{
+		using namespace std::chrono;
+		std::unique_lock<std::mutex> lock(m_queueMutex);
+		if (name == "queue_depth")
+			return new Metadata((uint64_t)QueueDepth());
+		else if (name == "queue_max_depth")
+			return new Metadata((uint64_t)m_maxQueueDepth);
+		else if (name == "queue_tasks_run")
+			return new Metadata(m_tasksRun);
+		else if (name == "queue_coalesced_requests")
+			return new Metadata(m_coalescedRequests);
+		else if (name == "queue_dropped_requests")
+			return new Metadata(m_droppedRequests);
+		// The wait times are in microseconds
+		else if (name == "queue_total_wait_time")
+			return new Metadata((uint64_t)duration_cast<microseconds>(m_totalWaitTime).count());
+		else if (name == "queue_max_wait_time")
+			return new Metadata((uint64_t)duration_cast<microseconds>(m_maxWaitTime).count());
+	}
+	return m_adapter->GetProperty(name);
+}
+
+
+bool QueuedAdapter::SetProperty(const std::string& name, const Ref<Metadata>& value)
+{
+	return m_adapter->SetProperty(name, value);
+}
@@ -20,16 +20,180 @@ limitations under the License.
 #include "rspconnector.h"
 #include <map>
 #include <queue>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <array>
+#include <type_traits>
 #include "../semaphore.h"
+#include "adaptermetrics.h"
 #include "gdbadapter.h"
 
 namespace BinaryNinjaDebugger
 {
+	// The worker always runs the queued request of the highest priority first
+	enum class RequestPriority
+	{
+		// Run control, and anything that changes the target or the adapter state. These run in the order queued, and
+		// are never dropped.
+		Control,
+		// Reads of the target state for the current stop, e.g., the registers after a step
+		Snapshot,
+		// Reads that nothing waits on yet, e.g., the memory around the current view
+		Prefetch,
+	};
+
+
 	class QueuedAdapter : public DebugAdapter
 	{
 		DebugAdapter* m_adapter;
+
+		static constexpr std::size_t PRIORITY_COUNT = 3;
+
+		struct QueuedTask
+		{
+			std::function<void()> m_run;
+			// Completes the request with an empty result without running it. Null for the requests that must run.
+			std::function<void()> m_drop;
+			// The stop the request was queued for
+			std::uint64_t m_stopGeneration;
+			std::chrono::steady_clock::time_point m_queuedTime;
+		};
+
 		mutable std::mutex m_queueMutex;
-		mutable std::queue<std::function<void()>> m_queue;
+		// Signaled when a task is queued, or the worker is asked to stop
+		mutable std::condition_variable m_queueCondition;
+		mutable std::array<std::queue<QueuedTask>, PRIORITY_COUNT> m_queues;
+		bool m_stopWorker{};
+		std::thread m_worker;
+
+		// Incremented when a request that resumes the target is queued. The snapshot and prefetch requests queued
+		// before it are for a state that is gone, so they are dropped rather than run against the running target.
+		mutable std::uint64_t m_stopGeneration{};
+
+		// Statistics of the queue, protected by m_queueMutex. The wait time is from queuing a task to it being started.
+		std::size_t m_maxQueueDepth{};
+		std::uint64_t m_tasksRun{};
+		std::uint64_t m_droppedRequests{};
+		std::chrono::steady_clock::duration m_totalWaitTime{};
+		std::chrono::steady_clock::duration m_maxWaitTime{};
+
+		// Must be called with m_queueMutex held
+		void Push(RequestPriority priority, std::function<void()> run, std::function<void()> drop,
+			bool resumesTarget) const;
+		void Submit(RequestPriority priority, std::function<void()> run, std::function<void()> drop,
+			bool resumesTarget = false) const;
+		std::size_t QueueDepth() const;
+		void Worker();
+
+		// The calls to the adapter, by the name of the method
+		mutable OperationMetrics m_operationMetrics;
+
+		// Make the functions that run the request, and drop it, which fulfill the promise with the result, or an
+		// empty one
+		template <typename T, typename Function>
+		std::pair<std::function<void()>, std::function<void()>> MakeTask(const char* operation, Function function,
+			std::shared_ptr<std::promise<T>> promise) const
+		{
+			auto run = [this, operation, function, promise]() mutable {
+				const auto start = std::chrono::steady_clock::now();
+				bool failed = false;
+				try
+				{
+					if constexpr (std::is_void_v<T>)
+					{
+						function();
+						promise->set_value();
+					}
+					else
+						promise->set_value(function());
+				}
+				catch (...)
+				{
+					failed = true;
+					promise->set_exception(std::current_exception());
+				}
+				m_operationMetrics.Record(operation, std::chrono::steady_clock::now() - start, failed);
+			};
+			auto drop = [promise]{
+				if constexpr (std::is_void_v<T>)
+					promise->set_value();
+				else
+					promise->set_value(T{});
+			};
+			return {run, drop};
+		}
+
+		// Queue a call to the adapter. The synchronous methods wait on the returned future.
+		template <typename Function>
+		auto Enqueue(const char* operation, Function function, RequestPriority priority,
+			bool resumesTarget = false) const -> std::future<decltype(function())>
+		{
+			using T = decltype(function());
+			auto promise = std::make_shared<std::promise<T>>();
+			auto result = promise->get_future();
+			auto task = MakeTask<T>(operation, std::move(function), promise);
+			Submit(priority, std::move(task.first),
+				priority == RequestPriority::Control ? nullptr : std::move(task.second), resumesTarget);
+			return result;
+		}
+
+		// A read that is queued or running, which identical reads can wait on rather than queuing their own
+		template <typename T>
+		struct PendingRequest
+		{
+			std::uint64_t m_id;
+			RequestPriority m_priority;
+			std::shared_future<T> m_result;
+		};
+		template <typename T>
+		using PendingRequests = std::unordered_map<std::string, PendingRequest<T>>;
+
+		// Protected by m_queueMutex. Any control request can change the target state, so it clears these, and the
+		// reads after it are not merged with the ones before it.
+		mutable PendingRequests<DataBuffer> m_pendingMemoryReads;
+		mutable PendingRequests<std::unordered_map<std::string, DebugRegister>> m_pendingAllRegisterReads;
+		mutable PendingRequests<DebugRegister> m_pendingRegisterReads;
+		mutable PendingRequests<std::vector<DebugThread>> m_pendingThreadListReads;
+		mutable PendingRequests<std::vector<DebugModule>> m_pendingModuleListReads;
+		std::uint64_t m_nextRequestId{};
+		std::uint64_t m_coalescedRequests{};
+
+		template <typename T, typename Function>
+		std::shared_future<T> EnqueueCoalesced(const char* operation, PendingRequests<T>& pending,
+			const std::string& key, RequestPriority priority, Function function)
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			// A pending prefetch is not reused for a snapshot, which would then wait behind the other prefetches
+			if (auto it = pending.find(key); (it != pending.end()) && (it->second.m_priority <= priority))
+			{
+				m_coalescedRequests++;
+				return it->second.m_result;
+			}
+
+			const auto id = ++m_nextRequestId;
+			auto promise = std::make_shared<std::promise<T>>();
+			std::shared_future<T> result = promise->get_future().share();
+			pending[key] = {id, priority, result};
+
+			auto task = MakeTask<T>(operation, std::move(function), promise);
+			auto run = std::move(task.first);
+			auto drop = std::move(task.second);
+			auto forget = [this, &pending, key, id]{
+				std::unique_lock<std::mutex> lock(m_queueMutex);
+				// The entry may have been cleared, and replaced by a later request, in the meantime
+				if (auto it = pending.find(key); (it != pending.end()) && (it->second.m_id == id))
+					pending.erase(it);
+			};
+			Push(priority, [run, forget]() mutable { run(); forget(); },
+				[drop, forget]() mutable { drop(); forget(); }, false);
+			lock.unlock();
+
+			m_queueCondition.notify_one();
+			return result;
+		}
 
 	public:
 		QueuedAdapter(DebugAdapter* adapter);
@@ -52,11 +216,26 @@ namespace BinaryNinjaDebugger
 		std::vector<DebugFrame> GetFramesOfThread(uint32_t tid) override;
 
 		DebugBreakpoint AddBreakpoint(std::uintptr_t address, unsigned long breakpoint_type = 0) override;
+		DebugBreakpoint AddBreakpoint(const ModuleNameAndOffset& address, unsigned long breakpoint_type = 0) override;
+		std::vector<DebugBreakpoint> AddBreakpoints(const std::vector<std::uintptr_t>& addresses) override;
+		std::vector<DebugBreakpoint> AddBreakpoints(const std::vector<ModuleNameAndOffset>& addresses) override;
 
 		bool RemoveBreakpoint(const DebugBreakpoint& breakpoint) override;
+		bool RemoveBreakpoints(const std::vector<DebugBreakpoint>& breakpoints) override;
+		bool SetBreakpointCondition(std::uintptr_t address, const std::string& condition) override;
 
 		std::vector<DebugBreakpoint> GetBreakpointList() const override;
 
+		bool AddWatchpoint(std::uintptr_t address, std::size_t size, DebugWatchpointType type) override;
+		bool RemoveWatchpoint(std::uintptr_t address) override;
+		std::vector<DebugWatchpoint> GetWatchpointList() const override;
+		std::uintptr_t GetStopDataAddress() override;
+
+		bool StartTrace(const std::vector<DebugTracepoint>& tracepoints) override;
+		bool StopTrace() override;
+		DebugTraceStatus GetTraceStatus() override;
+		std::vector<DebugTraceFrame> GetTraceFrames() override;
+
 		std::unordered_map<std::string, DebugRegister> ReadAllRegisters() override;
 		DebugRegister ReadRegister(const std::string& reg) override;
 		bool WriteRegister(const std::string& reg, std::uintptr_t value) override;
@@ -64,6 +243,20 @@ namespace BinaryNinjaDebugger
 		DataBuffer ReadMemory(std::uintptr_t address, std::size_t size) override;
 		bool WriteMemory(std::uintptr_t address, const DataBuffer& buffer) override;
 
+		// The reads that several views issue at the same time, e.g., after the target stops. Identical reads that are
+		// pending at once are answered by a single call to the adapter.
+		// A read that is still queued when the target resumes is dropped, and completes with an empty result.
+		std::shared_future<DataBuffer> ReadMemoryAsync(std::uintptr_t address, std::size_t size,
+			RequestPriority priority = RequestPriority::Snapshot);
+		std::shared_future<std::unordered_map<std::string, DebugRegister>> ReadAllRegistersAsync(
+			RequestPriority priority = RequestPriority::Snapshot);
+		std::shared_future<DebugRegister> ReadRegisterAsync(const std::string& reg,
+			RequestPriority priority = RequestPriority::Snapshot);
+		std::shared_future<std::vector<DebugThread>> GetThreadListAsync(
+			RequestPriority priority = RequestPriority::Snapshot);
+		std::shared_future<std::vector<DebugModule>> GetModuleListAsync(
+			RequestPriority priority = RequestPriority::Snapshot);
+
 		std::vector<DebugModule> GetModuleList() override;
 
 		std::string GetTargetArchitecture() override;
@@ -76,10 +269,13 @@ namespace BinaryNinjaDebugger
 		bool GenericGoAsync(const std::string& go_type);
 
 		bool BreakInto() override;
+		bool ResumeThread(std::uint32_t tid) override;
+		bool StopThread(std::uint32_t tid) override;
 		DebugStopReason Go() override;
 		DebugStopReason StepInto() override;
 		DebugStopReason StepOver() override;
 		DebugStopReason StepReturn() override;
+		DebugStopReason StepRange(std::uintptr_t start, std::uintptr_t end) override;
 
 		std::string InvokeBackendCommand(const std::string& command) override;
 		std::uintptr_t GetInstructionOffset() override;
@@ -87,10 +283,11 @@ namespace BinaryNinjaDebugger
 
 		bool SupportFeature(DebugAdapterCapacity feature) override;
 
-		void Worker();
-
 		virtual void SetEventCallback(std::function<void(const DebuggerEvent &)> function) override;
 
 		virtual void WriteStdin(const std::string& msg) override;
+
+		Ref<Metadata> GetProperty(const std::string& name) override;
+		bool SetProperty(const std::string& name, const Ref<Metadata>& value) override;
 	};
 };
@@ -17,16 +17,16 @@ limitations under the License.
 #include <numeric>
 #include <stdexcept>
 #include <algorithm>
-#include <chrono>
-#include <thread>
-#include <regex>
+#include <charconv>
+#include <cstring>
 #include <type_traits>
 #include <fmt/format.h>
 #include "rspconnector.h"
 
 using namespace BinaryNinjaDebugger;
 
-RspConnector::RspConnector(Socket* socket) : m_socket(socket) { }
+RspConnector::RspConnector(Transport* transport, RspStatistics* statistics) :
+    m_transport(transport), m_statistics(statistics) { }
 
 RspConnector::~RspConnector() {}
 
@@ -57,6 +57,53 @@ RspData RspConnector::BinaryDecode(const RspData& data)
     return RspData(result);
 }
 
+
+std::size_t RspConnector::BinaryDecode(std::string_view data, char* output, std::size_t capacity)
+{
+    std::size_t written = 0;
+    for ( std::size_t index = 0; (index < data.size()) && (written < capacity); index++ ) {
+        if ( (data[index] == 0x7d) && (index + 1 < data.size()) ) {
+            output[written++] = data[++index] ^ 0x20;
+        } else if ( (data[index] == 0x2a) && (index + 1 < data.size()) && (written > 0) ) {
+            const auto last_char = output[written - 1];
+            const std::size_t repeat = std::min<std::size_t>(
+                    std::max(static_cast<std::uint8_t>(data[++index]) - 29, 0), capacity - written);
+            std::memset(output + written, last_char, repeat);
+            written += repeat;
+        } else {
+            output[written++] = data[index];
+        }
+    }
+    return written;
+}
+
+// Escape the bytes that cannot appear verbatim in a packet, for the binary X packet. Stops before output grows
+// beyond maxOutputSize, and returns the number of input bytes that are encoded.
+std::size_t RspConnector::BinaryEncode(const std::uint8_t* data, std::size_t size, std::string& output,
+                                       std::size_t maxOutputSize)
+{
+    std::size_t index{};
+    for ( ; index < size; index++ )
+    {
+        const auto c = data[index];
+        const bool escape = (c == '#' || c == '$' || c == '}' || c == '*');
+        if (output.size() + (escape ? 2 : 1) > maxOutputSize)
+            break;
+
+        if (escape)
+        {
+            output.push_back(0x7d);
+            output.push_back(static_cast<char>(c ^ 0x20));
+        }
+        else
+        {
+            output.push_back(static_cast<char>(c));
+        }
+    }
+
+    return index;
+}
+
 RspData RspConnector::DecodeRLE(const RspData& data)
 {
     if ( std::find(data.begin(), data.end(), '*') != data.end() )
@@ -89,51 +136,133 @@ RspData RspConnector::DecodeRLE(const RspData& data)
     return data;
 }
 
-std::unordered_map<std::string, std::uint64_t> RspConnector::PacketToUnorderedMap(const RspData& data)
+bool RspTokenizer::Next(std::string_view& token)
 {
-    std::unordered_map<std::string, std::uint64_t> packet_map{};
-    packet_map["signal"] = std::stoull(data.AsString().substr(1, 2), nullptr, 16);
+    if ( this->m_remaining.empty() )
+        return false;
+
+    const auto separator = this->m_remaining.find(this->m_separator);
+    token = this->m_remaining.substr(0, separator);
+    if ( separator == std::string_view::npos )
+        this->m_remaining = {};
+    else
+        this->m_remaining.remove_prefix(separator + 1);
+    return true;
+}
 
-    const auto data_string = data.AsString();
-    const auto after_signal = data_string.substr(3);
+bool RspTokenizer::ParseHex(std::string_view text, std::uint64_t& value)
+{
+    if ( text.empty() )
+        return false;
 
-    for ( const auto& entries : RspConnector::Split(after_signal, ";")) {
-        const auto key_value = RspConnector::Split(entries, ":");
-        if (key_value.empty())
-            continue;
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), value, 16);
+    return (result.ec == std::errc()) && (result.ptr == text.data() + text.size());
+}
+
+bool RspStopReply::Parse(std::string_view packet)
+{
+    *this = RspStopReply{};
+    if ( packet.size() < 3 )
+        return false;
+
+    this->m_type = packet[0];
+    if ( (this->m_type != 'T') && (this->m_type != 'S') && (this->m_type != 'W') && (this->m_type != 'X') )
+        return false;
+
+    // The exit code of a 'W' can be followed by ";process:pid"
+    packet.remove_prefix(1);
+    const auto number_end = std::min(packet.find(';'), packet.size());
+    const auto number_size = (this->m_type == 'T') ? std::size_t(2) : number_end;
+    if ( !RspTokenizer::ParseHex(packet.substr(0, number_size), this->m_signal) )
+        return false;
+    packet.remove_prefix(std::min(number_size, packet.size()));
+    if ( (this->m_type != 'T') && !packet.empty() )
+        packet.remove_prefix(1);
+
+    RspTokenizer fields(packet, ';');
+    std::string_view field{};
+    while ( fields.Next(field) )
+    {
+        const auto separator = field.find(':');
+        const auto key = field.substr(0, separator);
+        const auto value = (separator == std::string_view::npos) ? std::string_view{} : field.substr(separator + 1);
 
-        const auto key = key_value[0];
-		std::string value;
-		if (key_value.size() == 2)
-		{
-			value = RspConnector::DecodeRLE(RspData(key_value[1])).AsString();
-
-			if (key == "thread") {
-				if (value[0] == 'p' && value.find('.') != std::string::npos) {
-					auto core_id_and_thread_id = RspConnector::Split(value.substr(1), ".");
-					packet_map["thread"] = std::stoull(core_id_and_thread_id[1], nullptr, 16);
-				} else {
-					packet_map["thread"] = std::stoull(value, nullptr, 16);
-				}
-			} else if (std::regex_search(key, std::regex("^[0-9a-fA-F]+$"))) {
-				packet_map[fmt::format("r{}", std::stoi(key, nullptr, 16))] =
-						static_cast<std::int64_t>( RspConnector::SwapEndianness(std::stoull(value, nullptr, 16)));
-			} else {
-				packet_map[key] = std::stoull(value, nullptr, 16);
-			}
-		}
-		else
-		{
-			packet_map[key] = 0;
-		}
+        std::uint64_t number{};
+        if ( key == "thread" )
+        {
+            // Either "tid", or "ppid.tid" when the multiprocess extensions are enabled
+            auto thread = value;
+            if ( !thread.empty() && thread[0] == 'p' )
+            {
+                const auto dot = thread.find('.');
+                RspTokenizer::ParseHex(thread.substr(1, dot - 1), this->m_processId);
+                thread = (dot == std::string_view::npos) ? std::string_view{} : thread.substr(dot + 1);
+            }
+            this->m_hasThread = RspTokenizer::ParseHex(thread, this->m_threadId);
+        }
+        else if ( key == "core" )
+            this->m_hasCore = RspTokenizer::ParseHex(value, this->m_core);
+        else if ( key == "swbreak" )
+            this->m_swbreak = true;
+        else if ( key == "hwbreak" )
+            this->m_hwbreak = true;
+        else if ( (key == "watch") || (key == "rwatch") || (key == "awatch") )
+        {
+            this->m_watchKind = key;
+            RspTokenizer::ParseHex(value, this->m_watchAddress);
+        }
+        else if ( key == "library" )
+            this->m_library = true;
+        else if ( (key == "fork") || (key == "vfork") || (key == "vforkdone") || (key == "exec") )
+        {
+            this->m_event = key;
+            this->m_eventValue = value;
+        }
+        else if ( RspTokenizer::ParseHex(key, number) )
+        {
+            if ( this->m_registerCount < MAX_EXPEDITED_REGISTERS )
+                this->m_registers[this->m_registerCount++] = {static_cast<std::uint32_t>(number), value};
+        }
+        else if ( this->m_otherFieldCount < MAX_OTHER_FIELDS )
+        {
+            this->m_otherFields[this->m_otherFieldCount++] = {key, value};
+        }
     }
 
-    return packet_map;
+    return true;
 }
 
-std::vector<std::string> RspConnector::Split(const std::string& string, const std::string& regex) {
-    const auto regex_l = std::regex(regex);
-    return { std::sregex_token_iterator(string.begin(), string.end(), regex_l, -1), std::sregex_token_iterator() };
+bool RspStopReply::FindField(std::string_view key, std::string_view& value) const
+{
+    for ( std::size_t index = 0; index < this->m_otherFieldCount; index++ )
+    {
+        if ( this->m_otherFields[index].first == key )
+        {
+            value = this->m_otherFields[index].second;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RspStopReply::FindHexField(std::string_view key, std::uint64_t& value) const
+{
+    std::string_view text{};
+    return this->FindField(key, text) && RspTokenizer::ParseHex(text, value);
+}
+
+std::vector<std::string> RspConnector::Split(const std::string& string, const std::string& separator) {
+    std::vector<std::string> result{};
+    std::size_t start = 0;
+    while ( start < string.size() )
+    {
+        auto end = string.find(separator, start);
+        if ( (end == std::string::npos) || separator.empty() )
+            end = string.size();
+        result.emplace_back(string, start, end - start);
+        start = end + separator.size();
+    }
+    return result;
 }
 
 void RspConnector::EnableAcks()
@@ -151,12 +280,7 @@ char RspConnector::ExpectAck()
     if ( !this->m_acksEnabled )
         return {};
 
-    char buffer{};
-    this->m_socket->Recv(&buffer, sizeof(buffer));
-
-    if ( buffer == char{} )
-        throw std::runtime_error("Disconnected while waiting for ack");
-
+    const char buffer = this->ReadByte();
     if ( buffer != '+' )
         throw std::runtime_error("incorrect response, expected +");
 
@@ -168,7 +292,9 @@ void RspConnector::SendAck() const
     if ( !this->m_acksEnabled )
         return;
 
-    this->m_socket->Send((char*)"+", 1);
+    this->m_transport->Send("+", 1);
+    if (this->m_statistics)
+        this->m_statistics->m_bytesSent++;
 }
 
 void RspConnector::NegotiateCapabilities(const std::vector <std::string>& capabilities)
@@ -202,9 +328,18 @@ void RspConnector::NegotiateCapabilities(const std::vector <std::string>& capabi
         this->m_acksEnabled = false;
 }
 
+bool RspConnector::HasCapability(const std::string& capability) const
+{
+    return std::find(this->m_serverCapabilities.begin(), this->m_serverCapabilities.end(), capability)
+        != this->m_serverCapabilities.end();
+}
+
 void RspConnector::SendRaw(const RspData& data) const
 {
-    this->m_socket->Send((char*)data.m_data.GetData(), static_cast<std::int32_t>( data.m_data.GetLength() ));
+    const auto lock = this->Lock();
+    this->m_transport->Send((const char*)data.m_data.GetData(), static_cast<std::int32_t>( data.m_data.GetLength() ));
+    if (this->m_statistics)
+        this->m_statistics->m_bytesSent += data.m_data.GetLength();
 }
 
 void RspConnector::SendPayload(const RspData& data) const
@@ -213,62 +348,207 @@ void RspConnector::SendPayload(const RspData& data) const
     auto packet = "$" + data.AsString() + "#" + fmt::format("{:02x}", checksum);
 
     this->SendRaw(RspData(packet));
+    if (this->m_statistics)
+        this->m_statistics->m_packetsSent++;
+}
+
+void RspConnector::FillReceiveBuffer()
+{
+    // Drop the bytes that are already consumed before appending new ones. Only the tail of a partially received
+    // packet is moved, and this happens at most once per packet.
+    if (this->m_receiveOffset > 0)
+    {
+        this->m_receiveBuffer.erase(this->m_receiveBuffer.begin(),
+                                    this->m_receiveBuffer.begin() + this->m_receiveOffset);
+        this->m_receiveOffset = 0;
+    }
+
+    // Block until there is something to read, rather than spinning on a non-blocking recv()
+    if (!this->m_transport->WaitForData())
+        throw std::runtime_error("failed to wait for data from the backend");
+
+    const auto used = this->m_receiveBuffer.size();
+    this->m_receiveBuffer.resize(used + RspData::BUFFER_MAX);
+    const intptr_t n = this->m_transport->Recv(this->m_receiveBuffer.data() + used, RspData::BUFFER_MAX);
+    if (n <= 0)
+    {
+        this->m_receiveBuffer.resize(used);
+        throw std::runtime_error("Disconnected while waiting for data");
+    }
+
+    this->m_receiveBuffer.resize(used + n);
+    if (this->m_statistics)
+        this->m_statistics->m_bytesReceived += n;
 }
 
-RspData RspConnector::ReceiveRspData() const
+char RspConnector::PeekByte()
 {
-    std::vector<char> buffer{};
+    while (this->m_receiveOffset >= this->m_receiveBuffer.size())
+        this->FillReceiveBuffer();
 
+    return this->m_receiveBuffer[this->m_receiveOffset];
+}
+
+char RspConnector::ReadByte()
+{
+    const char c = this->PeekByte();
+    this->m_receiveOffset++;
+    return c;
+}
+
+// Try to extract a complete "$payload#xx" frame from the receive buffer. Returns false if the frame is not complete
+// yet, in which case the scan resumes from where it stopped once more data is received. On success, payload points
+// into the receive buffer and stays valid until the next call to FillReceiveBuffer().
+bool RspConnector::ExtractPacket(const char*& payload, std::size_t& size, bool& checksumValid, bool& notification)
+{
+    const auto available = this->m_receiveBuffer.size() - this->m_receiveOffset;
+    const char* data = this->m_receiveBuffer.data() + this->m_receiveOffset;
+
+    if (this->m_frameScanOffset == 0)
+    {
+        if (available == 0)
+            return false;
+
+        if ((data[0] != '$') && (data[0] != '%'))
+            throw std::runtime_error("incorrect response, expected $");
+
+        this->m_frameNotification = (data[0] == '%');
+        this->m_frameScanOffset = 1;
+        this->m_frameChecksum = 0;
+    }
+
+    const auto hexValue = [](char c) -> int {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    };
+
+    for (; this->m_frameScanOffset < available; this->m_frameScanOffset++)
+    {
+        const char c = data[this->m_frameScanOffset];
+        // Binary data never contains a raw '#' since it is escaped as "}\x03", so the first '#' ends the packet
+        if (c == '#')
+        {
+            // The two checksum digits have not arrived yet
+            if (this->m_frameScanOffset + 2 >= available)
+                return false;
+
+            const int high = hexValue(data[this->m_frameScanOffset + 1]);
+            const int low = hexValue(data[this->m_frameScanOffset + 2]);
+            checksumValid = (high >= 0) && (low >= 0) && (((high << 4) | low) == this->m_frameChecksum);
+
+            payload = data + 1;
+            size = this->m_frameScanOffset - 1;
+            notification = this->m_frameNotification;
+            this->m_receiveOffset += this->m_frameScanOffset + 3;
+            this->m_frameScanOffset = 0;
+            if (this->m_statistics)
+                this->m_statistics->m_packetsReceived++;
+            return true;
+        }
+
+        this->m_frameChecksum += static_cast<std::uint8_t>(c);
+    }
+
+    return false;
+}
+
+RspData RspConnector::ReceiveRspData()
+{
+    const char* payload{};
+    std::size_t size{};
     while (true)
     {
-        char tmp_buffer[RspData::BUFFER_MAX]{'\0'};
-#ifdef WIN32
-        intptr_t n = this->m_socket->Recv(tmp_buffer, sizeof(tmp_buffer));
-#else
-        intptr_t n = this->m_socket->Recv(tmp_buffer, sizeof(tmp_buffer), MSG_DONTWAIT);
-#endif
-        if (n <= 0)
+        // Stray acks in front of a packet carry no information, skip them
+        if (this->m_frameScanOffset == 0 && this->PeekByte() == '+')
+        {
+            this->m_receiveOffset++;
             continue;
+        }
 
-        std::vector<char> tmpBufferVec(tmp_buffer, tmp_buffer + n);
-        auto location = std::find(tmpBufferVec.begin(), tmpBufferVec.end(), '#');
-//        Find a '#' followed by two digits
-        if ((location != tmpBufferVec.end())
-            && (location + 1 != tmpBufferVec.end() && (std::isxdigit(*(location + 1))))
-            && (location + 2 != tmpBufferVec.end() && (std::isxdigit(*(location + 2))))
-        )
+        bool checksumValid{}, notification{};
+        if (!this->ExtractPacket(payload, size, checksumValid, notification))
         {
-//            Found the packet end, truncate the last tmp buffer, and return a packet
-            tmpBufferVec.erase(location, tmpBufferVec.end());
-            std::copy(tmpBufferVec.begin(), tmpBufferVec.end(), std::back_inserter(buffer));
-            break;
+            this->FillReceiveBuffer();
+            continue;
         }
-        else
+
+        // Notifications can arrive between a request and its reply. They are never acknowledged or retransmitted,
+        // so a corrupted one is dropped.
+        if (notification)
         {
-            std::copy(tmpBufferVec.begin(), tmpBufferVec.begin() + n, std::back_inserter(buffer));
+            if (checksumValid)
+                this->m_notifications.emplace_back(payload, size);
+            continue;
         }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-    }
+        if (checksumValid)
+            break;
 
-    if ((buffer.size() < 1) || (buffer[0] != '$'))
-        throw std::runtime_error("incorrect response, expected $");
+        if (!this->m_acksEnabled)
+            throw std::runtime_error("checksum mismatch in the received packet");
 
-    // Swallow the '$' char
-    buffer.erase(buffer.begin(), buffer.begin() + 1);
+        // Ask the backend to retransmit the packet
+        this->m_transport->Send("-", 1);
+        if (this->m_statistics)
+            this->m_statistics->m_bytesSent++;
+    }
 
+    RspData reply = RspData(payload, size);
     this->SendAck();
 
-	RspData reply = RspData(std::string(buffer.data(), buffer.size()));
-	if ( std::find(reply.begin(), reply.end(), '*') != reply.end() )
-		reply = this->DecodeRLE(reply);
+    if ( std::find(payload, payload + size, '*') != payload + size )
+        reply = this->DecodeRLE(reply);
 
-	return reply;
+    return reply;
+}
+
+bool RspConnector::ReceiveNotification(RspData& notification, std::int32_t timeout)
+{
+    const auto lock = this->Lock();
+    while (true)
+    {
+        if (!this->m_notifications.empty())
+        {
+            notification = std::move(this->m_notifications.front());
+            this->m_notifications.pop_front();
+            return true;
+        }
+
+        if ((this->m_frameScanOffset == 0) && (this->m_receiveOffset < this->m_receiveBuffer.size())
+            && (this->m_receiveBuffer[this->m_receiveOffset] == '+'))
+        {
+            this->m_receiveOffset++;
+            continue;
+        }
+
+        const char* payload{};
+        std::size_t size{};
+        bool checksumValid{}, isNotification{};
+        if (this->ExtractPacket(payload, size, checksumValid, isNotification))
+        {
+            if (isNotification && checksumValid)
+                this->m_notifications.emplace_back(payload, size);
+            // Nothing is waiting for a reply here, so a stray packet is acknowledged and dropped
+            else if (!isNotification)
+                this->SendAck();
+            continue;
+        }
+
+        if (!this->m_transport->WaitForData(timeout))
+            return false;
+        this->FillReceiveBuffer();
+    }
 }
 
 RspData RspConnector::TransmitAndReceive(const RspData& data, const std::string& expect,
 										 std::function<void(const RspData& data)> asyncPacketHandler)
 {
+    const auto lock = this->Lock();
     this->SendPayload(data);
 
     RspData reply{};
@@ -282,25 +562,19 @@ RspData RspConnector::TransmitAndReceive(const RspData& data, const std::string&
     else if ( expect == "mixed_output_ack_then_reply" ) {
         bool ack_received = false;
         while(true) {
-            char peek{};
-            this->m_socket->Recv(&peek, sizeof(peek), MSG_PEEK);
-
-            if (!peek)
-                throw std::runtime_error("backend gone?");
+            const char peek = this->PeekByte();
 
             if (peek == '+') {
                 if (ack_received)
                     throw std::runtime_error("two acks came when only one was expected");
 
-                char buf{};
                 ack_received = true;
-                this->m_socket->Recv(&buf, sizeof(buf));
+                this->ReadByte();
                 continue;
             }
 
             if (peek != '$') {
-                char buf[16];
-                this->m_socket->Recv(buf, sizeof(buf));
+                this->ReadByte();
                 throw std::runtime_error("packet start is wrong");
             }
 
@@ -318,64 +592,99 @@ RspData RspConnector::TransmitAndReceive(const RspData& data, const std::string&
             throw std::runtime_error("expected ack, but received none");
     }
 
-    if ( std::find(reply.begin(), reply.end(), '*') != reply.end() )
-        reply = this->DecodeRLE(reply);
-
+    // ReceiveRspData() has already expanded the run-length encoding
     return reply;
 }
 
 
-int32_t RspConnector::HostFileIO(const RspData& data, RspData& output, int32_t& error)
+std::vector<RspData> RspConnector::TransmitAndReceiveBatch(const std::vector<RspData>& requests)
 {
-    this->SendPayload(data);
+    RspPipeline pipeline(*this);
+    std::vector<std::future<RspData>> futures{};
+    futures.reserve(requests.size());
+    for ( const auto& request : requests )
+        futures.push_back(pipeline.Queue(request));
+
+    std::vector<RspData> replies{};
+    replies.reserve(requests.size());
+    for ( auto& future : futures )
+        replies.push_back(future.get());
+
+    return replies;
+}
 
-    RspData reply{};
 
-    this->ExpectAck();
-    reply = this->ReceiveRspData();
-    if (reply.m_data[0] != 'F')
+int32_t RspConnector::ParseHostFileIOReply(const RspData& reply, std::string_view& attachment, int32_t& error)
+{
+    const std::string_view text(static_cast<const char*>(reply.m_data.GetData()), reply.m_data.GetLength());
+    if ( text.empty() || (text[0] != 'F') )
         throw std::runtime_error("host io packet is invalid");
 
-    std::string resultErrno = reply.AsString();
+    // The attachment is binary, so it can contain ';' and ',' itself. Only the first ';' separates it.
+    const auto separator = text.find(';');
+    attachment = (separator == std::string_view::npos) ? std::string_view{} : text.substr(separator + 1);
+
+    auto result = text.substr(1, (separator == std::string_view::npos) ? std::string_view::npos : separator - 1);
+    const auto comma = result.find(',');
+    if ( comma != std::string_view::npos ) {
+        const auto errorText = result.substr(comma + 1);
+        if ( !errorText.empty() )
+            std::from_chars(errorText.data(), errorText.data() + errorText.size(), error, 16);
+        result = result.substr(0, comma);
+    }
 
-    // split off attachment
-    if (resultErrno.find(';') != std::string::npos) {
-        const auto split = RspConnector::Split(resultErrno, ";");
-        if ((split.size() >= 2) && (split[1] != ""))
-            output = RspConnector::BinaryDecode(RspData(split[1]));
+    int32_t value{};
+    if ( std::from_chars(result.data(), result.data() + result.size(), value, 16).ec != std::errc() )
+        throw std::runtime_error("host io packet is invalid");
+    return value;
+}
 
-        resultErrno = split[0];
-    }
 
-    // remove the 'F' char at the beginning
-    if (resultErrno.length() > 0)
-        resultErrno = resultErrno.substr(1);
+int32_t RspConnector::HostFileIO(const RspData& data, RspData& output, int32_t& error)
+{
+    const auto lock = this->Lock();
+    this->SendPayload(data);
 
-    // split off errno
-    if (resultErrno.find(',') != std::string::npos) {
-        const auto split = RspConnector::Split(resultErrno, ",");
-        if ((split.size() >= 2) && (split[1] != ""))
-            error = std::stol(split[1].c_str(), nullptr, 16);
+    this->ExpectAck();
+    const auto reply = this->ReceiveRspData();
 
-        return std::stol(split[0].c_str(), nullptr, 16);
-    }
-    return std::stol(resultErrno.c_str(), nullptr, 16);
+    std::string_view attachment;
+    const auto result = ParseHostFileIOReply(reply, attachment, error);
+    if ( !attachment.empty() )
+        output = RspConnector::BinaryDecode(RspData(attachment.data(), attachment.size()));
+    return result;
 }
 
 
-std::string RspConnector::GetXml(const std::string& name)
+std::string RspConnector::ReadXfer(const std::string& object, const std::string& annex)
 {
-    const auto data = this->TransmitAndReceive(RspData(
-            "qXfer:features:read:{}:{:X},{:X}", name, 0, RspData::BUFFER_MAX ));
+    // The reply is binary encoded, so escaping can make it larger than the requested length. The backend then sends
+    // fewer bytes, and the rest is requested from the new offset.
+    const std::size_t chunk_size = std::max(this->m_maxPacketLength - 16, 0x100);
+    const auto lock = this->Lock();
 
-    if ( data.m_data[0] != 'l' &&
-         data.m_data[0] != 'm' )
-        throw std::runtime_error("Failed to retrieve xml data");
+    std::string result{};
+    while ( true )
+    {
+        const auto reply = this->TransmitAndReceive(RspData(
+                "qXfer:{}:read:{}:{:x},{:x}", object, annex, result.size(), chunk_size));
+        const auto size = reply.m_data.GetLength();
+        if ( (size == 0) || ((reply[0] != 'm') && (reply[0] != 'l')) )
+            throw std::runtime_error(fmt::format("failed to read qXfer object {} {}", object, annex));
+
+        // 'm' means there is more data after this chunk, and 'l' means this is the last one
+        const auto chunk = RspConnector::BinaryDecode(RspData((const char*)reply.m_data.GetDataAt(1), size - 1));
+        result.append((const char*)chunk.m_data.GetData(), chunk.m_data.GetLength());
+        if ( (reply[0] == 'l') || (chunk.m_data.GetLength() == 0) )
+            break;
+    }
 
-    auto data_string = data.AsString();
-    data_string.erase(0, 1);
+    return result;
+}
 
-    return data_string;
+std::string RspConnector::GetXml(const std::string& name)
+{
+    return this->ReadXfer("features", name);
 }
 
 
@@ -389,3 +698,66 @@ const uint8_t& RspData::operator[](size_t offset) const
 {
 	return m_data[offset];
 }
+
+
+RspPipeline::RspPipeline(RspConnector& connector): m_connector(connector), m_lock(connector.Lock())
+{
+}
+
+
+RspPipeline::~RspPipeline()
+{
+    try
+    {
+        this->Flush();
+    }
+    catch (const std::exception&)
+    {
+    }
+}
+
+
+void RspPipeline::ReceiveNext()
+{
+    this->m_replies.push_back(this->m_connector.ReceiveRspData());
+    this->m_received++;
+}
+
+
+RspData RspPipeline::Wait(std::size_t index)
+{
+    while ( this->m_received <= index )
+        this->ReceiveNext();
+
+    return std::move(this->m_replies[index]);
+}
+
+
+std::future<RspData> RspPipeline::Queue(const RspData& request)
+{
+    const auto index = this->m_sent;
+    if ( this->m_connector.AcksEnabled() )
+    {
+        this->m_replies.push_back(this->m_connector.TransmitAndReceive(request));
+        this->m_received++;
+    }
+    else
+    {
+        // Keep a window of requests in flight, so neither side's socket buffer fills up
+        while ( this->m_sent - this->m_received >= MAX_REQUESTS_IN_FLIGHT )
+            this->ReceiveNext();
+
+        this->m_connector.SendPayload(request);
+    }
+    this->m_sent++;
+
+    // The reply is only received when the future is waited on
+    return std::async(std::launch::deferred, [this, index]() { return this->Wait(index); });
+}
+
+
+void RspPipeline::Flush()
+{
+    while ( this->m_received < this->m_sent )
+        this->ReceiveNext();
+}
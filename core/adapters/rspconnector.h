@@ -15,12 +15,18 @@ limitations under the License.
 */
 
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <algorithm>
-#include <regex>
 #include <array>
+#include <deque>
+#include <future>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include "binaryninjaapi.h"
 #ifdef WIN32
 #include <windows.h>
@@ -36,7 +42,7 @@ limitations under the License.
 #include <unistd.h>
 #endif
 #include <cstring>
-#include "socket.h"
+#include "transport.h"
 
 namespace BinaryNinjaDebugger
 {
@@ -137,22 +143,119 @@ namespace BinaryNinjaDebugger
 	};
 
 
+	// Splits a packet into the fields between separators without copying, e.g., the "key:value" pairs of a stop reply.
+	// An empty field at the end, e.g., after the last ';' of a stop reply, is not returned.
+	class RspTokenizer
+	{
+		std::string_view m_remaining;
+		char m_separator;
+
+	public:
+		RspTokenizer(std::string_view data, char separator) : m_remaining(data), m_separator(separator) {}
+		bool Next(std::string_view& token);
+
+		static bool ParseHex(std::string_view text, std::uint64_t& value);
+	};
+
+
+	// A stop reply packet, e.g., "T05thread:p1f.1f;06:0000000000000000;07:b0e3ffffff7f0000;swbreak:;". The views point into
+	// the packet, so the packet must outlive the stop reply. Parsing does not allocate.
+	struct RspStopReply
+	{
+		static constexpr std::size_t MAX_EXPEDITED_REGISTERS = 64;
+		static constexpr std::size_t MAX_OTHER_FIELDS = 16;
+
+		// 'T' or 'S' for a stop, 'W' for an exit and 'X' for a termination by a signal
+		char m_type{};
+		// The signal for 'T', 'S' and 'X', and the exit code for 'W'
+		std::uint64_t m_signal{};
+
+		bool m_hasThread{};
+		std::uint64_t m_processId{};
+		std::uint64_t m_threadId{};
+		bool m_hasCore{};
+		std::uint64_t m_core{};
+
+		bool m_swbreak{};
+		bool m_hwbreak{};
+		// "watch", "rwatch" or "awatch", with the address being accessed
+		std::string_view m_watchKind{};
+		std::uint64_t m_watchAddress{};
+
+		bool m_library{};
+		// "fork", "vfork", "vforkdone" or "exec". The value is the new thread for forks and the hex encoded path for exec
+		std::string_view m_event{};
+		std::string_view m_eventValue{};
+
+		// The register numbers and their values as hex bytes in the target byte order
+		std::array<std::pair<std::uint32_t, std::string_view>, MAX_EXPEDITED_REGISTERS> m_registers{};
+		std::size_t m_registerCount{};
+
+		// Everything else, e.g., the metype of debugserver
+		std::array<std::pair<std::string_view, std::string_view>, MAX_OTHER_FIELDS> m_otherFields{};
+		std::size_t m_otherFieldCount{};
+
+		bool Parse(std::string_view packet);
+		bool FindField(std::string_view key, std::string_view& value) const;
+		bool FindHexField(std::string_view key, std::uint64_t& value) const;
+	};
+
+
+	// The traffic with the backend, including the acks. These are read from other threads, hence atomic.
+	struct RspStatistics
+	{
+		std::atomic<std::uint64_t> m_packetsSent{};
+		std::atomic<std::uint64_t> m_packetsReceived{};
+		std::atomic<std::uint64_t> m_bytesSent{};
+		std::atomic<std::uint64_t> m_bytesReceived{};
+	};
+
+
 	class RspConnector
 	{
-		Socket* m_socket{};
+		Transport* m_transport{};
+		// Owned by the adapter, so the counts carry over to the next connection
+		RspStatistics* m_statistics{};
 		bool m_acksEnabled{true};
 		std::vector<std::string> m_serverCapabilities{};
 		int m_maxPacketLength{0xfff};
 
+		// Bytes received from the transport but not consumed yet. A single recv() can return a partial packet, or a
+		// packet followed by (part of) the next one, so the data is kept across calls.
+		std::vector<char> m_receiveBuffer{};
+		// Offset of the first unconsumed byte in m_receiveBuffer
+		std::size_t m_receiveOffset{};
+		// Framer state for the packet currently being received. This allows resuming the scan after more data
+		// arrives, rather than rescanning the whole packet for every chunk.
+		std::size_t m_frameScanOffset{};
+		std::uint8_t m_frameChecksum{};
+		// Whether the packet being received is a notification, i.e., starts with '%' rather than '$'
+		bool m_frameNotification{};
+		// Notifications, e.g., "Stop:T05..." in the non-stop mode, that arrived while waiting for a reply. They are
+		// not acknowledged, and are handed out by ReceiveNotification().
+		std::deque<RspData> m_notifications{};
+		// Held for every transaction, so the packets that another thread sends, e.g., a stop request in the non-stop
+		// mode, do not interleave with the ones of the adapter thread. Shared, since the adapter assigns a new
+		// connector on every connection.
+		std::shared_ptr<std::recursive_mutex> m_mutex{std::make_shared<std::recursive_mutex>()};
+
+		void FillReceiveBuffer();
+		char PeekByte();
+		char ReadByte();
+		bool ExtractPacket(const char*& payload, std::size_t& size, bool& checksumValid, bool& notification);
+
 	public:
 		RspConnector() = default;
-		RspConnector(Socket* socket);
+		RspConnector(Transport* transport, RspStatistics* statistics = nullptr);
 		~RspConnector();
 
 		static RspData BinaryDecode(const RspData& data);
+		// Decode into a caller provided buffer, writing at most capacity bytes. Returns the number of bytes written.
+		static std::size_t BinaryDecode(std::string_view data, char* output, std::size_t capacity);
+		static std::size_t BinaryEncode(const std::uint8_t* data, std::size_t size, std::string& output,
+										std::size_t maxOutputSize = SIZE_MAX);
 		static RspData DecodeRLE(const RspData& data);
-		static std::unordered_map<std::string, std::uint64_t> PacketToUnorderedMap(const RspData& data);
-		static std::vector<std::string> Split(const std::string& string, const std::string& regex);
+		static std::vector<std::string> Split(const std::string& string, const std::string& separator);
 
 		static uint64_t SwapEndianness(uint64_t value, size_t len)
 		{
@@ -182,22 +285,71 @@ namespace BinaryNinjaDebugger
 		}
 
 
+		// Hold the connector across several transactions that must not be interleaved with others. ReceiveRspData()
+		// and ExpectAck() do not lock on their own, so the all-stop mode can wait for a stop while a break is sent.
+		std::unique_lock<std::recursive_mutex> Lock() const { return std::unique_lock<std::recursive_mutex>(*m_mutex); }
+
 		void EnableAcks();
 		void DisableAcks();
+		bool AcksEnabled() const { return m_acksEnabled; }
 
 		char ExpectAck();
 		void SendAck() const;
 
 		void NegotiateCapabilities(const std::vector<std::string>& capabilities);
+		bool HasCapability(const std::string& capability) const;
+		int GetMaxPacketLength() const { return m_maxPacketLength; }
 
 		void SendRaw(const RspData& data) const;
 		void SendPayload(const RspData& data) const;
 
-		RspData ReceiveRspData() const;
+		RspData ReceiveRspData();
+		// Take a notification that was received earlier, or wait up to timeout milliseconds for one to arrive
+		bool ReceiveNotification(RspData& notification, std::int32_t timeout = 0);
 		RspData TransmitAndReceive(const RspData& data, const std::string& expect = "ack_then_reply",
 								   std::function<void(const RspData& data)> asyncPacketHandler = nullptr);
+		// Send a list of requests and return the replies in the same order. When acks are disabled, several requests
+		// are kept in flight at once, so the batch costs roughly one round trip rather than one per request.
+		std::vector<RspData> TransmitAndReceiveBatch(const std::vector<RspData>& requests);
 		int32_t HostFileIO(const RspData& data, RspData& output, int32_t& error);
+		// Parse a host I/O reply, "F result[,errno][;attachment]". The attachment is left binary encoded, and points
+		// into the reply.
+		static int32_t ParseHostFileIOReply(const RspData& reply, std::string_view& attachment, int32_t& error);
 
+		// Read a whole qXfer object, e.g., features/target.xml, in chunks that fit in a packet
+		std::string ReadXfer(const std::string& object, const std::string& annex);
 		std::string GetXml(const std::string& name);
+		// The features from the qSupported reply, e.g., to tell different servers apart
+		const std::vector<std::string>& GetServerCapabilities() const { return m_serverCapabilities; }
+	};
+
+
+	// Sends requests back to back without waiting for the replies in between, and hands out the replies as futures.
+	// The backend answers the requests in order, so the replies are matched to the requests by their position.
+	// Getting a future receives the replies up to (and including) its own, so the pipeline must outlive the futures.
+	// When acks are enabled, every packet must be acknowledged before the next one is sent, so the requests are
+	// sent one by one.
+	class RspPipeline
+	{
+		RspConnector& m_connector;
+		// The replies must be received before anything else is sent, so the connector is held for the whole pipeline
+		std::unique_lock<std::recursive_mutex> m_lock;
+		// The number of requests kept in flight before waiting for a reply
+		static constexpr std::size_t MAX_REQUESTS_IN_FLIGHT = 16;
+
+		std::size_t m_sent{};
+		std::size_t m_received{};
+		std::vector<RspData> m_replies{};
+
+		void ReceiveNext();
+		RspData Wait(std::size_t index);
+
+	public:
+		RspPipeline(RspConnector& connector);
+		// Receives the outstanding replies, so the connector is in sync for the next request
+		~RspPipeline();
+
+		std::future<RspData> Queue(const RspData& request);
+		void Flush();
 	};
 };
@@ -0,0 +1,284 @@
+/*
+Copyright 2020-2022 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "transport.h"
+#include <cstring>
+#include <thread>
+#ifndef WIN32
+#include <netinet/tcp.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <spawn.h>
+#include <csignal>
+#endif
+
+using namespace BinaryNinjaDebugger;
+
+#ifndef WIN32
+extern char** environ;
+#endif
+
+
+SocketTransport::~SocketTransport()
+{
+    Close();
+}
+
+
+void SocketTransport::Close()
+{
+    if (m_socket == INVALID)
+        return;
+#ifdef WIN32
+    ::closesocket(m_socket);
+#else
+    ::close(m_socket);
+#endif
+    m_socket = INVALID;
+}
+
+
+void SocketTransport::DisableSigPipe() const
+{
+#ifdef __APPLE__
+    int on = 1;
+    ::setsockopt(m_socket, SOL_SOCKET, SO_NOSIGPIPE, (const char*)&on, sizeof(on));
+#endif
+}
+
+
+bool SocketTransport::WaitForData(std::int32_t timeout) const
+{
+#ifdef WIN32
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(m_socket, &readSet);
+    timeval tv{timeout / 1000, (timeout % 1000) * 1000};
+    return ::select(0, &readSet, nullptr, nullptr, timeout < 0 ? nullptr : &tv) > 0;
+#else
+    pollfd fd{m_socket, POLLIN, 0};
+    while (true)
+    {
+        int ret = ::poll(&fd, 1, timeout);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        // A hang up or error is reported as readable, so the following recv() can observe it
+        return ret > 0;
+    }
+#endif
+}
+
+
+intptr_t SocketTransport::Recv(char* data, std::int32_t size) const
+{
+    return ::recv(m_socket, data, size, 0);
+}
+
+
+intptr_t SocketTransport::Send(const char* data, std::int32_t size) const
+{
+#if defined(WIN32) || defined(__APPLE__)
+    const int flags = 0;
+#else
+    const int flags = MSG_NOSIGNAL;
+#endif
+    // A stream socket can take only part of the data
+    std::int32_t sent = 0;
+    while (sent < size)
+    {
+        const auto n = ::send(m_socket, data + sent, size - sent, flags);
+        if (n < 0)
+        {
+#ifndef WIN32
+            if (errno == EINTR)
+                continue;
+#endif
+            return n;
+        }
+        sent += static_cast<std::int32_t>(n);
+    }
+    return sent;
+}
+
+
+bool SocketTransport::Kill()
+{
+    if (m_socket == INVALID)
+        return false;
+#ifdef WIN32
+    const bool ret = ::shutdown(m_socket, 2) >= 0;
+#else
+    const bool ret = ::shutdown(m_socket, SHUT_RDWR) >= 0;
+#endif
+    Close();
+    return ret;
+}
+
+
+bool TcpTransport::Connect(const std::string& host, std::uint32_t port)
+{
+    Close();
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = ::inet_addr(host.c_str());
+    if (address.sin_addr.s_addr == INADDR_NONE)
+    {
+        // Not a dotted address, e.g., "localhost"
+        const hostent* entry = ::gethostbyname(host.c_str());
+        if (!entry || entry->h_addrtype != AF_INET || !entry->h_addr_list[0])
+            return false;
+        std::memcpy(&address.sin_addr, entry->h_addr_list[0], sizeof(address.sin_addr));
+    }
+
+    m_socket = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (m_socket == INVALID)
+        return false;
+
+    int on = 1;
+    ::setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+    ::setsockopt(m_socket, SOL_SOCKET, SO_KEEPALIVE, (const char*)&on, sizeof(on));
+    DisableSigPipe();
+
+    if (::connect(m_socket, (const sockaddr*)&address, sizeof(address)) < 0)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+
+std::uint32_t TcpTransport::FindFreePort()
+{
+    // Binding to port 0 lets the system pick a free port. There is still a window between closing the socket here and
+    // the backend binding the port, but no other process probes the same range of ports.
+    const auto sock = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == INVALID)
+        return 0;
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = ::inet_addr("127.0.0.1");
+    address.sin_port = 0;
+
+    std::uint32_t port = 0;
+    if (::bind(sock, (const sockaddr*)&address, sizeof(address)) >= 0)
+    {
+#ifdef WIN32
+        int length = sizeof(address);
+#else
+        socklen_t length = sizeof(address);
+#endif
+        if (::getsockname(sock, (sockaddr*)&address, &length) >= 0)
+            port = ntohs(address.sin_port);
+    }
+
+#ifdef WIN32
+    ::closesocket(sock);
+#else
+    ::close(sock);
+#endif
+    return port;
+}
+
+
+#ifndef WIN32
+bool UnixSocketTransport::Connect(const std::string& path)
+{
+    Close();
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path))
+        return false;
+    std::memcpy(address.sun_path, path.data(), path.size());
+
+    m_socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_socket == INVALID)
+        return false;
+    DisableSigPipe();
+
+    if (::connect(m_socket, (const sockaddr*)&address, sizeof(address)) < 0)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+
+StdioTransport::~StdioTransport()
+{
+    StdioTransport::Kill();
+}
+
+
+bool StdioTransport::Launch(const std::string& path, const std::vector<std::string>& args)
+{
+    Close();
+
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return false;
+
+    // Our end must not leak into the backend, or it never sees the connection close
+    ::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[1]);
+
+    std::vector<char*> argv;
+    argv.push_back((char*)path.c_str());
+    for (const auto& arg: args)
+        argv.push_back((char*)arg.c_str());
+    argv.push_back(nullptr);
+
+    pid_t pid;
+    const int ret = posix_spawn(&pid, path.c_str(), &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    ::close(fds[1]);
+
+    if (ret != 0)
+    {
+        ::close(fds[0]);
+        return false;
+    }
+
+    m_socket = fds[0];
+    m_pid = pid;
+    DisableSigPipe();
+    return true;
+}
+
+
+bool StdioTransport::Kill()
+{
+    const bool ret = SocketTransport::Kill();
+    if (m_pid)
+    {
+        // The backend exits once the connection is closed. Reap it, so it does not linger as a zombie.
+        const pid_t pid = m_pid;
+        std::thread([pid]() { ::waitpid(pid, nullptr, 0); }).detach();
+        m_pid = 0;
+    }
+    return ret;
+}
+#endif
@@ -0,0 +1,126 @@
+/*
+Copyright 2020-2022 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+#ifdef WIN32
+#include <windows.h>
+#include <winsock.h>
+#else
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/time.h>
+#include <sys/fcntl.h>
+#include <poll.h>
+#include <cerrno>
+#endif
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace BinaryNinjaDebugger
+{
+	// The byte stream that the RSP packets go over. It is a TCP connection to a remote backend, and a Unix domain
+	// socket or the stdin/stdout of the backend process for the local ones.
+	class Transport
+	{
+	public:
+		virtual ~Transport() = default;
+
+		// Block until there is data to read, or the timeout (in milliseconds) expires. A negative timeout waits
+		// forever. Returns false on timeout or error.
+		virtual bool WaitForData(std::int32_t timeout = -1) const = 0;
+		virtual intptr_t Recv(char* data, std::int32_t size) const = 0;
+		virtual intptr_t Send(const char* data, std::int32_t size) const = 0;
+		// Shut down the connection. The pending and later calls fail.
+		virtual bool Kill() = 0;
+	};
+
+
+	// All three transports end up as a connected stream socket
+	class SocketTransport : public Transport
+	{
+	public:
+		using socket_type =
+	#ifdef WIN32
+			SOCKET;
+		static constexpr socket_type INVALID = INVALID_SOCKET;
+	#else
+			std::int32_t;
+		static constexpr socket_type INVALID = -1;
+	#endif
+
+	protected:
+		socket_type m_socket{INVALID};
+
+		void Close();
+		// Writing to a closed connection must fail with EPIPE, rather than raise SIGPIPE which ends the process
+		void DisableSigPipe() const;
+
+	public:
+		SocketTransport() = default;
+		SocketTransport(const SocketTransport&) = delete;
+		SocketTransport& operator=(const SocketTransport&) = delete;
+		~SocketTransport() override;
+
+		bool IsConnected() const { return m_socket != INVALID; }
+
+		bool WaitForData(std::int32_t timeout = -1) const override;
+		intptr_t Recv(char* data, std::int32_t size) const override;
+		intptr_t Send(const char* data, std::int32_t size) const override;
+		bool Kill() override;
+	};
+
+
+	class TcpTransport : public SocketTransport
+	{
+	public:
+		// Nagle's algorithm is turned off, since the RSP packets are small and each one waits for a reply. Keepalive
+		// notices a backend that is gone while the target runs for a long time.
+		bool Connect(const std::string& host, std::uint32_t port);
+
+		// A port on the loopback interface that is free at the moment, picked by the system. This is only needed for
+		// the backends that cannot use the other transports, e.g., debugserver.
+		static std::uint32_t FindFreePort();
+	};
+
+
+#ifndef WIN32
+	class UnixSocketTransport : public SocketTransport
+	{
+	public:
+		bool Connect(const std::string& path);
+	};
+
+
+	// Talks to a backend started with its stdin and stdout as the connection, e.g., "gdbserver - /bin/ls". The backend
+	// gets one end of a socket pair for both of them, so no port or file is involved.
+	class StdioTransport : public SocketTransport
+	{
+		pid_t m_pid{};
+
+	public:
+		~StdioTransport() override;
+
+		bool Launch(const std::string& path, const std::vector<std::string>& args);
+		pid_t GetProcessId() const { return m_pid; }
+		bool Kill() override;
+	};
+#endif
+};
@@ -97,6 +97,24 @@ DebugStopReason DebugAdapter::StepReturn()
 }
 
 
+DebugStopReason DebugAdapter::StepRange(std::uintptr_t start, std::uintptr_t end)
+{
+	return OperationNotSupported;
+}
+
+
+bool DebugAdapter::ResumeThread(std::uint32_t tid)
+{
+	return false;
+}
+
+
+bool DebugAdapter::StopThread(std::uint32_t tid)
+{
+	return false;
+}
+
+
 uint64_t DebugAdapter::GetStackPointer()
 {
 	return 0;
@@ -115,6 +133,43 @@ std::vector<DebugFrame> DebugAdapter::GetFramesOfThread(std::uint32_t tid)
 }
 
 
+std::vector<DebugBreakpoint> DebugAdapter::AddBreakpoints(const std::vector<std::uintptr_t>& addresses)
+{
+	std::vector<DebugBreakpoint> result;
+	for (const auto address: addresses)
+	{
+		const auto breakpoint = AddBreakpoint(address);
+		if (!breakpoint)
+			continue;
+		result.push_back(breakpoint);
+	}
+	return result;
+}
+
+
+std::vector<DebugBreakpoint> DebugAdapter::AddBreakpoints(const std::vector<ModuleNameAndOffset>& addresses)
+{
+	std::vector<DebugBreakpoint> result;
+	for (const auto& address: addresses)
+	{
+		const auto breakpoint = AddBreakpoint(address);
+		if (!breakpoint)
+			continue;
+		result.push_back(breakpoint);
+	}
+	return result;
+}
+
+
+bool DebugAdapter::RemoveBreakpoints(const std::vector<DebugBreakpoint>& breakpoints)
+{
+	bool result = true;
+	for (const auto& breakpoint: breakpoints)
+		result = RemoveBreakpoint(breakpoint) && result;
+	return result;
+}
+
+
 bool DebugAdapter::ConnectToDebugServer(const std::string &server, std::uint32_t port)
 {
     return false;
@@ -55,6 +55,7 @@ namespace BinaryNinjaDebugger
 		DebugAdapterSupportStepOver,
 		DebugAdapterSupportModules,
 		DebugAdapterSupportThreads,
+		DebugAdapterSupportRangeStepping,
 	};
 
 
@@ -110,6 +111,23 @@ namespace BinaryNinjaDebugger
 		}
 	};
 
+	typedef BNDebugWatchpointType DebugWatchpointType;
+
+	// A hardware watchpoint stops the target when the data at m_address is accessed. The backends usually limit the
+	// size to 1, 2, 4 or 8 bytes, aligned to the size.
+	struct DebugWatchpoint
+	{
+		std::uintptr_t m_address{};
+		std::size_t m_size{};
+		DebugWatchpointType m_type{};
+		unsigned long m_id{};
+
+		DebugWatchpoint() = default;
+
+		DebugWatchpoint(std::uintptr_t address, std::size_t size, DebugWatchpointType type, unsigned long id = 0) :
+				m_address(address), m_size(size), m_type(type), m_id(id) {}
+	};
+
 	struct DebugRegister
 	{
 		std::string m_name{};
@@ -165,6 +183,45 @@ namespace BinaryNinjaDebugger
 		{}
 	};
 
+	typedef BNDebugTraceStopReason DebugTraceStopReason;
+
+	// A tracepoint records data each time it is hit, while the target keeps running, and the records are read back
+	// once the trace stops
+	struct DebugTracepoint
+	{
+		std::uint32_t m_id{};
+		std::uintptr_t m_address{};
+		bool m_collectAllRegisters{};
+		std::vector<std::string> m_registers{};
+		// Address and size
+		std::vector<std::pair<std::uintptr_t, std::size_t>> m_memory{};
+		// Expressions in the breakpoint condition syntax, and the memory they read is collected, e.g., u64[rsp + 8]
+		std::vector<std::string> m_expressions{};
+		// Only collect when the condition is true
+		std::string m_condition{};
+		// Stop the trace after this many hits, 0 for no limit
+		std::uint64_t m_passCount{};
+	};
+
+	// The data collected by one hit of a tracepoint
+	struct DebugTraceFrame
+	{
+		std::uint32_t m_index{};
+		std::uint32_t m_tracepoint{};
+		std::unordered_map<std::string, std::uintptr_t> m_registers{};
+		std::vector<std::pair<std::uintptr_t, DataBuffer>> m_memory{};
+	};
+
+	struct DebugTraceStatus
+	{
+		bool m_supported{};
+		bool m_running{};
+		DebugTraceStopReason m_stopReason{};
+		std::uint64_t m_frames{};
+		std::uint64_t m_bufferSize{};
+		std::uint64_t m_bufferFree{};
+	};
+
 	class DebugAdapter
 	{
 		IMPLEMENT_DEBUGGER_API_OBJECT(BNDebugAdapter);
@@ -233,8 +290,68 @@ namespace BinaryNinjaDebugger
             return false;
         }
 
+		// Add or remove many breakpoints at once, e.g., when the saved breakpoints are applied at launch. The adapters
+		// that can send the requests back to back override these, and the defaults handle them one by one.
+		virtual std::vector<DebugBreakpoint> AddBreakpoints(const std::vector<std::uintptr_t>& addresses);
+
+		virtual std::vector<DebugBreakpoint> AddBreakpoints(const std::vector<ModuleNameAndOffset>& addresses);
+
+		virtual bool RemoveBreakpoints(const std::vector<DebugBreakpoint>& breakpoints);
+
+		// Only stop at the breakpoint when the condition is true, e.g., "rdi == 0x10 && $hits > 3". An empty condition
+		// removes it. Returns false if the adapter does not support conditions or the condition is not valid.
+		virtual bool SetBreakpointCondition(std::uintptr_t address, const std::string& condition)
+		{
+			return false;
+		}
+
 		virtual std::vector<DebugBreakpoint> GetBreakpointList() const = 0;
 
+		// There is at most one watchpoint at an address. Returns false if the adapter does not support watchpoints, or
+		// the backend runs out of the debug registers.
+		virtual bool AddWatchpoint(std::uintptr_t address, std::size_t size, DebugWatchpointType type)
+		{
+			return false;
+		}
+
+		virtual bool RemoveWatchpoint(std::uintptr_t address)
+		{
+			return false;
+		}
+
+		virtual std::vector<DebugWatchpoint> GetWatchpointList() const
+		{
+			return {};
+		}
+
+		// The data address of the last Watchpoint stop
+		virtual std::uintptr_t GetStopDataAddress()
+		{
+			return 0;
+		}
+
+		// The tracepoints are sent to the backend when the trace starts, and replace the ones of the previous trace,
+		// whose frames are discarded. The frames are read while the target is stopped.
+		virtual bool StartTrace(const std::vector<DebugTracepoint>& tracepoints)
+		{
+			return false;
+		}
+
+		virtual bool StopTrace()
+		{
+			return false;
+		}
+
+		virtual DebugTraceStatus GetTraceStatus()
+		{
+			return {};
+		}
+
+		virtual std::vector<DebugTraceFrame> GetTraceFrames()
+		{
+			return {};
+		}
+
 		virtual std::unordered_map<std::string, DebugRegister> ReadAllRegisters() = 0;
 
 		virtual DebugRegister ReadRegister(const std::string &reg) = 0;
@@ -255,6 +372,12 @@ namespace BinaryNinjaDebugger
 
 		virtual bool BreakInto() = 0;
 
+		// Resume or stop a single thread while the others keep running or stay stopped. Only the adapters that run the
+		// target in the non-stop mode support these.
+		virtual bool ResumeThread(std::uint32_t tid);
+
+		virtual bool StopThread(std::uint32_t tid);
+
 		virtual DebugStopReason Go() = 0;
 
 		virtual DebugStopReason StepInto() = 0;
@@ -264,6 +387,10 @@ namespace BinaryNinjaDebugger
 
 		virtual DebugStopReason StepReturn();
 
+		// Step the active thread until the IP leaves [start, end). Only the stop out of the range, or a stop for another
+		// reason, is reported.
+		virtual DebugStopReason StepRange(std::uintptr_t start, std::uintptr_t end);
+
 		virtual std::string InvokeBackendCommand(const std::string &command) = 0;
 
 		virtual std::uintptr_t GetInstructionOffset() = 0;
@@ -70,6 +70,46 @@ static void RegisterSettings()
 			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
 			})");
 
+	settings->RegisterSetting("debugger.memoryCacheBlockSize",
+			R"({
+			"title" : "Memory Cache Block Size",
+			"type" : "number",
+			"default" : 4096,
+			"minValue" : 256,
+			"maxValue" : 1048576,
+			"description" : "The target memory is read and cached in aligned blocks of this many bytes. It is rounded down to a power of two.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
+	settings->RegisterSetting("debugger.memoryCacheSize",
+			R"({
+			"title" : "Memory Cache Size (MiB)",
+			"type" : "number",
+			"default" : 64,
+			"minValue" : 1,
+			"maxValue" : 4096,
+			"description" : "The most target memory the debugger caches. The least recently used blocks are evicted beyond this size. The cache is emptied every time the target stops.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
+	settings->RegisterSetting("debugger.verifyMemoryWrites",
+			R"({
+			"title" : "Verify Memory Writes",
+			"type" : "boolean",
+			"default" : false,
+			"description" : "Read the memory back after every write, and fail the write if the target does not hold the written bytes. This costs one more round trip to the backend per write.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
+	settings->RegisterSetting("debugger.gdbServerStdio",
+			R"({
+			"title" : "Talk To gdbserver Over Its Standard Streams",
+			"type" : "boolean",
+			"default" : false,
+			"description" : "Launch gdbserver with its stdin and stdout as the connection, rather than on a loopback TCP port. The target then cannot read from the terminal, and its output goes to the stderr of gdbserver.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
 #ifdef WIN32
     settings->RegisterSetting("debugger.x64dbgEngPath",
   R"({
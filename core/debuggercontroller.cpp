@@ -55,6 +55,19 @@ void DebuggerController::AddBreakpoint(uint64_t address)
 }
 
 
+void DebuggerController::AddBreakpoints(const std::vector<uint64_t>& addresses)
+{
+    m_state->AddBreakpoints(addresses);
+    for (uint64_t address: addresses)
+    {
+        DebuggerEvent event;
+        event.type = AbsoluteBreakpointAddedEvent;
+        event.data.absoluteAddress = address;
+        PostDebuggerEvent(event);
+    }
+}
+
+
 void DebuggerController::AddBreakpoint(const ModuleNameAndOffset& address)
 {
     m_state->AddBreakpoint(address);
@@ -75,6 +88,19 @@ void DebuggerController::DeleteBreakpoint(uint64_t address)
 }
 
 
+void DebuggerController::DeleteBreakpoints(const std::vector<uint64_t>& addresses)
+{
+    m_state->DeleteBreakpoints(addresses);
+    for (uint64_t address: addresses)
+    {
+        DebuggerEvent event;
+        event.type = AbsoluteBreakpointRemovedEvent;
+        event.data.absoluteAddress = address;
+        PostDebuggerEvent(event);
+    }
+}
+
+
 void DebuggerController::DeleteBreakpoint(const ModuleNameAndOffset& address)
 {
     m_state->DeleteBreakpoint(address);
@@ -85,6 +111,111 @@ void DebuggerController::DeleteBreakpoint(const ModuleNameAndOffset& address)
 }
 
 
+bool DebuggerController::SetBreakpointCondition(uint64_t address, const std::string& condition)
+{
+    return m_state->SetBreakpointCondition(address, condition);
+}
+
+
+bool DebuggerController::SetBreakpointCondition(const ModuleNameAndOffset& address, const std::string& condition)
+{
+    return m_state->SetBreakpointCondition(address, condition);
+}
+
+
+bool DebuggerController::AddWatchpoint(uint64_t address, size_t size, DebugWatchpointType type)
+{
+    if (!m_adapter || !m_state->IsConnected())
+        return false;
+
+    return m_adapter->AddWatchpoint(address, size, type);
+}
+
+
+bool DebuggerController::RemoveWatchpoint(uint64_t address)
+{
+    if (!m_adapter || !m_state->IsConnected())
+        return false;
+
+    return m_adapter->RemoveWatchpoint(address);
+}
+
+
+std::vector<DebugWatchpoint> DebuggerController::GetWatchpoints()
+{
+    if (!m_adapter || !m_state->IsConnected())
+        return {};
+
+    return m_adapter->GetWatchpointList();
+}
+
+
+uint64_t DebuggerController::GetStopDataAddress()
+{
+    if (!m_adapter || !m_state->IsConnected())
+        return 0;
+
+    return m_adapter->GetStopDataAddress();
+}
+
+
+uint32_t DebuggerController::AddTracepoint(const DebugTracepoint& tracepoint)
+{
+    DebugTracepoint newTracepoint = tracepoint;
+    newTracepoint.m_id = m_nextTracepointId++;
+    m_tracepoints.push_back(newTracepoint);
+    return newTracepoint.m_id;
+}
+
+
+bool DebuggerController::RemoveTracepoint(uint32_t id)
+{
+    auto iter = std::find_if(m_tracepoints.begin(), m_tracepoints.end(),
+                             [id](const DebugTracepoint& tracepoint) { return tracepoint.m_id == id; });
+    if (iter == m_tracepoints.end())
+        return false;
+
+    m_tracepoints.erase(iter);
+    return true;
+}
+
+
+bool DebuggerController::StartTrace()
+{
+    if (!m_adapter || !m_state->IsConnected() || m_tracepoints.empty())
+        return false;
+
+    return m_adapter->StartTrace(m_tracepoints);
+}
+
+
+bool DebuggerController::StopTrace()
+{
+    if (!m_adapter || !m_state->IsConnected())
+        return false;
+
+    return m_adapter->StopTrace();
+}
+
+
+DebugTraceStatus DebuggerController::GetTraceStatus()
+{
+    if (!m_adapter || !m_state->IsConnected())
+        return {};
+
+    return m_adapter->GetTraceStatus();
+}
+
+
+std::vector<DebugTraceFrame> DebuggerController::GetTraceFrames()
+{
+    if (!m_adapter || !m_state->IsConnected())
+        return {};
+
+    return m_adapter->GetTraceFrames();
+}
+
+
 bool DebuggerController::Launch()
 {
 	DebuggerEvent event;
@@ -237,6 +368,106 @@ void DebuggerController::StepIntoInternal()
 }
 
 
+// The end of the range that the target can step through in one request from the IP, i.e., the next address where an
+// instruction of the IL starts, within the basic block. When stepping over, the range also ends before the next call,
+// which is stepped over by itself. Returns 0 if there is no such range, e.g., the IP is at a call.
+uint64_t DebuggerController::GetILStepRangeEnd(uint64_t ip, BNFunctionGraphType il, bool stepOver)
+{
+	std::vector<FunctionRef> functions = m_liveView->GetAnalysisFunctionsContainingAddress(ip);
+	if (functions.empty())
+		return 0;
+
+	uint64_t end = UINT64_MAX;
+	for (FunctionRef& func: functions)
+	{
+		Ref<BasicBlock> block = func->GetBasicBlockAtAddress(func->GetArchitecture(), ip);
+		if (!block)
+			return 0;
+		end = std::min(end, block->GetEnd());
+
+		std::vector<uint64_t> addresses;
+		switch (il)
+		{
+		case LowLevelILFunctionGraph:
+		{
+			LowLevelILFunctionRef llil = func->GetLowLevelIL();
+			for (size_t i = 0; llil && (i < llil->GetInstructionCount()); i++)
+				addresses.push_back(llil->GetInstruction(i).address);
+			break;
+		}
+		case MediumLevelILFunctionGraph:
+		{
+			MediumLevelILFunctionRef mlil = func->GetMediumLevelIL();
+			for (size_t i = 0; mlil && (i < mlil->GetInstructionCount()); i++)
+				addresses.push_back(mlil->GetInstruction(i).address);
+			break;
+		}
+		case HighLevelILFunctionGraph:
+		case HighLevelLanguageRepresentationFunctionGraph:
+		{
+			HighLevelILFunctionRef hlil = func->GetHighLevelIL();
+			for (size_t i = 0; hlil && (i < hlil->GetInstructionCount()); i++)
+				addresses.push_back(hlil->GetInstruction(i).address);
+			break;
+		}
+		default:
+			return 0;
+		}
+
+		for (uint64_t address: addresses)
+		{
+			if ((address > ip) && (address < end))
+				end = address;
+		}
+
+		if (stepOver)
+		{
+			LowLevelILFunctionRef llil = func->GetLowLevelIL();
+			for (size_t i = 0; llil && (i < llil->GetInstructionCount()); i++)
+			{
+				const auto instr = llil->GetInstruction(i);
+				if ((instr.operation != LLIL_CALL) && (instr.operation != LLIL_CALL_STACK_ADJUST))
+					continue;
+				if (instr.address == ip)
+					return 0;
+				if ((instr.address > ip) && (instr.address < end))
+					end = instr.address;
+			}
+		}
+	}
+
+	return (end == UINT64_MAX) ? 0 : end;
+}
+
+
+// Step the target once for the IL stepping loops. When the adapter supports it, the target steps through the range of
+// the current IL instruction in one request, rather than stopping at every instruction in it.
+DebugStopReason DebuggerController::StepILInternal(BNFunctionGraphType il, bool stepOver)
+{
+	if (m_adapter->SupportFeature(DebugAdapterSupportRangeStepping))
+	{
+		uint64_t ip = m_state->IP();
+		uint64_t end = GetILStepRangeEnd(ip, il, stepOver);
+		if (end > ip)
+		{
+			DebugStopReason reason = m_adapter->StepRange(ip, end);
+			if (reason != OperationNotSupported)
+			{
+				// The adapter steps without posting a resume event, which is what marks the state dirty otherwise
+				m_state->MarkDirty();
+				return reason;
+			}
+		}
+	}
+
+	if (stepOver)
+		StepOverInternal();
+	else
+		StepIntoInternal();
+	return WaitForAdapterStop();
+}
+
+
 void DebuggerController::StepIntoIL(BNFunctionGraphType il)
 {
 	switch (il)
@@ -252,12 +483,12 @@ void DebuggerController::StepIntoIL(BNFunctionGraphType il)
 		// TODO: This might cause infinite loop
 		while (true)
 		{
-			StepIntoInternal();
-			DebugStopReason reason = WaitForAdapterStop();
+			DebugStopReason reason = StepILInternal(il, false);
 			if (!ExpectSingleStep(reason))
 			{
 				m_treatAdapterStopAsTargetStop = true;
 				NotifyStopped(reason);
+				return;
 			}
 
 			uint64_t newRemoteRip = m_state->IP();
@@ -288,12 +519,12 @@ void DebuggerController::StepIntoIL(BNFunctionGraphType il)
 		// TODO: This might cause infinite loop
 		while (true)
 		{
-			StepIntoInternal();
-			DebugStopReason reason = WaitForAdapterStop();
+			DebugStopReason reason = StepILInternal(il, false);
 			if (!ExpectSingleStep(reason))
 			{
 				m_treatAdapterStopAsTargetStop = true;
 				NotifyStopped(reason);
+				return;
 			}
 
 			uint64_t newRemoteRip = m_state->IP();
@@ -325,12 +556,12 @@ void DebuggerController::StepIntoIL(BNFunctionGraphType il)
 		// TODO: This might cause infinite loop
 		while (true)
 		{
-			StepIntoInternal();
-			DebugStopReason reason = WaitForAdapterStop();
+			DebugStopReason reason = StepILInternal(il, false);
 			if (!ExpectSingleStep(reason))
 			{
 				m_treatAdapterStopAsTargetStop = true;
 				NotifyStopped(reason);
+				return;
 			}
 
 			uint64_t newRemoteRip = m_state->IP();
@@ -440,12 +671,12 @@ void DebuggerController::StepOverIL(BNFunctionGraphType il)
         // TODO: This might cause infinite loop
         while (true)
         {
-			StepOverInternal();
-			DebugStopReason reason = WaitForAdapterStop();
+			DebugStopReason reason = StepILInternal(il, true);
 			if (!ExpectSingleStep(reason))
 			{
 				m_treatAdapterStopAsTargetStop = true;
 				NotifyStopped(reason);
+				return;
 			}
 
             uint64_t newRemoteRip = m_state->IP();
@@ -476,12 +707,12 @@ void DebuggerController::StepOverIL(BNFunctionGraphType il)
         // TODO: This might cause infinite loop
         while (true)
         {
-			StepOverInternal();
-			DebugStopReason reason = WaitForAdapterStop();
+			DebugStopReason reason = StepILInternal(il, true);
 			if (!ExpectSingleStep(reason))
 			{
 				m_treatAdapterStopAsTargetStop = true;
 				NotifyStopped(reason);
+				return;
 			}
 
             uint64_t newRemoteRip = m_state->IP();
@@ -513,12 +744,12 @@ void DebuggerController::StepOverIL(BNFunctionGraphType il)
         // TODO: This might cause infinite loop
         while (true)
         {
-			StepOverInternal();
-			DebugStopReason reason = WaitForAdapterStop();
+			DebugStopReason reason = StepILInternal(il, true);
 			if (!ExpectSingleStep(reason))
 			{
 				m_treatAdapterStopAsTargetStop = true;
 				NotifyStopped(reason);
+				return;
 			}
 
             uint64_t newRemoteRip = m_state->IP();
@@ -722,6 +953,41 @@ void DebuggerController::SetActiveThread(const DebugThread &thread)
 }
 
 
+bool DebuggerController::ResumeThread(uint32_t tid)
+{
+	if (!m_adapter || !m_state->IsConnected())
+		return false;
+
+	if (m_state->IsRunning())
+		return m_adapter->ResumeThread(tid);
+
+	// The active thread is resumed with Go(), which waits for its stop and updates the state
+	if (tid == m_adapter->GetActiveThreadId())
+		return false;
+
+	if (!m_adapter->ResumeThread(tid))
+		return false;
+
+	m_state->GetThreads()->MarkDirty();
+	return true;
+}
+
+
+bool DebuggerController::StopThread(uint32_t tid)
+{
+	if (!m_adapter || !m_state->IsConnected())
+		return false;
+
+	// The adapter does not wait for the stop, so this does not block while Go() waits for the target
+	if (!m_adapter->StopThread(tid))
+		return false;
+
+	if (!m_state->IsRunning())
+		m_state->GetThreads()->MarkDirty();
+	return true;
+}
+
+
 std::vector<DebugFrame> DebuggerController::GetFramesOfThread(uint64_t tid)
 {
 	return m_state->GetThreads()->GetFramesOfThread(tid);
@@ -1071,6 +1337,9 @@ void DebuggerController::NotifyStopped(DebugStopReason reason, void *data)
     DebuggerEvent event;
     event.type = TargetStoppedEventType;
     event.data.targetStoppedData.reason = reason;
+    event.data.targetStoppedData.dataAddress = 0;
+    if ((reason == Watchpoint) && m_adapter)
+        event.data.targetStoppedData.dataAddress = m_adapter->GetStopDataAddress();
     event.data.targetStoppedData.data = data;
     PostDebuggerEvent(event);
 }
@@ -1479,6 +1748,8 @@ std::string DebuggerController::GetStopReasonString(DebugStopReason reason)
 		return "UserRequestedBreak";
 	case OperationNotSupported:
 		return "OperationNotSupported";
+	case Watchpoint:
+		return "Watchpoint";
 	default:
 		return "";
 	}
@@ -1553,6 +1824,22 @@ Ref<Metadata> DebuggerController::GetAdapterProperty(const std::string& name)
 			return nullptr;
 	}
 
+	// The adapter only knows about the calls that reach it, the caches in front of it are added here
+	if (name == "stats")
+	{
+		std::map<std::string, Ref<Metadata>> stats;
+		if (auto adapterStats = m_adapter->GetProperty(name); adapterStats && adapterStats->IsKeyValueStore())
+			stats = adapterStats->GetKeyValueStore();
+
+		std::map<std::string, Ref<Metadata>> cache;
+		cache["memory_hits"] = new Metadata(m_state->GetMemory()->GetCacheHits());
+		cache["memory_misses"] = new Metadata(m_state->GetMemory()->GetCacheMisses());
+		cache["register_hits"] = new Metadata(m_state->GetRegisters()->GetCacheHits());
+		cache["register_misses"] = new Metadata(m_state->GetRegisters()->GetCacheMisses());
+		stats["cache"] = new Metadata(cache);
+		return new Metadata(stats);
+	}
+
     return m_adapter->GetProperty(name);
 }
 
@@ -90,6 +90,10 @@ namespace BinaryNinjaDebugger
 		// and call a NotifyStopped when the sequence of operation is done.
 		bool m_treatAdapterStopAsTargetStop = true;
 
+		// The tracepoints are sent to the adapter when the trace starts
+		std::vector<DebugTracepoint> m_tracepoints;
+		uint32_t m_nextTracepointId = 1;
+
 		void EventHandler(const DebuggerEvent &event);
 		void UpdateStackVariables();
 		bool CreateDebugAdapter();
@@ -108,6 +112,8 @@ namespace BinaryNinjaDebugger
 		void RunToInternal(const std::vector<uint64_t> &remoteAddresses);
 		void StepIntoIL(BNFunctionGraphType il);
 		void StepOverIL(BNFunctionGraphType il);
+		uint64_t GetILStepRangeEnd(uint64_t ip, BNFunctionGraphType il, bool stepOver);
+		DebugStopReason StepILInternal(BNFunctionGraphType il, bool stepOver);
 
 		// Whether we can resume the execution of the target, including stepping.
 		bool CanResumeTarget();
@@ -138,11 +144,30 @@ namespace BinaryNinjaDebugger
 
 		// breakpoints
 		void AddBreakpoint(uint64_t address);
+		void AddBreakpoints(const std::vector<uint64_t>& addresses);
 		void AddBreakpoint(const ModuleNameAndOffset &address);
 		void DeleteBreakpoint(uint64_t address);
+		void DeleteBreakpoints(const std::vector<uint64_t>& addresses);
 		void DeleteBreakpoint(const ModuleNameAndOffset &address);
+		bool SetBreakpointCondition(uint64_t address, const std::string& condition);
+		bool SetBreakpointCondition(const ModuleNameAndOffset& address, const std::string& condition);
 		DebugBreakpoint GetAllBreakpoints();
 
+		// watchpoints, which are hardware resources of the running target, and are not saved
+		bool AddWatchpoint(uint64_t address, size_t size, DebugWatchpointType type);
+		bool RemoveWatchpoint(uint64_t address);
+		std::vector<DebugWatchpoint> GetWatchpoints();
+		uint64_t GetStopDataAddress();
+
+		// tracepoints
+		uint32_t AddTracepoint(const DebugTracepoint& tracepoint);
+		bool RemoveTracepoint(uint32_t id);
+		std::vector<DebugTracepoint> GetTracepoints() const { return m_tracepoints; }
+		bool StartTrace();
+		bool StopTrace();
+		DebugTraceStatus GetTraceStatus();
+		std::vector<DebugTraceFrame> GetTraceFrames();
+
 		// registers
 		uint64_t GetRegisterValue(const std::string &name);
 		bool SetRegisterValue(const std::string &name, uint64_t value);
@@ -151,6 +176,10 @@ namespace BinaryNinjaDebugger
 		// threads
 		DebugThread GetActiveThread() const;
 		void SetActiveThread(const DebugThread &thread);
+		// Resume or stop a single thread, while the target runs or is stopped. Only the adapters with a non-stop mode
+		// support these.
+		bool ResumeThread(uint32_t tid);
+		bool StopThread(uint32_t tid);
 		std::vector<DebugThread> GetAllThreads();
 		std::vector<DebugFrame> GetFramesOfThread(uint64_t tid);
 
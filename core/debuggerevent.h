@@ -30,6 +30,7 @@ namespace BinaryNinjaDebugger
 		DebugStopReason reason;
 		std::uint32_t lastActiveThread;
 		size_t exitCode;
+		std::uint64_t dataAddress;
 		void* data;
 	};
 
@@ -14,6 +14,9 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
 #include <chrono>
 #include <thread>
 #include <utility>
@@ -59,16 +62,41 @@ void DebuggerRegisters::Update()
 
 uint64_t DebuggerRegisters::GetRegisterValue(const std::string& name)
 {
-    // Unlike the Python implementation, we require the DebuggerState to explicitly check for dirty caches
-    // and update the values when necessary. This is mainly because the update can be expensive.
-    if (IsDirty())
-        Update();
-
     auto iter = m_registerCache.find(name);
-    if (iter == m_registerCache.end())
+    if (iter != m_registerCache.end())
+    {
+        m_cacheHits++;
+        return iter->second.m_value;
+    }
+
+    // The cache holds all registers, so the register does not exist
+    if (!IsDirty())
         return 0x0;
 
-    return iter->second.m_value;
+    m_cacheMisses++;
+
+    // Only read the requested register rather than all of them. Stepping mostly needs the pc, which some adapters
+    // already have from the stop reply.
+    DebugAdapter* adapter = m_state->GetAdapter();
+    if (!adapter)
+        return 0x0;
+
+	if (!m_state->IsConnected())
+		return 0x0;
+
+	try
+	{
+		DebugRegister reg = adapter->ReadRegister(name);
+		if (reg.m_name.empty())
+			return 0x0;
+
+		m_registerCache[name] = reg;
+		return reg.m_value;
+	}
+	catch (std::exception&)
+	{
+		return 0x0;
+	}
 }
 
 
@@ -78,6 +106,9 @@ bool DebuggerRegisters::SetRegisterValue(const std::string& name, uint64_t value
     if (!adapter)
         return false;
 
+	if (IsDirty())
+		Update();
+
 	auto iter = m_registerCache.find(name);
 	if (iter == m_registerCache.end())
 		return false;
@@ -122,7 +153,12 @@ static std::string CheckForPrintableString(const DataBuffer& memory)
 std::vector<DebugRegister> DebuggerRegisters::GetAllRegisters()
 {
 	if (IsDirty())
-	 	Update();
+	{
+		m_cacheMisses++;
+		Update();
+	}
+	else
+		m_cacheHits++;
 
     std::vector<DebugRegister> result{};
     for (auto& [reg_name, reg]: m_registerCache)
@@ -419,6 +455,32 @@ bool DebuggerBreakpoints::AddAbsolute(uint64_t remoteAddress)
 }
 
 
+bool DebuggerBreakpoints::AddAbsolute(const std::vector<uint64_t>& remoteAddresses)
+{
+	if (!m_state->GetAdapter())
+		return false;
+
+	bool added = false;
+	for (uint64_t address: remoteAddresses)
+	{
+		if (ContainsAbsolute(address))
+			continue;
+		m_breakpoints.push_back(m_state->GetModules()->AbsoluteAddressToRelative(address));
+		added = true;
+	}
+	// Serialize once for the whole batch, rather than once per breakpoint
+	if (added)
+		SerializeMetadata();
+
+	// The adapter skips the duplicates itself, and can send the whole batch in one go
+	if (!m_state->IsConnected())
+		return false;
+
+	std::vector<std::uintptr_t> addresses(remoteAddresses.begin(), remoteAddresses.end());
+	return m_state->GetAdapter()->AddBreakpoints(addresses);
+}
+
+
 bool DebuggerBreakpoints::AddOffset(const ModuleNameAndOffset& address)
 {
     if (!ContainsOffset(address))
@@ -452,6 +514,7 @@ bool DebuggerBreakpoints::RemoveAbsolute(uint64_t remoteAddress)
         {
             m_breakpoints.erase(iter);
         }
+        m_conditions.erase(info);
         SerializeMetadata();
         m_state->GetAdapter()->RemoveBreakpoint(remoteAddress);
         return true;
@@ -460,6 +523,33 @@ bool DebuggerBreakpoints::RemoveAbsolute(uint64_t remoteAddress)
 }
 
 
+bool DebuggerBreakpoints::RemoveAbsolute(const std::vector<uint64_t>& remoteAddresses)
+{
+	if (!m_state->GetAdapter())
+		return false;
+
+	std::vector<DebugBreakpoint> removed;
+	for (uint64_t address: remoteAddresses)
+	{
+		ModuleNameAndOffset info = m_state->GetModules()->AbsoluteAddressToRelative(address);
+		auto iter = std::find(m_breakpoints.begin(), m_breakpoints.end(), info);
+		if (iter == m_breakpoints.end())
+			continue;
+		m_breakpoints.erase(iter);
+		m_conditions.erase(info);
+		removed.emplace_back(address);
+	}
+
+	if (removed.empty())
+		return false;
+
+	SerializeMetadata();
+	if (m_state->IsConnected())
+		m_state->GetAdapter()->RemoveBreakpoints(removed);
+	return true;
+}
+
+
 bool DebuggerBreakpoints::RemoveOffset(const ModuleNameAndOffset& address)
 {
     if (ContainsOffset(address))
@@ -467,6 +557,7 @@ bool DebuggerBreakpoints::RemoveOffset(const ModuleNameAndOffset& address)
         if (auto iter = std::find(m_breakpoints.begin(), m_breakpoints.end(), address);
                 iter != m_breakpoints.end())
             m_breakpoints.erase(iter);
+        m_conditions.erase(address);
 
         SerializeMetadata();
 
@@ -514,6 +605,47 @@ bool DebuggerBreakpoints::ContainsAbsolute(uint64_t address)
 }
 
 
+bool DebuggerBreakpoints::SetConditionOffset(const ModuleNameAndOffset& address, const std::string& condition)
+{
+    if (std::find(m_breakpoints.begin(), m_breakpoints.end(), address) == m_breakpoints.end())
+        return false;
+
+    // The condition is checked by the adapter when it is live, so an invalid one is not saved
+    if (m_state->GetAdapter() && m_state->IsConnected())
+    {
+        uint64_t remoteAddress = m_state->GetModules()->RelativeAddressToAbsolute(address);
+        if (!m_state->GetAdapter()->SetBreakpointCondition(remoteAddress, condition))
+            return false;
+    }
+
+    if (condition.empty())
+        m_conditions.erase(address);
+    else
+        m_conditions[address] = condition;
+    SerializeMetadata();
+    return true;
+}
+
+
+bool DebuggerBreakpoints::SetConditionAbsolute(uint64_t remoteAddress, const std::string& condition)
+{
+    if (!m_state->GetAdapter())
+        return false;
+
+    ModuleNameAndOffset info = m_state->GetModules()->AbsoluteAddressToRelative(remoteAddress);
+    return SetConditionOffset(info, condition);
+}
+
+
+std::string DebuggerBreakpoints::GetCondition(const ModuleNameAndOffset& address) const
+{
+    auto iter = m_conditions.find(address);
+    if (iter == m_conditions.end())
+        return "";
+    return iter->second;
+}
+
+
 void DebuggerBreakpoints::SerializeMetadata()
 {
     // TODO: who should free these Metadata objects?
@@ -523,6 +655,8 @@ void DebuggerBreakpoints::SerializeMetadata()
         std::map<std::string, Ref<Metadata>> info;
         info["module"] = new Metadata(bp.module);
         info["offset"] = new Metadata(bp.offset);
+        if (auto iter = m_conditions.find(bp); iter != m_conditions.end())
+            info["condition"] = new Metadata(iter->second);
         breakpoints.push_back(new Metadata(info));
     }
     m_state->GetController()->GetData()->StoreMetadata("debugger.breakpoints", new Metadata(breakpoints));
@@ -537,6 +671,7 @@ void DebuggerBreakpoints::UnserializedMetadata()
 
     vector<Ref<Metadata>> array = metadata->GetArray();
     std::vector<ModuleNameAndOffset> newBreakpoints;
+    std::map<ModuleNameAndOffset, std::string> newConditions;
 
     for (auto& element: array)
     {
@@ -555,10 +690,14 @@ void DebuggerBreakpoints::UnserializedMetadata()
             continue;
 
         address.offset = info["offset"]->GetUnsignedInteger();
-        newBreakpoints.push_back(address);        
+        newBreakpoints.push_back(address);
+
+        if (info["condition"] && info["condition"]->IsString() && !info["condition"]->GetString().empty())
+            newConditions[address] = info["condition"]->GetString();
     }
 
     m_breakpoints = newBreakpoints;
+    m_conditions = newConditions;
 }
 
 
@@ -567,78 +706,240 @@ void DebuggerBreakpoints::Apply()
     if (!m_state->GetAdapter())
         return;
 
-    for (const ModuleNameAndOffset& address: m_breakpoints)
-		m_state->GetAdapter()->AddBreakpoint(address);
+    // All breakpoints go to the adapter at once, so it can send them back to back
+    m_state->GetAdapter()->AddBreakpoints(m_breakpoints);
+
+    // The conditions need the breakpoints to be resolved to the addresses in the process first
+    for (const auto& [address, condition]: m_conditions)
+    {
+        uint64_t remoteAddress = m_state->GetModules()->RelativeAddressToAbsolute(address);
+        if (!m_state->GetAdapter()->SetBreakpointCondition(remoteAddress, condition))
+            LogWarn("Failed to set the breakpoint condition \"%s\"", condition.c_str());
+    }
 }
 
 
 DebuggerMemory::DebuggerMemory(DebuggerState *state): m_state(state)
 {
+	LoadSettings();
+}
+
 
+void DebuggerMemory::LoadSettings()
+{
+	Ref<Settings> settings = Settings::Instance();
+	// The blocks are aligned, so the size must be a power of two
+	uint64_t blockSize = std::clamp<uint64_t>(settings->Get<uint64_t>("debugger.memoryCacheBlockSize"), 0x100, 0x100000);
+	while (blockSize & (blockSize - 1))
+		blockSize &= blockSize - 1;
+	m_blockSize = blockSize;
+	m_cacheBudget = settings->Get<uint64_t>("debugger.memoryCacheSize") * 1024 * 1024;
+	m_verifyWrites = settings->Get<bool>("debugger.verifyMemoryWrites");
 }
 
 
 void DebuggerMemory::MarkDirty()
 {
 	std::unique_lock<std::recursive_mutex> memoryLock(m_memoryMutex);
-	m_valueCache.clear();
-	m_errorCache.clear();
+	m_blocks.clear();
+	m_lru.clear();
+	m_cachedBytes = 0;
+	// The cache is empty, so this is the time to pick up changes to the settings
+	LoadSettings();
 }
 
 
-DataBuffer DebuggerMemory::ReadMemory(uint64_t offset, size_t len)
+DebuggerMemory::CacheBlock* DebuggerMemory::FindBlock(uint64_t block)
 {
-	std::unique_lock<std::recursive_mutex> memoryLock(m_memoryMutex);
+	auto iter = m_blocks.find(block);
+	if (iter == m_blocks.end())
+		return nullptr;
 
-	DataBuffer result;
+	m_lru.splice(m_lru.begin(), m_lru, iter->second.m_lruPosition);
+	return &iter->second;
+}
+
+
+void DebuggerMemory::InsertBlock(uint64_t block, DataBuffer data)
+{
+	m_cachedBytes += data.GetLength();
+	m_lru.push_front(block);
+	m_blocks[block] = {std::move(data), m_lru.begin()};
+}
 
-	// ProcessView implements read caching in a manner inspired by CPU cache:
-	// Reads are aligned on 256-byte boundaries and 256 bytes long
 
-	// Cache read start: round down addr to nearest 256 byte boundary
-	size_t cacheStart = offset & (~0xffLL);
-	// Cache read end: round up addr+length to nearest 256 byte boundary
-	size_t cacheEnd = (offset + len + 0xFF) & (~0xffLL);
-	// List of 256-byte block addresses to read into the cache to fully cover this region
-	for (uint64_t block = cacheStart; block < cacheEnd; block += 0x100)
+void DebuggerMemory::EvictBlocks()
+{
+	while ((m_cachedBytes > m_cacheBudget) && !m_lru.empty())
 	{
-		// If any block cannot be read, then return false
-		if (m_errorCache.find(block) != m_errorCache.end())
+		auto iter = m_blocks.find(m_lru.back());
+		m_cachedBytes -= iter->second.m_data.GetLength();
+		m_blocks.erase(iter);
+		m_lru.pop_back();
+	}
+}
+
+
+void DebuggerMemory::FetchBlocks(uint64_t first, uint64_t last)
+{
+	DebugAdapter* adapter = m_state->GetAdapter();
+	// The block addresses are compared to the last one rather than an end, which could wrap around to 0
+	uint64_t block = first;
+	while (true)
+	{
+		if (const CacheBlock* cached = FindBlock(block))
 		{
-			return result;
+			m_cacheHits++;
+			// Nothing past a partial block makes it into the read result
+			if ((block == last) || (cached->m_data.GetLength() < m_blockSize))
+				return;
+			block += m_blockSize;
+			continue;
+		}
+
+		const uint64_t runStart = block;
+		uint64_t runBlocks = 1;
+		while ((block != last) && (m_blocks.find(block + m_blockSize) == m_blocks.end()))
+		{
+			block += m_blockSize;
+			runBlocks++;
+		}
+		m_cacheMisses += runBlocks;
+
+		const uint64_t runSize = runBlocks * m_blockSize;
+		const DataBuffer data = adapter ? adapter->ReadMemory(runStart, runSize) : DataBuffer();
+		const uint64_t length = std::min<uint64_t>(data.GetLength(), runSize);
+		uint64_t offset = 0;
+		for (; offset + m_blockSize <= length; offset += m_blockSize)
+			InsertBlock(runStart + offset, data.GetSlice(offset, m_blockSize));
+
+		if (offset < runSize)
+		{
+			// The LLDB and DbgEng adapters fail the whole read if any byte of it cannot be read, so a short read of
+			// several blocks does not tell where the readable memory ends. Re-read the rest of the run one block at a
+			// time. A short read of a single block stops at a byte that cannot be read, and the read result ends
+			// there as well, so the rest of the run is not needed.
+			for (; offset + m_blockSize < runSize; offset += m_blockSize)
+			{
+				const DataBuffer blockData = adapter ? adapter->ReadMemory(runStart + offset, m_blockSize) : DataBuffer();
+				if (blockData.GetLength() < m_blockSize)
+				{
+					InsertBlock(runStart + offset, blockData);
+					return;
+				}
+				InsertBlock(runStart + offset, blockData.GetSlice(0, m_blockSize));
+			}
+
+			// The last block of the run, which is also the only one if the run was a single block
+			DataBuffer lastData = (runBlocks == 1) ? data.GetSlice(offset, length - offset)
+				: (adapter ? adapter->ReadMemory(runStart + offset, m_blockSize) : DataBuffer());
+			if (lastData.GetLength() > m_blockSize)
+				lastData = lastData.GetSlice(0, m_blockSize);
+			const bool full = lastData.GetLength() == m_blockSize;
+			InsertBlock(runStart + offset, lastData);
+			if (!full)
+				return;
 		}
 
-		auto iter = m_valueCache.find(block);
-		if (iter == m_valueCache.end())
+		if (block == last)
+			return;
+		block += m_blockSize;
+	}
+}
+
+
+void DebuggerMemory::UpdateBlocks(uint64_t address, const DataBuffer& data)
+{
+	const uint64_t len = data.GetLength();
+	if (len == 0)
+		return;
+
+	const uint64_t lastByte = (address + len - 1 < address) ? UINT64_MAX : address + len - 1;
+	const uint64_t last = lastByte & ~(m_blockSize - 1);
+	for (uint64_t block = address & ~(m_blockSize - 1); ; block += m_blockSize)
+	{
+		auto iter = m_blocks.find(block);
+		if (iter != m_blocks.end())
 		{
-			// The ReadMemory() function should return the number of bytes read
-			DataBuffer buffer = m_state->GetAdapter()->ReadMemory(block, 0x100);
-			// TODO: what if the buffer's size is smaller than 0x100
-			if (buffer.GetLength() > 0)
+			DataBuffer& cached = iter->second.m_data;
+			const uint64_t begin = std::max(address, block) - block;
+			const uint64_t stop = std::min(lastByte - block, m_blockSize - 1) + 1;
+			if (stop <= cached.GetLength())
 			{
-				m_valueCache[block] = buffer;
+				memcpy((uint8_t*)cached.GetData() + begin, (const uint8_t*)data.GetData() + (block + begin - address),
+					stop - begin);
 			}
 			else
 			{
-				m_errorCache.insert(block);
-				return result;
+				// The write went past the readable part of a partial block, so its end is no longer known
+				m_cachedBytes -= cached.GetLength();
+				m_lru.erase(iter->second.m_lruPosition);
+				m_blocks.erase(iter);
 			}
 		}
 
-		DataBuffer cached = m_valueCache[block];
-		if (offset + len < block + cached.GetLength())
-		{
-			// Last block
-			cached = cached.GetSlice(0, offset + len - block);
-		}
-		// Note a block can be both the fist and the last block, so we should not put an else here
-		if (offset > block)
+		if (block == last)
+			break;
+	}
+}
+
+
+void DebuggerMemory::DropBlocks(uint64_t address, uint64_t length)
+{
+	if (length == 0)
+		return;
+
+	const uint64_t lastByte = (address + length - 1 < address) ? UINT64_MAX : address + length - 1;
+	const uint64_t last = lastByte & ~(m_blockSize - 1);
+	for (uint64_t block = address & ~(m_blockSize - 1); ; block += m_blockSize)
+	{
+		auto iter = m_blocks.find(block);
+		if (iter != m_blocks.end())
 		{
-			// First block
-			cached = cached.GetSlice(offset - block, cached.GetLength() - (offset - block));
+			m_cachedBytes -= iter->second.m_data.GetLength();
+			m_lru.erase(iter->second.m_lruPosition);
+			m_blocks.erase(iter);
 		}
-		result.Append(cached);
+
+		if (block == last)
+			break;
 	}
+}
+
+
+DataBuffer DebuggerMemory::ReadMemory(uint64_t offset, size_t len)
+{
+	std::unique_lock<std::recursive_mutex> memoryLock(m_memoryMutex);
+
+	DataBuffer result;
+	if (len == 0)
+		return result;
+
+	// The last byte to read, without wrapping around the end of the address space
+	const uint64_t lastByte = (offset + len - 1 < offset) ? UINT64_MAX : offset + len - 1;
+	const uint64_t first = offset & ~(m_blockSize - 1);
+	const uint64_t last = lastByte & ~(m_blockSize - 1);
+
+	// Fetch first, and only evict once the result is assembled, so a read larger than the budget still works
+	FetchBlocks(first, last);
+
+	// The result holds the bytes up to the first one that cannot be read
+	for (uint64_t block = first; ; block += m_blockSize)
+	{
+		const CacheBlock* cached = FindBlock(block);
+		if (!cached)
+			break;
+
+		const uint64_t begin = std::max(offset, block) - block;
+		const uint64_t stop = std::min(lastByte - block, m_blockSize - 1) + 1;
+		const uint64_t available = std::min<uint64_t>(stop, cached->m_data.GetLength());
+		if (available > begin)
+			result.Append(cached->m_data.GetSlice(begin, available - begin));
+		if ((available < stop) || (block == last))
+			break;
+	}
+
+	EvictBlocks();
 	return result;
 }
 
@@ -654,8 +955,21 @@ bool DebuggerMemory::WriteMemory(std::uintptr_t address, const DataBuffer& buffe
 	if (!adapter->WriteMemory(address, buffer))
 		return false;
 
-//	TODO: Assume any memory change invalidates memory cache (suboptimal, may not be necessary)
-	MarkDirty();
+	if (m_verifyWrites)
+	{
+		// Some targets ignore writes to read-only memory and still report success
+		const DataBuffer readBack = adapter->ReadMemory(address, buffer.GetLength());
+		if ((readBack.GetLength() != buffer.GetLength())
+			|| (memcmp(readBack.GetData(), buffer.GetData(), buffer.GetLength()) != 0))
+		{
+			LogWarn("memory write of 0x%zx bytes at 0x%" PRIx64 " did not take effect", buffer.GetLength(),
+				(uint64_t)address);
+			DropBlocks(address, buffer.GetLength());
+			return false;
+		}
+	}
+
+	UpdateBlocks(address, buffer);
 	return true;
 }
 
@@ -751,6 +1065,12 @@ void DebuggerState::AddBreakpoint(uint64_t address)
 }
 
 
+void DebuggerState::AddBreakpoints(const std::vector<uint64_t>& addresses)
+{
+	m_breakpoints->AddAbsolute(addresses);
+}
+
+
 void DebuggerState::AddBreakpoint(const ModuleNameAndOffset& address)
 {
     m_breakpoints->AddOffset(address);
@@ -763,12 +1083,30 @@ void DebuggerState::DeleteBreakpoint(uint64_t address)
 }
 
 
+void DebuggerState::DeleteBreakpoints(const std::vector<uint64_t>& addresses)
+{
+	m_breakpoints->RemoveAbsolute(addresses);
+}
+
+
 void DebuggerState::DeleteBreakpoint(const ModuleNameAndOffset& address)
 {
     m_breakpoints->RemoveOffset(address);
 }
 
 
+bool DebuggerState::SetBreakpointCondition(uint64_t address, const std::string& condition)
+{
+    return m_breakpoints->SetConditionAbsolute(address, condition);
+}
+
+
+bool DebuggerState::SetBreakpointCondition(const ModuleNameAndOffset& address, const std::string& condition)
+{
+    return m_breakpoints->SetConditionOffset(address, condition);
+}
+
+
 uint64_t DebuggerState::IP()
 {
     if (!IsConnected())
@@ -814,9 +1152,7 @@ void DebuggerState::UpdateCaches()
 	if (!IsConnected())
 		return;
 
-    if (m_registers->IsDirty())
-        m_registers->Update();
-
+    // The registers are read lazily, since many stops only need a few of them, e.g., the pc when stepping
     if (m_threads->IsDirty())
         m_threads->Update();
 
@@ -24,6 +24,9 @@ limitations under the License.
 #include "semaphore.h"
 #include "ffi_global.h"
 #include "refcountobject.h"
+#include <atomic>
+#include <list>
+#include <unordered_map>
 
 DECLARE_DEBUGGER_API_OBJECT(BNDebuggerState, DebuggerState);
 
@@ -39,7 +42,10 @@ namespace BinaryNinjaDebugger
 	private:
 		DebuggerState* m_state;
 		std::unordered_map<std::string, DebugRegister> m_registerCache;
+		// When dirty, the cache only holds the registers that have been read individually since the last stop
 		bool m_dirty;
+		std::atomic<uint64_t> m_cacheHits{};
+		std::atomic<uint64_t> m_cacheMisses{};
 
 	public:
 		DebuggerRegisters(DebuggerState* state);
@@ -50,6 +56,8 @@ namespace BinaryNinjaDebugger
 		bool IsDirty() const { return m_dirty; }
 		void Update();
 		std::vector<DebugRegister> GetAllRegisters();
+		uint64_t GetCacheHits() const { return m_cacheHits; }
+		uint64_t GetCacheMisses() const { return m_cacheMisses; }
 	};
 
 
@@ -81,15 +89,22 @@ namespace BinaryNinjaDebugger
 	private:
 		DebuggerState* m_state;
 		std::vector<ModuleNameAndOffset> m_breakpoints;
+		// Only the conditional breakpoints have an entry
+		std::map<ModuleNameAndOffset, std::string> m_conditions;
 
 	public:
 		DebuggerBreakpoints(DebuggerState* state, std::vector<ModuleNameAndOffset> initial = {});
 		bool AddAbsolute(uint64_t remoteAddress);
+		bool AddAbsolute(const std::vector<uint64_t>& remoteAddresses);
 		bool AddOffset(const ModuleNameAndOffset& address);
 		bool RemoveAbsolute(uint64_t remoteAddress);
+		bool RemoveAbsolute(const std::vector<uint64_t>& remoteAddresses);
 		bool RemoveOffset(const ModuleNameAndOffset& address);
 		bool ContainsAbsolute(uint64_t address);
 		bool ContainsOffset(const ModuleNameAndOffset& address);
+		bool SetConditionAbsolute(uint64_t remoteAddress, const std::string& condition);
+		bool SetConditionOffset(const ModuleNameAndOffset& address, const std::string& condition);
+		std::string GetCondition(const ModuleNameAndOffset& address) const;
 		void Apply();
 		void SerializeMetadata();
 		void UnserializedMetadata();
@@ -117,12 +132,40 @@ namespace BinaryNinjaDebugger
 	};
 
 
+	// Caches the target memory in aligned blocks, "debugger.memoryCacheBlockSize" bytes each. The least recently used
+	// blocks are evicted once the cache holds more than "debugger.memoryCacheSize" bytes.
 	class DebuggerMemory
 	{
+		struct CacheBlock
+		{
+			// The readable bytes from the start of the block. A block that is shorter than the block size ends at
+			// the first byte that cannot be read, e.g., the end of a mapping; an empty one cannot be read at all.
+			DataBuffer m_data;
+			std::list<uint64_t>::iterator m_lruPosition;
+		};
+
 		DebuggerState* m_state;
-		std::map<uint64_t, DataBuffer> m_valueCache;
-		std::set<uint64_t> m_errorCache;
+		uint64_t m_blockSize;
+		uint64_t m_cacheBudget;
+		bool m_verifyWrites;
+		std::unordered_map<uint64_t, CacheBlock> m_blocks;
+		// Block addresses, the most recently used first
+		std::list<uint64_t> m_lru;
+		uint64_t m_cachedBytes{};
 		std::recursive_mutex m_memoryMutex;
+		// Counted per block
+		std::atomic<uint64_t> m_cacheHits{};
+		std::atomic<uint64_t> m_cacheMisses{};
+
+		void LoadSettings();
+		CacheBlock* FindBlock(uint64_t block);
+		void InsertBlock(uint64_t block, DataBuffer data);
+		void EvictBlocks();
+		// Read the blocks from first to last that are not cached, with one adapter read per run of adjacent blocks
+		void FetchBlocks(uint64_t first, uint64_t last);
+		// Patch the cached blocks that a successful write overlaps, so the rest of the cache stays valid
+		void UpdateBlocks(uint64_t address, const DataBuffer& data);
+		void DropBlocks(uint64_t address, uint64_t length);
 
 	public:
 		DebuggerMemory(DebuggerState* state);
@@ -130,6 +173,8 @@ namespace BinaryNinjaDebugger
 		void MarkDirty();
 		DataBuffer ReadMemory(uint64_t offset, size_t len);
 		bool WriteMemory(std::uintptr_t address, const DataBuffer& buffer);
+		uint64_t GetCacheHits() const { return m_cacheHits; }
+		uint64_t GetCacheMisses() const { return m_cacheMisses; }
 	};
 
 
@@ -201,9 +246,13 @@ namespace BinaryNinjaDebugger
 		// DebugBreakpointsWidget, and the planned C++/Python API.
 		// It will communicate with the adapter and add/delete the breakpoint. It will also update the UI if needed.
 		void AddBreakpoint(uint64_t address);
+		void AddBreakpoints(const std::vector<uint64_t>& addresses);
 		void AddBreakpoint(const ModuleNameAndOffset& address);
 		void DeleteBreakpoint(uint64_t address);
+		void DeleteBreakpoints(const std::vector<uint64_t>& addresses);
 		void DeleteBreakpoint(const ModuleNameAndOffset& address);
+		bool SetBreakpointCondition(uint64_t address, const std::string& condition);
+		bool SetBreakpointCondition(const ModuleNameAndOffset& address, const std::string& condition);
 
 		uint64_t IP();
 		uint64_t StackPointer();
@@ -15,6 +15,7 @@ limitations under the License.
 */
 
 #include "binaryninjaapi.h"
+#include <cstring>
 #include "debuggercontroller.h"
 #include "debuggercommon.h"
 #include "../api/ffi.h"
@@ -243,6 +244,18 @@ void BNDebuggerSetActiveThread(BNDebuggerController* controller, BNDebugThread t
 }
 
 
+bool BNDebuggerResumeThread(BNDebuggerController* controller, uint32_t tid)
+{
+	return controller->object->ResumeThread(tid);
+}
+
+
+bool BNDebuggerStopThread(BNDebuggerController* controller, uint32_t tid)
+{
+	return controller->object->StopThread(tid);
+}
+
+
 BNDebugFrame* BNDebuggerGetFramesOfThread(BNDebuggerController* controller, uint32_t tid, size_t* count)
 {
 	std::vector<DebugFrame> frames = controller->object->GetFramesOfThread(tid);
@@ -666,6 +679,7 @@ BNDebugBreakpoint* BNDebuggerGetBreakpoints(BNDebuggerController* controller, si
 		result[i].offset = breakpoints[i].offset;
 		result[i].address = remoteAddress;
 		result[i].enabled = enabled;
+		result[i].condition = BNDebuggerAllocString(state->GetBreakpoints()->GetCondition(breakpoints[i]).c_str());
 	}
 	return result;
 }
@@ -676,6 +690,7 @@ void BNDebuggerFreeBreakpoints(BNDebugBreakpoint* breakpoints, size_t count)
 	for (size_t i = 0; i < count; i++)
 	{
 		BNDebuggerFreeString(breakpoints[i].module);
+		BNDebuggerFreeString(breakpoints[i].condition);
 	}
 	delete[] breakpoints;
 }
@@ -699,6 +714,18 @@ void BNDebuggerAddAbsoluteBreakpoint(BNDebuggerController* controller, uint64_t
 }
 
 
+void BNDebuggerAddAbsoluteBreakpoints(BNDebuggerController* controller, const uint64_t* addresses, size_t count)
+{
+	controller->object->AddBreakpoints(std::vector<uint64_t>(addresses, addresses + count));
+}
+
+
+void BNDebuggerDeleteAbsoluteBreakpoints(BNDebuggerController* controller, const uint64_t* addresses, size_t count)
+{
+	controller->object->DeleteBreakpoints(std::vector<uint64_t>(addresses, addresses + count));
+}
+
+
 void BNDebuggerAddRelativeBreakpoint(BNDebuggerController* controller, const char* module, uint64_t offset)
 {
 	controller->object->AddBreakpoint(ModuleNameAndOffset(module, offset));
@@ -745,6 +772,218 @@ bool BNDebuggerContainsRelativeBreakpoint(BNDebuggerController* controller, cons
 }
 
 
+bool BNDebuggerSetAbsoluteBreakpointCondition(BNDebuggerController* controller, uint64_t address, const char* condition)
+{
+	return controller->object->SetBreakpointCondition(address, condition);
+}
+
+
+bool BNDebuggerSetRelativeBreakpointCondition(BNDebuggerController* controller, const char* module, uint64_t offset,
+	const char* condition)
+{
+	return controller->object->SetBreakpointCondition(ModuleNameAndOffset(module, offset), condition);
+}
+
+
+bool BNDebuggerAddWatchpoint(BNDebuggerController* controller, uint64_t address, uint64_t size,
+	BNDebugWatchpointType type)
+{
+	return controller->object->AddWatchpoint(address, size, type);
+}
+
+
+bool BNDebuggerRemoveWatchpoint(BNDebuggerController* controller, uint64_t address)
+{
+	return controller->object->RemoveWatchpoint(address);
+}
+
+
+BNDebugWatchpoint* BNDebuggerGetWatchpoints(BNDebuggerController* controller, size_t* count)
+{
+	std::vector<DebugWatchpoint> watchpoints = controller->object->GetWatchpoints();
+	*count = watchpoints.size();
+
+	BNDebugWatchpoint* result = new BNDebugWatchpoint[watchpoints.size()];
+	for (size_t i = 0; i < watchpoints.size(); i++)
+	{
+		result[i].address = watchpoints[i].m_address;
+		result[i].size = watchpoints[i].m_size;
+		result[i].type = watchpoints[i].m_type;
+	}
+	return result;
+}
+
+
+void BNDebuggerFreeWatchpoints(BNDebugWatchpoint* watchpoints)
+{
+	delete[] watchpoints;
+}
+
+
+uint64_t BNDebuggerGetStopDataAddress(BNDebuggerController* controller)
+{
+	return controller->object->GetStopDataAddress();
+}
+
+
+uint32_t BNDebuggerAddTracepoint(BNDebuggerController* controller, BNDebugTracepoint* tracepoint)
+{
+	DebugTracepoint tp;
+	tp.m_address = tracepoint->address;
+	tp.m_collectAllRegisters = tracepoint->collectAllRegisters;
+	for (size_t i = 0; i < tracepoint->registerCount; i++)
+		tp.m_registers.emplace_back(tracepoint->registers[i]);
+	for (size_t i = 0; i < tracepoint->memoryCount; i++)
+		tp.m_memory.emplace_back(tracepoint->memoryAddresses[i], tracepoint->memorySizes[i]);
+	for (size_t i = 0; i < tracepoint->expressionCount; i++)
+		tp.m_expressions.emplace_back(tracepoint->expressions[i]);
+	if (tracepoint->condition)
+		tp.m_condition = tracepoint->condition;
+	tp.m_passCount = tracepoint->passCount;
+	return controller->object->AddTracepoint(tp);
+}
+
+
+bool BNDebuggerRemoveTracepoint(BNDebuggerController* controller, uint32_t id)
+{
+	return controller->object->RemoveTracepoint(id);
+}
+
+
+BNDebugTracepoint* BNDebuggerGetTracepoints(BNDebuggerController* controller, size_t* count)
+{
+	std::vector<DebugTracepoint> tracepoints = controller->object->GetTracepoints();
+	*count = tracepoints.size();
+
+	BNDebugTracepoint* result = new BNDebugTracepoint[tracepoints.size()];
+	for (size_t i = 0; i < tracepoints.size(); i++)
+	{
+		const DebugTracepoint& tp = tracepoints[i];
+		result[i].id = tp.m_id;
+		result[i].address = tp.m_address;
+		result[i].collectAllRegisters = tp.m_collectAllRegisters;
+
+		result[i].registerCount = tp.m_registers.size();
+		result[i].registers = new char*[tp.m_registers.size()];
+		for (size_t j = 0; j < tp.m_registers.size(); j++)
+			result[i].registers[j] = BNDebuggerAllocString(tp.m_registers[j].c_str());
+
+		result[i].memoryCount = tp.m_memory.size();
+		result[i].memoryAddresses = new uint64_t[tp.m_memory.size()];
+		result[i].memorySizes = new uint64_t[tp.m_memory.size()];
+		for (size_t j = 0; j < tp.m_memory.size(); j++)
+		{
+			result[i].memoryAddresses[j] = tp.m_memory[j].first;
+			result[i].memorySizes[j] = tp.m_memory[j].second;
+		}
+
+		result[i].expressionCount = tp.m_expressions.size();
+		result[i].expressions = new char*[tp.m_expressions.size()];
+		for (size_t j = 0; j < tp.m_expressions.size(); j++)
+			result[i].expressions[j] = BNDebuggerAllocString(tp.m_expressions[j].c_str());
+
+		result[i].condition = BNDebuggerAllocString(tp.m_condition.c_str());
+		result[i].passCount = tp.m_passCount;
+	}
+	return result;
+}
+
+
+void BNDebuggerFreeTracepoints(BNDebugTracepoint* tracepoints, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		for (size_t j = 0; j < tracepoints[i].registerCount; j++)
+			BNDebuggerFreeString(tracepoints[i].registers[j]);
+		delete[] tracepoints[i].registers;
+		delete[] tracepoints[i].memoryAddresses;
+		delete[] tracepoints[i].memorySizes;
+		for (size_t j = 0; j < tracepoints[i].expressionCount; j++)
+			BNDebuggerFreeString(tracepoints[i].expressions[j]);
+		delete[] tracepoints[i].expressions;
+		BNDebuggerFreeString(tracepoints[i].condition);
+	}
+	delete[] tracepoints;
+}
+
+
+bool BNDebuggerStartTrace(BNDebuggerController* controller)
+{
+	return controller->object->StartTrace();
+}
+
+
+bool BNDebuggerStopTrace(BNDebuggerController* controller)
+{
+	return controller->object->StopTrace();
+}
+
+
+bool BNDebuggerGetTraceStatus(BNDebuggerController* controller, bool* running, BNDebugTraceStopReason* stopReason,
+	uint64_t* frames, uint64_t* bufferSize, uint64_t* bufferFree)
+{
+	DebugTraceStatus status = controller->object->GetTraceStatus();
+	*running = status.m_running;
+	*stopReason = status.m_stopReason;
+	*frames = status.m_frames;
+	*bufferSize = status.m_bufferSize;
+	*bufferFree = status.m_bufferFree;
+	return status.m_supported;
+}
+
+
+BNDebugTraceFrame* BNDebuggerGetTraceFrames(BNDebuggerController* controller, size_t* count)
+{
+	std::vector<DebugTraceFrame> frames = controller->object->GetTraceFrames();
+	*count = frames.size();
+
+	BNDebugTraceFrame* result = new BNDebugTraceFrame[frames.size()];
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		const DebugTraceFrame& frame = frames[i];
+		result[i].index = frame.m_index;
+		result[i].tracepoint = frame.m_tracepoint;
+
+		result[i].registerCount = frame.m_registers.size();
+		result[i].registers = new BNDebugTraceRegister[frame.m_registers.size()];
+		size_t j = 0;
+		for (const auto& [name, value]: frame.m_registers)
+		{
+			result[i].registers[j].name = BNDebuggerAllocString(name.c_str());
+			result[i].registers[j].value = value;
+			j++;
+		}
+
+		result[i].memoryCount = frame.m_memory.size();
+		result[i].memory = new BNDebugTraceMemory[frame.m_memory.size()];
+		for (j = 0; j < frame.m_memory.size(); j++)
+		{
+			const auto& [address, data] = frame.m_memory[j];
+			result[i].memory[j].address = address;
+			result[i].memory[j].size = data.GetLength();
+			result[i].memory[j].data = new uint8_t[data.GetLength()];
+			memcpy(result[i].memory[j].data, data.GetData(), data.GetLength());
+		}
+	}
+	return result;
+}
+
+
+void BNDebuggerFreeTraceFrames(BNDebugTraceFrame* frames, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		for (size_t j = 0; j < frames[i].registerCount; j++)
+			BNDebuggerFreeString(frames[i].registers[j].name);
+		delete[] frames[i].registers;
+		for (size_t j = 0; j < frames[i].memoryCount; j++)
+			delete[] frames[i].memory[j].data;
+		delete[] frames[i].memory;
+	}
+	delete[] frames;
+}
+
+
 uint64_t BNDebuggerRelativeAddressToAbsolute(BNDebuggerController* controller, const char* module, uint64_t offset)
 {
 	DebuggerState* state = controller->object->GetState();
@@ -797,6 +1036,7 @@ size_t BNDebuggerRegisterEventCallback(BNDebuggerController* controller,
 		evt->data.targetStoppedData.reason = event.data.targetStoppedData.reason;
 		evt->data.targetStoppedData.exitCode = event.data.targetStoppedData.exitCode;
 		evt->data.targetStoppedData.lastActiveThread = event.data.targetStoppedData.lastActiveThread;
+		evt->data.targetStoppedData.dataAddress = event.data.targetStoppedData.dataAddress;
 		evt->data.targetStoppedData.data = event.data.targetStoppedData.data;
 
 		evt->data.errorData.error = BNDebuggerAllocString(event.data.errorData.error.c_str());
@@ -12,9 +12,11 @@ import unittest
 
 from binaryninja import BinaryView, BinaryViewType, LowLevelILOperation, mainthread, Settings
 try:
-    from binaryninja.debugger import DebuggerController, DebugStopReason
+    from binaryninja.debugger import DebuggerController, DebugStopReason, DebugWatchpointType, DebugAdapterType, \
+        ModuleNameAndOffset
 except:
-    from debugger import DebuggerController, DebugStopReason
+    from debugger import DebuggerController, DebugStopReason, DebugWatchpointType, DebugAdapterType, \
+        ModuleNameAndOffset
 
 
 # 'helloworld' -> '{BN_SOURCE_ROOT}\public\debugger\test\binaries\Windows-x64\helloworld.exe' (windows)
@@ -183,6 +185,131 @@ class DebuggerAPI(unittest.TestCase):
         self.assertEqual(dbg.ip, entry)
         dbg.quit()
 
+    def test_breakpoint_bulk(self):
+        fpath = name_to_fpath('helloworld', self.arch)
+        bv = BinaryViewType.get_view_of_file(fpath)
+        dbg = DebuggerController(bv)
+        # a module that never gets loaded must not stop the rest of the batch from being applied
+        unloaded = ModuleNameAndOffset('no_such_module', 0x1000)
+        dbg.add_breakpoint(unloaded)
+        self.assertTrue(dbg.launch())
+
+        # the instruction addresses of the executable code, rebased to where the binary got loaded
+        delta = dbg.live_view.entry_point - bv.entry_point
+        addresses = []
+        for func in bv.functions:
+            segment = bv.get_segment_at(func.start)
+            if segment is None or not segment.executable:
+                continue
+            addresses.extend(addr + delta for _, addr in func.instructions)
+        addresses = sorted(set(addresses))[:300]
+        self.assertIn(dbg.live_view.entry_point, addresses)
+        self.assertGreater(len(addresses), 50)
+
+        # the duplicates within the batch, and the ones already set, are skipped
+        dbg.add_breakpoint(addresses[0])
+        dbg.add_breakpoints(addresses + addresses[:10])
+        bps = dbg.breakpoints
+        self.assertEqual(len(bps), len(addresses) + 1)
+        self.assertEqual(set(bp.address for bp in bps if bp.module != unloaded.module), set(addresses))
+        self.assertTrue(any(bp.module == unloaded.module and bp.offset == unloaded.offset for bp in bps))
+
+        # the target is still stopped by one of them
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.Breakpoint)
+        self.assertIn(dbg.ip, addresses)
+
+        dbg.delete_breakpoints(addresses)
+        bps = dbg.breakpoints
+        self.assertEqual(len(bps), 1)
+        self.assertEqual(bps[0].module, unloaded.module)
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.ProcessExited)
+
+    def test_breakpoint_condition(self):
+        fpath = name_to_fpath('helloworld', self.arch)
+        bv = BinaryViewType.get_view_of_file(fpath)
+        dbg = DebuggerController(bv)
+        self.assertTrue(dbg.launch())
+
+        entry = dbg.live_view.entry_point
+        # there is no breakpoint to attach the condition to
+        self.assertFalse(dbg.set_breakpoint_condition(entry + 1, '1'))
+
+        dbg.add_breakpoint(entry)
+        if not dbg.set_breakpoint_condition(entry, '$hits > 0'):
+            dbg.quit()
+            self.skipTest('the adapter does not support breakpoint conditions')
+
+        self.assertFalse(dbg.set_breakpoint_condition(entry, 'no_such_register == 1'))
+        self.assertFalse(dbg.set_breakpoint_condition(entry, '1 +'))
+        self.assertEqual(dbg.breakpoints[0].condition, '$hits > 0')
+
+        self.assertTrue(dbg.set_breakpoint_condition(entry, ''))
+        self.assertEqual(dbg.breakpoints[0].condition, '')
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.ProcessExited)
+
+    def test_tracepoint(self):
+        fpath = name_to_fpath('helloworld', self.arch)
+        bv = BinaryViewType.get_view_of_file(fpath)
+        dbg = DebuggerController(bv)
+        self.assertTrue(dbg.launch())
+
+        entry = dbg.live_view.entry_point
+        tp_id = dbg.add_tracepoint(entry, registers=[], memory=[(entry, 16)], all_registers=True)
+        temp_id = dbg.add_tracepoint(entry + 1)
+        self.assertTrue(dbg.remove_tracepoint(temp_id))
+        self.assertFalse(dbg.remove_tracepoint(temp_id))
+        self.assertEqual([tp.id for tp in dbg.tracepoints], [tp_id])
+        self.assertEqual(dbg.tracepoints[0].memory, [(entry, 16)])
+
+        if not dbg.trace_status.supported:
+            dbg.quit()
+            self.skipTest('the adapter does not support tracepoints')
+
+        self.assertTrue(dbg.start_trace())
+        self.assertTrue(dbg.trace_status.running)
+        self.assertTrue(dbg.stop_trace())
+        self.assertFalse(dbg.trace_status.running)
+        dbg.quit()
+
+    def test_watchpoint(self):
+        fpath = name_to_fpath('helloworld', self.arch)
+        bv = BinaryViewType.get_view_of_file(fpath)
+        dbg = DebuggerController(bv)
+        self.assertTrue(dbg.launch())
+
+        # The first call or push writes right below the stack pointer
+        address = (dbg.stack_pointer - 8) & ~7
+        if not dbg.add_watchpoint(address, 8, DebugWatchpointType.WatchpointWrite):
+            dbg.quit()
+            self.skipTest('the adapter does not support watchpoints')
+
+        self.assertEqual([(wp.address, wp.size) for wp in dbg.watchpoints], [(address, 8)])
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.Watchpoint)
+        self.assertEqual(dbg.stop_data_address, address)
+
+        self.assertTrue(dbg.remove_watchpoint(address))
+        self.assertFalse(dbg.remove_watchpoint(address))
+        self.assertEqual(dbg.watchpoints, [])
+        dbg.quit()
+
+    def test_stats(self):
+        fpath = name_to_fpath('helloworld', self.arch)
+        bv = BinaryViewType.get_view_of_file(fpath)
+        dbg = DebuggerController(bv)
+        self.assertTrue(dbg.launch())
+
+        dbg.step_into_and_wait()
+        dbg.regs
+        stats = dbg.stats
+        self.assertIn('cache', stats)
+        self.assertGreater(stats['cache']['register_hits'] + stats['cache']['register_misses'], 0)
+        self.assertGreaterEqual(stats['operations']['StepInto']['count'], 1)
+        dbg.quit()
+
     def test_register_read_write(self):
         fpath = name_to_fpath('helloworld', self.arch)
         bv = BinaryViewType.get_view_of_file(fpath)
@@ -235,6 +362,41 @@ class DebuggerAPI(unittest.TestCase):
 
         dbg.quit()
 
+    def test_memory_read_across_mapping_end(self):
+        fpath = name_to_fpath('helloworld', self.arch)
+        bv = BinaryViewType.get_view_of_file(fpath)
+        dbg = DebuggerController(bv)
+        self.assertTrue(dbg.launch())
+
+        modules = dbg.modules
+        module = next((m for m in modules if m.short_name == os.path.basename(fpath)), modules[0])
+        # The end of the last page of the main module, which is usually followed by unmapped memory
+        page_end = (module.address + module.size + 0xfff) & ~0xfff
+        # The readable bytes before the end of the mapping must come back, even though the rest of the read fails
+        data = dbg.read_memory(page_end - 0x100, 0x2000)
+        self.assertGreaterEqual(len(data), 0x100)
+        self.assertEqual(data[:0x100], dbg.read_memory(page_end - 0x100, 0x100))
+
+        dbg.quit()
+
+    def test_memory_write_keeps_cache(self):
+        fpath = name_to_fpath('helloworld', self.arch)
+        bv = BinaryViewType.get_view_of_file(fpath)
+        dbg = DebuggerController(bv)
+        self.assertTrue(dbg.launch())
+
+        addr = dbg.ip + 10
+        data = dbg.read_memory(addr, 16)
+        misses = dbg.stats['cache']['memory_misses']
+        # A write updates the cached block in place, so reading it back does not go to the backend
+        self.assertTrue(dbg.write_memory(addr, b'\xCC' * 16))
+        self.assertEqual(dbg.read_memory(addr, 16), b'\xCC' * 16)
+        self.assertTrue(dbg.write_memory(addr, data))
+        self.assertEqual(dbg.read_memory(addr, 16), data)
+        self.assertEqual(dbg.stats['cache']['memory_misses'], misses)
+
+        dbg.quit()
+
     # @unittest.skip
     def test_thread(self):
         fpath = name_to_fpath('helloworld_thread', self.arch)
@@ -260,6 +422,46 @@ class DebuggerAPI(unittest.TestCase):
         self.assertGreater(len(threads), 1)
         dbg.quit()
 
+    def test_non_stop(self):
+        fpath = name_to_fpath('helloworld_thread', self.arch)
+        bv = BinaryViewType.get_view_of_file(fpath)
+        if 'Local GDB' not in DebugAdapterType.get_available_adapters(bv):
+            self.skipTest('the non-stop mode is only supported by the gdbserver adapter')
+
+        dbg = DebuggerController(bv)
+        dbg.adapter_type = 'Local GDB'
+        # Takes effect when the adapter connects to gdbserver
+        self.assertTrue(dbg.set_adapter_property('non_stop', True))
+        self.assertTrue(dbg.launch())
+        if not dbg.get_adapter_property('non_stop_active'):
+            dbg.quit()
+            self.skipTest('gdbserver does not support the non-stop mode')
+
+        dbg.go()
+        time.sleep(1)
+        dbg.pause_and_wait()
+        threads = dbg.threads
+        self.assertGreater(len(threads), 1)
+
+        # Let one thread run while the active one stays stopped, and read the registers of the stopped one
+        active = dbg.active_thread.tid
+        other = next(thread.tid for thread in threads if thread.tid != active)
+        ip = dbg.ip
+        self.assertTrue(dbg.resume_thread(other))
+        time.sleep(0.5)
+        self.assertGreater(len(dbg.regs), 0)
+        self.assertEqual(dbg.ip, ip)
+        self.assertEqual(dbg.active_thread.tid, active)
+
+        # The active thread is resumed with go() instead
+        self.assertFalse(dbg.resume_thread(active))
+
+        self.assertTrue(dbg.stop_thread(other))
+        time.sleep(0.5)
+        self.assertIn(other, [thread.tid for thread in dbg.threads])
+        self.assertEqual(dbg.ip, ip)
+        dbg.quit()
+
     def test_assembly_code(self):
         if self.arch == 'x86_64':
             fpath = name_to_fpath('asmtest', 'x86_64')
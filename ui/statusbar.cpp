@@ -103,7 +103,11 @@ void DebuggerStatusBarWidget::updateStatusText(const DebuggerEvent &event)
 	{
 		DebugStopReason reason = event.data.targetStoppedData.reason;
 		const std::string reasonString = DebuggerController::GetDebugStopReasonString(reason);
-		setStatusText(QString::fromStdString(fmt::format("Stopped ({})", reasonString)));
+		if (reason == DebugStopReason::Watchpoint)
+			setStatusText(QString::fromStdString(fmt::format("Stopped ({} at {:#x})", reasonString,
+				event.data.targetStoppedData.dataAddress)));
+		else
+			setStatusText(QString::fromStdString(fmt::format("Stopped ({})", reasonString)));
 		break;
 	}
 	case TargetExitedEventType:
@@ -32,6 +32,7 @@ limitations under the License.
 #include "codedatarenderer.h"
 #include "adaptersettings.h"
 #include <thread>
+#include <algorithm>
 #include <QInputDialog>
 #include <filesystem>
 #include <QMessageBox>
@@ -992,6 +993,40 @@ void GlobalDebuggerUI::InitializeUI()
             "Sets/clears breakpoint at right-clicked address",
             BreakpointToggleCallback, BinaryViewValid);
 
+	// A write watchpoint on the selected data. The hardware watches 1, 2, 4 or 8 bytes at an address aligned to the
+	// size, so the size is rounded down to one of those and the address is aligned down to it.
+	UIAction::registerAction("Debugger\\Toggle Watchpoint");
+	UIAction::registerAction("Selection Target\\Debugger\\Toggle Watchpoint");
+	PluginCommand::RegisterForRange("Debugger\\Toggle Watchpoint",
+			"Sets/clears a write watchpoint on the selected data",
+			[](BinaryView* view, uint64_t addr, uint64_t len){
+					auto controller = DebuggerController::GetController(view);
+					if (!controller)
+						return;
+					for (const auto& watchpoint: controller->GetWatchpoints())
+					{
+						if ((addr >= watchpoint.address) && (addr < watchpoint.address + watchpoint.size))
+						{
+							controller->RemoveWatchpoint(watchpoint.address);
+							return;
+						}
+					}
+
+					uint64_t size = 1;
+					while ((size < 8) && (size * 2 <= len))
+						size *= 2;
+					const uint64_t address = addr & ~(size - 1);
+					if ((address != addr) || (size != std::max<uint64_t>(len, 1)))
+						LogWarn("%s", fmt::format("The watchpoint covers {:#x}-{:#x} rather than the selected {:#x}-{:#x}",
+							address, address + size, addr, addr + std::max<uint64_t>(len, 1)).c_str());
+
+					if (!controller->AddWatchpoint(address, size, WatchpointWrite))
+						LogWarn("%s", fmt::format("Failed to set a watchpoint at {:#x}", address).c_str());
+				},
+			[](BinaryView* view, uint64_t addr, uint64_t len){
+					return ConnectedAndStopped(view, addr);
+				});
+
 	UIAction::registerAction("Debugger\\Run To Here");
 	UIAction::registerAction("Selection Target\\Debugger\\Run To Here");
 	PluginCommand::RegisterForAddress("Debugger\\Run To Here",